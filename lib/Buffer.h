@@ -8,6 +8,8 @@
 #ifndef BUFFER_H_
 #define BUFFER_H_
 
+#include "BufferPool.h"
+
 //! An event buffer.
 class Buffer {
 protected:
@@ -44,6 +46,10 @@ public:
     unsigned int* GetBuffer()
         { return buffer; }
 
+    //! Get read-only access to the buffer memory.
+    const unsigned int* GetBuffer() const
+        { return buffer; }
+
     //! Create a new buffer of the same type.
     /*! \return a new buffer, or 0
      */
@@ -60,12 +66,33 @@ private:
 // ########################################################################
 // ########################################################################
 
+//! A buffer that does not own its data.
+/*! This is used for pointing directly into memory that is managed
+ *  elsewhere, e.g. a memory-mapped data file in MMapFileBufferFetcher.
+ */
+class BufferView : public Buffer {
+public:
+    //! Initialize a view of the given size, not yet pointing anywhere.
+    BufferView(unsigned int sz /*!< The size of the buffer in int words. */)
+        : Buffer(sz, 0) { }
+
+    //! Let the view point to other data.
+    void SetView(unsigned int* bffr /*!< The data to look at. */)
+        { SetBuffer(bffr); }
+};
+
+// ########################################################################
+// ########################################################################
+
 //! A sirius event buffer with 128kB size (32768 words).
+/*! The memory is taken from the BufferPool.
+ */
 class SiriusBuffer : public Buffer {
-    enum { BUFSIZE = 0x8000 /*!< The size of a sirius buffer in words. */ };
 public:
-    SiriusBuffer() : Buffer(BUFSIZE, new unsigned int[BUFSIZE]) { }
-    ~SiriusBuffer() { delete GetBuffer(); }
+    enum { BUFSIZE = 0x8000 /*!< The size of a sirius buffer in words. */ };
+
+    SiriusBuffer() : Buffer(BUFSIZE, BufferPool::Allocate(BUFSIZE)) { }
+    ~SiriusBuffer() { BufferPool::Release(GetBuffer(), BUFSIZE); }
     Buffer* New() { return new SiriusBuffer(); }
 };
 
@@ -9,6 +9,7 @@
 #define BUFFERFETCHER_H_
 
 #include "Buffer.h"
+#include "BufferHandle.h"
 
 //! Interface of classes that are able to fetch buffers for sorting.
 class BufferFetcher {
@@ -25,6 +26,17 @@ public:
      */
     virtual const Buffer* Next(Status& state /*!< Will contain the status after reading. */) = 0;
 
+    //! Fetch the next buffer as a handle.
+    /*! Unlike the buffer from Next(), the buffer stays valid until the
+     *  last copy of the handle is dropped, also after further calls to
+     *  NextHandle(). The default implementation copies the buffer from
+     *  Next(); fetchers that can give away their buffers override it.
+     *
+     *  \return the handle, empty unless the state is OKAY
+     */
+    virtual BufferHandle NextHandle(Status& state /*!< Will contain the status after reading. */)
+        { const Buffer* b = Next(state); return b ? BufferHandle::Copy(*b) : BufferHandle(); }
+
     //! Virtual no-op destructor.
     virtual ~BufferFetcher() { };
 };
@@ -0,0 +1,80 @@
+/*
+ * BufferHandle.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "BufferHandle.h"
+
+#include "Buffer.h"
+
+#include <cstring>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+//! A buffer of any size with memory from the BufferPool.
+class CopiedBuffer : public Buffer {
+public:
+    CopiedBuffer(unsigned int sz) : Buffer(sz, BufferPool::Allocate(sz)) { }
+    ~CopiedBuffer() { BufferPool::Release(GetBuffer(), GetSize()); }
+    Buffer* New() { return new CopiedBuffer(GetSize()); }
+};
+
+// ########################################################################
+// ########################################################################
+
+BufferHandle::BufferHandle(Buffer* buffer, BufferRecycler* recycler)
+    : shared( new Shared() )
+{
+    shared->buffer = buffer;
+    shared->recycler = recycler;
+    shared->refs = 1;
+}
+
+// ########################################################################
+
+BufferHandle::BufferHandle(const BufferHandle& other)
+    : shared( other.shared )
+{
+    if( shared )
+        __atomic_add_fetch(&shared->refs, 1, __ATOMIC_RELAXED);
+}
+
+// ########################################################################
+
+BufferHandle& BufferHandle::operator=(const BufferHandle& other)
+{
+    if( other.shared )
+        __atomic_add_fetch(&other.shared->refs, 1, __ATOMIC_RELAXED);
+    Reset();
+    shared = other.shared;
+    return *this;
+}
+
+// ########################################################################
+
+void BufferHandle::Reset()
+{
+    if( !shared )
+        return;
+    if( __atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) == 0 ) {
+        if( shared->recycler )
+            shared->recycler->Recycle(shared->buffer);
+        else
+            delete shared->buffer;
+        delete shared;
+    }
+    shared = 0;
+}
+
+// ########################################################################
+
+BufferHandle BufferHandle::Copy(const Buffer& buffer)
+{
+    CopiedBuffer* copy = new CopiedBuffer(buffer.GetSize());
+    std::memcpy(copy->GetBuffer(), buffer.GetBuffer(), buffer.GetSize()*4);
+    return BufferHandle(copy, 0);
+}
@@ -0,0 +1,92 @@
+/* -*- c++ -*-
+ * BufferHandle.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef BUFFERHANDLE_H_
+#define BUFFERHANDLE_H_
+
+class Buffer;
+
+//! Takes back buffers when the last handle to them is dropped.
+class BufferRecycler {
+public:
+    //! Virtual no-op destructor.
+    virtual ~BufferRecycler() { }
+
+    //! Take back a buffer.
+    /*! This may be called from any thread.
+     */
+    virtual void Recycle(Buffer* buffer /*!< The buffer that is no longer used. */) = 0;
+};
+
+// ########################################################################
+// ########################################################################
+
+//! A reference-counted handle to a buffer.
+/*! Copies of a handle refer to the same buffer. When the last copy is
+ *  destroyed or reset, the buffer is given back to its recycler. The
+ *  copies may be used and dropped in different threads, so that
+ *  several consumers can work on buffers in any order without copying
+ *  them.
+ */
+class BufferHandle {
+public:
+    //! Create an empty handle.
+    BufferHandle()
+        : shared( 0 ) { }
+
+    //! Create the first handle for a buffer.
+    BufferHandle(Buffer* buffer,           /*!< The buffer. */
+                 BufferRecycler* recycler  /*!< Where to give the buffer back, or 0 to delete it. */);
+
+    //! Create another handle for the same buffer.
+    BufferHandle(const BufferHandle& other);
+
+    //! Let this handle refer to another buffer.
+    BufferHandle& operator=(const BufferHandle& other);
+
+    //! Drop the reference.
+    ~BufferHandle()
+        { Reset(); }
+
+    //! Drop the reference, leaving an empty handle.
+    void Reset();
+
+    //! Get the buffer.
+    /*! \return the buffer, or 0 for an empty handle
+     */
+    const Buffer* Get() const
+        { return shared ? shared->buffer : 0; }
+
+    //! Access the buffer.
+    const Buffer* operator->() const
+        { return Get(); }
+
+    //! Make a handle with a copy of a buffer.
+    /*! This is for buffer fetchers that cannot give away their
+     *  buffers, see BufferFetcher::NextHandle().
+     *
+     *  \return the handle for the copy
+     */
+    static BufferHandle Copy(const Buffer& buffer /*!< The buffer to copy. */);
+
+private:
+    //! The data shared by all handles for a buffer.
+    struct Shared {
+        //! The buffer.
+        Buffer* buffer;
+
+        //! Where to give back the buffer, or 0 to delete it.
+        BufferRecycler* recycler;
+
+        //! The number of handles for this buffer.
+        int refs;
+    };
+
+    //! The shared data, or 0 for an empty handle.
+    Shared* shared;
+};
+
+#endif /* BUFFERHANDLE_H_ */
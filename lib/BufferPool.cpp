@@ -0,0 +1,85 @@
+/*
+ * BufferPool.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "BufferPool.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+BufferPool::BufferPool()
+    : arena_pos( 0 )
+    , arena_end( 0 )
+{
+}
+
+// ########################################################################
+
+BufferPool& BufferPool::Instance()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+// ########################################################################
+
+unsigned int* BufferPool::Allocate(unsigned int words)
+{
+    const unsigned int bytes = ((words*4 + ALIGN - 1)/ALIGN)*ALIGN;
+
+    BufferPool& pool = Instance();
+    PThreadMutexLock lock( pool.mutex );
+    std::vector<char*>& fb = pool.free_blocks[bytes];
+    if( !fb.empty() ) {
+        char* block = fb.back();
+        fb.pop_back();
+        return (unsigned int*)block;
+    }
+    return (unsigned int*)pool.NewBlock(bytes);
+}
+
+// ########################################################################
+
+void BufferPool::Release(unsigned int* data, unsigned int words)
+{
+    if( !data )
+        return;
+    const unsigned int bytes = ((words*4 + ALIGN - 1)/ALIGN)*ALIGN;
+
+    BufferPool& pool = Instance();
+    PThreadMutexLock lock( pool.mutex );
+    pool.free_blocks[bytes].push_back((char*)data);
+}
+
+// ########################################################################
+
+char* BufferPool::NewBlock(unsigned int bytes)
+{
+    if( bytes > (unsigned int)(arena_end - arena_pos) ) {
+        // a new arena, large enough for big blocks; the rest of the
+        // old arena is lost, which does not matter as long as most
+        // blocks have the same size
+        const unsigned int asize = ((bytes + ARENA - 1)/ARENA)*ARENA;
+        void* mem = 0;
+        if( posix_memalign(&mem, ARENA, asize) != 0 ) {
+            std::cerr << "bufferpool: cannot allocate " << asize << " bytes." << std::endl;
+            exit( -1 );
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(mem, asize, MADV_HUGEPAGE);
+#endif
+        arena_pos = (char*)mem;
+        arena_end = arena_pos + asize;
+    }
+    char* block = arena_pos;
+    arena_pos += bytes;
+    return block;
+}
@@ -0,0 +1,60 @@
+/* -*- c++ -*-
+ * BufferPool.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include "PThreadMutex.h"
+
+#include <map>
+#include <vector>
+
+//! A pool for the memory of buffers.
+/*! The memory is carved from arenas of 2MB which are aligned to 2MB,
+ *  so that the kernel can back them with huge pages. Each block is
+ *  aligned to at least 4kB, as needed for O_DIRECT and convenient for
+ *  SIMD code. Released blocks are kept in a free list and handed out
+ *  again for the next request of the same size; arenas are never
+ *  returned to the system. Thus buffers are not reallocated when a
+ *  fetcher restarts prefetching for a new file.
+ */
+class BufferPool {
+public:
+    //! Get memory from the pool.
+    /*! \return aligned memory for the given number of words.
+     */
+    static unsigned int* Allocate(unsigned int words /*!< The size in 32 bit words. */);
+
+    //! Return memory to the pool.
+    static void Release(unsigned int* data, /*!< Memory from Allocate(), or 0. */
+                        unsigned int words  /*!< The size passed to Allocate(). */);
+
+    enum { ARENA  = 2*1024*1024 /*!< The size and alignment of an arena in bytes. */,
+           ALIGN  = 4096        /*!< The minimum alignment of a block in bytes. */ };
+
+private:
+    BufferPool();
+
+    //! Get the pool object.
+    static BufferPool& Instance();
+
+    //! Get a new block of memory.
+    char* NewBlock(unsigned int bytes /*!< The size, a multiple of ALIGN. */);
+
+    //! The mutex for synchronizing access to the pool.
+    PThreadMutex mutex;
+
+    //! Released blocks, by size in bytes.
+    std::map<unsigned int, std::vector<char*> > free_blocks;
+
+    //! The free part of the current arena.
+    char* arena_pos;
+
+    //! The end of the current arena.
+    char* arena_end;
+};
+
+#endif /* BUFFERPOOL_H_ */
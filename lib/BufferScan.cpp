@@ -0,0 +1,236 @@
+/*
+ * BufferScan.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "BufferScan.h"
+
+#include "DataWord.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+//! Count the words with boe != 0 in a range.
+static unsigned int count_marked(const unsigned int* data, unsigned int n)
+{
+    unsigned int count = 0, i = 0;
+#ifdef __SSE2__
+    // align to 16 bytes for the vector loads
+    for(; i<n && (((unsigned long)(data+i)) & 15) != 0; ++i)
+        count += (boe(data[i]) != 0);
+
+    const __m128i mask = _mm_set1_epi32(0xC0000000);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    const unsigned int vstart = i;
+    for(; i+4<=n; i+=4) {
+        const __m128i v = _mm_and_si128(_mm_load_si128((const __m128i*)(data+i)), mask);
+        // 'cmpeq' gives -1 for words without boe bits
+        acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(v, zero));
+    }
+    unsigned int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    const unsigned int unmarked = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    count += (i - vstart) - unmarked;
+#endif
+    for(; i<n; ++i)
+        count += (boe(data[i]) != 0);
+    return count;
+}
+
+// ########################################################################
+
+//! Find the words with boe != 0 in a range.
+/*! \return the number of words found, their positions are stored in 'pos'
+ */
+static unsigned int find_marked(const unsigned int* data, unsigned int n, unsigned int* pos)
+{
+    unsigned int count = 0, i = 0;
+#ifdef __SSE2__
+    // align to 16 bytes for the vector loads
+    for(; i<n && (((unsigned long)(data+i)) & 15) != 0; ++i) {
+        if( boe(data[i]) != 0 )
+            pos[count++] = i;
+    }
+
+    const __m128i mask = _mm_set1_epi32(0xC0000000);
+    const __m128i zero = _mm_setzero_si128();
+    for(; i+4<=n; i+=4) {
+        const __m128i v = _mm_and_si128(_mm_load_si128((const __m128i*)(data+i)), mask);
+        // one bit for each word with boe bits
+        unsigned int bits = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, zero))) & 0xF;
+        while( bits ) {
+            pos[count++] = i + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+#endif
+    for(; i<n; ++i) {
+        if( boe(data[i]) != 0 )
+            pos[count++] = i;
+    }
+    return count;
+}
+
+// ########################################################################
+
+BufferScan::BufferScan()
+    : result( OKAY )
+    , events( 0 )
+    , position( 0 )
+    , has_time( false )
+    , time_first( 0 )
+    , time_last( 0 )
+    , headers( 0 )
+{
+}
+
+// ########################################################################
+
+const char* BufferScan::Describe(Result r)
+{
+    switch( r ) {
+    case OKAY:       return "okay";
+    case BAD_HEADER: return "no event header or end-of-buffer";
+    case OVERRUN:    return "event longer than buffer";
+    case BAD_DATA:   return "header-like word inside event";
+    }
+    return "?";
+}
+
+// ########################################################################
+
+bool BufferScan::EventTime(const unsigned int* data, unsigned int header, long& time)
+{
+    const unsigned int n = ndw(data[header]);
+    for(unsigned int i=header+1; i<header+n; ++i) {
+        if( box(data[i]) == 0x01 && chn(data[i]) == 16 && chn(data[i+1]) == 17 ) {
+            time = ((long)dta(data[i]))<<16 | dta(data[i+1]);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ########################################################################
+
+BufferScan::Result BufferScan::Scan(const unsigned int* data, unsigned int size)
+{
+    events = 0;
+    has_time = false;
+    result = OKAY;
+
+    // walk the event headers
+    unsigned int idx = 0, last_header = 0;
+    while( idx < size ) {
+        const unsigned int w = data[idx];
+        if( boe(w) != 0xC ) {
+            if( w != EOB )
+                result = BAD_HEADER;
+            break;
+        }
+        const unsigned int n = ndw(w);
+        if( idx + n >= size ) {
+            result = OVERRUN;
+            break;
+        }
+        if( headers )
+            headers[events] = idx;
+        if( !has_time )
+            has_time = EventTime(data, idx, time_first);
+        last_header = idx;
+        events += 1;
+        idx += n + 1;
+    }
+    position = idx;
+
+    // all words up to here except the headers must be data words
+    if( count_marked(data, idx) != events ) {
+        // find the bad word, counting the good events before it;
+        // the times are also taken from these events only
+        events = 0;
+        has_time = false;
+        for(unsigned int h=0; h<idx; h += ndw(data[h]) + 1) {
+            for(unsigned int i=h+1; i<=h+ndw(data[h]); ++i) {
+                if( boe(data[i]) != 0 ) {
+                    position = i;
+                    result = BAD_DATA;
+                    return result;
+                }
+            }
+            long t;
+            if( EventTime(data, h, t) ) {
+                if( !has_time )
+                    time_first = t;
+                time_last = t;
+                has_time = true;
+            }
+            events += 1;
+        }
+    }
+
+    // the time of the last event with a time word
+    if( has_time ) {
+        time_last = time_first;
+        for(unsigned int h=last_header; ; ) {
+            if( EventTime(data, h, time_last) )
+                break;
+            // search backwards; find the previous header
+            if( h == 0 )
+                break;
+            unsigned int p = h - 1;
+            while( p > 0 && boe(data[p]) != 0xC )
+                p -= 1;
+            h = p;
+        }
+    }
+    return result;
+}
+
+// ########################################################################
+
+BufferScan::Result BufferScan::Prescan(const unsigned int* data, unsigned int size)
+{
+    events = 0;
+    has_time = false;
+    result = OKAY;
+
+    marked.resize(size);
+    const unsigned int n_marked = find_marked(data, size, marked.empty() ? 0 : &marked[0]);
+
+    // check that the marked words are where walking the headers would find them
+    unsigned int idx = 0;
+    for(unsigned int m=0; idx < size; ++m) {
+        const unsigned int w = data[idx];
+        if( m >= n_marked || marked[m] != idx || boe(w) != 0xC ) {
+            if( w != EOB )
+                result = BAD_HEADER;
+            break;
+        }
+        const unsigned int n = ndw(w);
+        if( idx + n >= size ) {
+            result = OVERRUN;
+            break;
+        }
+        if( m+1 < n_marked && marked[m+1] <= idx + n ) {
+            // a header-like word inside the event
+            headers[events] = idx;
+            position = marked[m+1];
+            result = BAD_DATA;
+            return result;
+        }
+        headers[events] = idx;
+        events += 1;
+        idx += n + 1;
+    }
+    headers[events] = idx;
+    position = idx;
+    return result;
+}
@@ -0,0 +1,97 @@
+/* -*- c++ -*-
+ * BufferScan.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef BUFFERSCAN_H_
+#define BUFFERSCAN_H_
+
+#include <vector>
+
+//! Check the structure of a sirius buffer without unpacking the events.
+/*! The buffer is walked from event header to event header. A valid
+ *  buffer contains events, each starting with a header word (boe
+ *  0xC) giving the number of data words, followed by the end-of-buffer
+ *  marker or the end of the buffer. Data words must not look like
+ *  headers (boe != 0). This last check covers all words and is done
+ *  with SSE2 if available.
+ *
+ *  The wall-clock time (box 0x01) of the first and the last event
+ *  with a time word is extracted as well.
+ */
+class BufferScan {
+public:
+    typedef enum { OKAY,  //!< The buffer structure is okay.
+        BAD_HEADER,       //!< A word where an event should start is neither header nor end-of-buffer.
+        OVERRUN,          //!< An event is longer than the rest of the buffer.
+        BAD_DATA          //!< A data word inside an event has boe != 0.
+    } Result;
+
+    //! Initialize with empty results.
+    BufferScan();
+
+    //! Check a buffer.
+    /*! \return the result, also stored in 'result'.
+     */
+    Result Scan(const unsigned int* data, /*!< The buffer words. */
+                unsigned int size         /*!< The number of words in the buffer. */);
+
+    //! Find the event headers of a buffer without walking from header to header.
+    /*! All words with boe bits are located in one vectorized pass.
+     *  In a good buffer, these are exactly the event headers, each at
+     *  the distance given by the length of the event before, and the
+     *  end-of-buffer marker. This is checked, so that 'result',
+     *  'events' and 'position' are the same as from Scan(); the time
+     *  is not extracted.
+     *
+     *  'headers' must have room for 'size'+1 entries. After the
+     *  positions of the event headers, it contains the end of the last
+     *  complete event. The events can then be unpacked in several parts
+     *  at the same time.
+     *
+     *  \return the result, also stored in 'result'.
+     */
+    Result Prescan(const unsigned int* data, /*!< The buffer words. */
+                   unsigned int size         /*!< The number of words in the buffer. */);
+
+    //! Get a description of a result.
+    static const char* Describe(Result r);
+
+    //! The result of the last scan.
+    Result result;
+
+    //! The number of complete events before the end or the error.
+    unsigned int events;
+
+    //! The index of the word with the problem, or of the end-of-buffer marker.
+    unsigned int position;
+
+    //! True if 'time_first' and 'time_last' are set.
+    /*! Only the complete events before an error are looked at.
+     */
+    bool has_time;
+
+    //! The time of the first event with a time word.
+    long time_first;
+
+    //! The time of the last event with a time word.
+    long time_last;
+
+    //! The positions of the event headers, if requested.
+    /*! If not 0, the Scan() stores the index of each event header
+     *  here; it must have room for 'size' entries.
+     */
+    unsigned int* headers;
+
+private:
+    //! Look for a time word in an event.
+    /*! \return true if a time was found
+     */
+    static bool EventTime(const unsigned int* data, unsigned int header, long& time);
+
+    //! The positions of all words with boe bits, for Prescan().
+    std::vector<unsigned int> marked;
+};
+
+#endif /* BUFFERSCAN_H_ */
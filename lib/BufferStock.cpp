@@ -0,0 +1,114 @@
+/*
+ * BufferStock.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "BufferStock.h"
+
+#include "Buffer.h"
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+BufferStock::BufferStock(Buffer* tb, unsigned int mb)
+    : template_buffer( tb )
+    , max_buffers( mb )
+    , allocated( 0 )
+    , disposed( false )
+{
+    pthread_cond_init( &cond_free, 0 );
+}
+
+// ########################################################################
+
+BufferStock::~BufferStock()
+{
+    for(unsigned int i=0; i<spare.size(); ++i)
+        delete spare[i];
+    delete template_buffer;
+    pthread_cond_destroy( &cond_free );
+}
+
+// ########################################################################
+
+Buffer* BufferStock::Take(const int& cancel)
+{
+    PThreadMutexLock lock( mutex );
+    while( spare.empty() && allocated >= max_buffers ) {
+        if( __atomic_load_n(&cancel, __ATOMIC_SEQ_CST) )
+            return 0;
+        mutex.Wait( &cond_free );
+    }
+    if( spare.empty() ) {
+        allocated += 1;
+        return template_buffer->New();
+    }
+    Buffer* b = spare.back();
+    spare.pop_back();
+    return b;
+}
+
+// ########################################################################
+
+Buffer* BufferStock::TryTake()
+{
+    PThreadMutexLock lock( mutex );
+    if( spare.empty() && allocated >= max_buffers )
+        return 0;
+    if( spare.empty() ) {
+        allocated += 1;
+        return template_buffer->New();
+    }
+    Buffer* b = spare.back();
+    spare.pop_back();
+    return b;
+}
+
+// ########################################################################
+
+void BufferStock::Recycle(Buffer* buffer)
+{
+    bool last = false;
+    { // critical section
+        PThreadMutexLock lock( mutex );
+        if( disposed ) {
+            delete buffer;
+            allocated -= 1;
+            last = (allocated == 0);
+        } else {
+            spare.push_back( buffer );
+            pthread_cond_signal( &cond_free );
+        }
+    } // unlock in 'lock' destructor
+    if( last )
+        delete this;
+}
+
+// ########################################################################
+
+void BufferStock::WakeUp()
+{
+    PThreadMutexLock lock( mutex );
+    pthread_cond_broadcast( &cond_free );
+}
+
+// ########################################################################
+
+void BufferStock::Dispose()
+{
+    bool last = false;
+    { // critical section
+        PThreadMutexLock lock( mutex );
+        disposed = true;
+        allocated -= spare.size();
+        for(unsigned int i=0; i<spare.size(); ++i)
+            delete spare[i];
+        spare.clear();
+        last = (allocated == 0);
+    } // unlock in 'lock' destructor
+    if( last )
+        delete this;
+}
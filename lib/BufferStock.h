@@ -0,0 +1,72 @@
+/* -*- c++ -*-
+ * BufferStock.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef BUFFERSTOCK_H_
+#define BUFFERSTOCK_H_
+
+#include "BufferHandle.h"
+#include "PThreadMutex.h"
+
+#include <vector>
+
+//! A set of buffers, given out to be filled and recycled when no longer used.
+/*! Buffers are created as needed, up to a maximum number. Buffers
+ *  given out with BufferHandle objects may outlive the owner of the
+ *  stock: the owner calls Dispose() instead of deleting the stock, and
+ *  the stock deletes itself when the last buffer has come back.
+ */
+class BufferStock : public BufferRecycler {
+public:
+    //! Create an empty stock.
+    BufferStock(Buffer* template_buffer, /*!< Buffer object to be "multiplied", owned by the stock. */
+                unsigned int max_buffers /*!< The maximum number of buffers. */);
+
+    //! Get a free buffer, waiting if all buffers are in use.
+    /*! \return a buffer, or 0 if 'cancel' was set while waiting
+     */
+    Buffer* Take(const int& cancel /*!< Stop waiting if this becomes non-zero, see WakeUp(). */);
+
+    //! Get a free buffer without waiting.
+    /*! \return a buffer, or 0 if all buffers are in use
+     */
+    Buffer* TryTake();
+
+    //! Give back a buffer.
+    void Recycle(Buffer* buffer);
+
+    //! Wake up threads waiting in Take(), to let them check their cancel flag.
+    void WakeUp();
+
+    //! Delete the stock as soon as all buffers are back.
+    void Dispose();
+
+private:
+    //! Only deleted by Dispose() or Recycle().
+    ~BufferStock();
+
+    //! Buffer object to be "multiplied".
+    Buffer* template_buffer;
+
+    //! The maximum number of buffers.
+    const unsigned int max_buffers;
+
+    //! The number of buffers created and not deleted.
+    unsigned int allocated;
+
+    //! The buffers not in use.
+    std::vector<Buffer*> spare;
+
+    //! True after Dispose() was called.
+    bool disposed;
+
+    //! Protects all members.
+    PThreadMutex mutex;
+
+    //! The condition "a buffer was given back".
+    pthread_cond_t cond_free;
+};
+
+#endif /* BUFFERSTOCK_H_ */
@@ -0,0 +1,85 @@
+/*
+ * ByteOrder.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "ByteOrder.h"
+
+#include "DataWord.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The number of events to check when detecting the byte order.
+static const int CHECK_EVENTS = 16;
+
+// ########################################################################
+
+inline unsigned int byteswap(unsigned int u)
+{ return ((u&0xff)<<24)|((u&0xff00)<<8)|((u&0xff0000)>>8)|((u&0xff000000)>>24); }
+
+// ########################################################################
+
+//! Walk from event header to event header at the beginning of a buffer.
+/*! \return the number of events found, or -1 if a word where an event
+ *          should start is neither header nor end-of-buffer marker
+ */
+static int count_events(const unsigned int* data, unsigned int size, bool swap)
+{
+    unsigned int idx = 0;
+    int events = 0;
+    while( idx < size && events < CHECK_EVENTS ) {
+        const unsigned int word = swap ? byteswap(data[idx]) : data[idx];
+        if( word == EOB )
+            break;
+        if( boe(word) != 0xC )
+            return -1;
+        idx += ndw(word) + 1;
+        events += 1;
+    }
+    return (idx > size) ? -1 : events;
+}
+
+// ########################################################################
+
+ByteOrder::Order ByteOrder::Detect(const unsigned int* data, unsigned int size)
+{
+    const int native = count_events(data, size, false);
+    const int swapped = count_events(data, size, true);
+    DBGV(native);
+    DBGV(swapped);
+    if( native > 0 && native >= swapped )
+        return NATIVE;
+    else if( swapped > 0 )
+        return SWAPPED;
+    else
+        return UNKNOWN;
+}
+
+// ########################################################################
+
+void ByteOrder::Swap(unsigned int* data, unsigned int size)
+{
+    unsigned int i = 0;
+#ifdef __SSE2__
+    // align to 16 bytes for the vector loads
+    for(; i<size && (((unsigned long)(data+i)) & 15) != 0; ++i)
+        data[i] = byteswap(data[i]);
+
+    for(; i+4<=size; i+=4) {
+        __m128i v = _mm_load_si128((const __m128i*)(data+i));
+        // swap the bytes in each 16-bit half, then the halves
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_store_si128((__m128i*)(data+i), v);
+    }
+#endif
+    for(; i<size; ++i)
+        data[i] = byteswap(data[i]);
+}
@@ -0,0 +1,63 @@
+/* -*- c++ -*-
+ * ByteOrder.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef BYTEORDER_H_
+#define BYTEORDER_H_
+
+//! Detect the byte order of a data file and convert its buffers.
+/*! Files written on big-endian machines contain the words of the
+ *  buffers with their bytes in reverse order. The byte order is
+ *  detected from the first buffer of a file that contains events: its
+ *  first word must be an event header, and the event lengths must
+ *  lead from header to header. If the file has the other byte order,
+ *  the whole buffer is swapped (with SSE2, if available), so that the
+ *  unpacker never has to care about byte order.
+ *
+ *  The buffer fetchers keep one ByteOrder for each file and call
+ *  Fix() for each buffer they read.
+ */
+class ByteOrder {
+public:
+    typedef enum { UNKNOWN, //!< No event header found yet.
+        NATIVE,             //!< The words have the byte order of this machine.
+        SWAPPED             //!< The bytes of each word are in reverse order.
+    } Order;
+
+    //! Start with unknown byte order.
+    ByteOrder()
+        : order( UNKNOWN ) { }
+
+    //! Forget the byte order, for the next file.
+    void Reset()
+        { order = UNKNOWN; }
+
+    //! Get the byte order detected so far.
+    Order GetOrder() const
+        { return order; }
+
+    //! Detect the byte order, if still unknown, and swap the buffer if needed.
+    void Fix(unsigned int* data, /*!< The buffer words. */
+             unsigned int size   /*!< The number of words in the buffer. */)
+        { if( order == UNKNOWN ) order = Detect(data, size); if( order == SWAPPED ) Swap(data, size); }
+
+    //! Detect the byte order from the events at the beginning of a buffer.
+    /*! \return the byte order, or UNKNOWN if the buffer starts with
+     *          the end-of-buffer marker or has bad events in both
+     *          byte orders
+     */
+    static Order Detect(const unsigned int* data, /*!< The buffer words. */
+                        unsigned int size         /*!< The number of words in the buffer. */);
+
+    //! Reverse the bytes of all words of a buffer.
+    static void Swap(unsigned int* data, /*!< The buffer words. */
+                     unsigned int size   /*!< The number of words in the buffer. */);
+
+private:
+    //! The byte order of the current file.
+    Order order;
+};
+
+#endif /* BYTEORDER_H_ */
@@ -0,0 +1,192 @@
+/*
+ * DataCache.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "DataCache.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <dirent.h>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+#define NDEBUG 1
+#include "debug.h"
+
+std::string DataCache::cache_dir;
+long long DataCache::cache_max = 0;
+
+// ########################################################################
+
+void DataCache::Configure(const std::string& directory, long long max_bytes)
+{
+    cache_dir = directory;
+    cache_max = max_bytes;
+}
+
+// ########################################################################
+
+std::string DataCache::CopyName(const std::string& filename)
+{
+    struct stat st;
+    if( cache_dir.empty() || stat(filename.c_str(), &st) != 0 )
+        return "";
+
+    // the same file name may appear in several directories
+    char full[PATH_MAX];
+    const std::string path = realpath(filename.c_str(), full) ? full : filename;
+    unsigned long long hash = 14695981039346656037ULL; // FNV-1a
+    for(unsigned int i=0; i<path.size(); ++i)
+        hash = (hash ^ (unsigned char)path[i]) * 1099511628211ULL;
+
+    std::string base = filename.substr(filename.rfind('/') + 1);
+    base = base.substr(0, base.rfind('.')); // without .gz or .zst
+
+    std::ostringstream name;
+    name << cache_dir << '/' << std::hex << hash << std::dec
+         << '-' << st.st_size << '-' << st.st_mtime << '-' << base;
+    return name.str();
+}
+
+// ########################################################################
+
+std::string DataCache::Find(const std::string& filename)
+{
+    const std::string copy = CopyName(filename);
+    if( copy.empty() || access(copy.c_str(), R_OK) != 0 )
+        return "";
+
+    // mark as used recently
+    utimes(copy.c_str(), 0);
+    return copy;
+}
+
+// ########################################################################
+
+void DataCache::Shrink(const std::string& keep)
+{
+    DIR* dir = opendir(cache_dir.c_str());
+    if( !dir )
+        return;
+
+    // list the finished copies, oldest first; unfinished copies start with '.'
+    typedef std::pair<time_t, std::pair<long long, std::string> > copy_t;
+    std::vector<copy_t> copies;
+    long long total = 0;
+    while( const dirent* e = readdir(dir) ) {
+        if( e->d_name[0] == '.' )
+            continue;
+        const std::string path = cache_dir + '/' + e->d_name;
+        struct stat st;
+        if( stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) )
+            continue;
+        copies.push_back( copy_t(path == keep ? LONG_MAX : st.st_mtime,
+                                 std::make_pair((long long)st.st_size, path)) );
+        total += st.st_size;
+    }
+    closedir(dir);
+
+    std::sort(copies.begin(), copies.end());
+    for(unsigned int i=0; i<copies.size() && total > cache_max; ++i) {
+        const std::string& path = copies[i].second.second;
+        if( path == keep )
+            std::cout << "cache: '" << path << "' is larger than the cache." << std::endl;
+        if( unlink(path.c_str()) == 0 )
+            total -= copies[i].second.first;
+    }
+}
+
+// ########################################################################
+// ########################################################################
+
+DataCache::DataCache()
+    : file( 0 )
+    , written( 0 )
+{
+}
+
+// ########################################################################
+
+DataCache::~DataCache()
+{
+    Abort();
+}
+
+// ########################################################################
+
+bool DataCache::Start(const std::string& filename)
+{
+    Abort();
+    copyname = CopyName(filename);
+    if( copyname.empty() )
+        return false;
+
+    // a hidden name, so that the unfinished copy is neither used nor removed by Shrink()
+    std::ostringstream tmp;
+    const std::string::size_type slash = copyname.rfind('/');
+    tmp << copyname.substr(0, slash+1) << '.' << copyname.substr(slash+1)
+        << '.' << getpid() << '.' << this << ".tmp";
+    tmpname = tmp.str();
+    written = 0;
+    file = std::fopen(tmpname.c_str(), "wb");
+    if( !file ) {
+        std::cerr << "cache: cannot write '" << tmpname << "'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool DataCache::Write(const char* data, unsigned int size)
+{
+    if( !file )
+        return false;
+    // stop before a single copy fills the disk; Shrink() only runs at the end
+    if( written + size > cache_max ) {
+        std::cout << "cache: '" << copyname << "' is larger than the cache, not caching." << std::endl;
+        Abort();
+        return false;
+    }
+    written += size;
+    if( std::fwrite(data, 1, size, file) != size ) {
+        std::cerr << "cache: error writing '" << tmpname << "', not caching." << std::endl;
+        Abort();
+        return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+void DataCache::Finish()
+{
+    if( !file )
+        return;
+    const bool ok = std::fclose(file) == 0;
+    file = 0;
+    if( !ok || std::rename(tmpname.c_str(), copyname.c_str()) != 0 ) {
+        std::cerr << "cache: error writing '" << tmpname << "', not caching." << std::endl;
+        std::remove(tmpname.c_str());
+        return;
+    }
+    Shrink(copyname);
+}
+
+// ########################################################################
+
+void DataCache::Abort()
+{
+    if( !file )
+        return;
+    std::fclose(file);
+    file = 0;
+    std::remove(tmpname.c_str());
+}
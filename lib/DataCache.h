@@ -0,0 +1,97 @@
+/* -*- c++ -*-
+ * DataCache.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef DATACACHE_H_
+#define DATACACHE_H_
+
+#include <cstdio>
+#include <string>
+
+//! A directory with decompressed copies of compressed data files.
+/*! When a compressed file is read completely from the start, the
+ *  decompressed data are also written into the cache directory.
+ *  Later, FileReader reads the copy instead, which is much faster,
+ *  especially if the cache is on a local SSD or in
+ *  <code>/dev/shm</code>.
+ *
+ *  The name of a copy contains the size and modification time of
+ *  the compressed file, so a changed file is not taken from the cache.
+ *  Each use of a copy updates its modification time, and when the
+ *  cache grows beyond its size limit, the copies used least recently
+ *  are removed.
+ */
+class DataCache {
+public:
+    //! Set the cache directory and size for files opened later.
+    /*! An empty directory disables the cache.
+     */
+    static void Configure(const std::string& directory, /*!< The cache directory. */
+                          long long max_bytes           /*!< The maximum size of all copies. */);
+
+    //! Check if the cache is used.
+    static bool IsEnabled()
+        { return !cache_dir.empty(); }
+
+    //! Find the copy of a file in the cache.
+    /*! \return the name of the copy, or an empty string if there is none
+     */
+    static std::string Find(const std::string& filename /*!< The compressed file. */);
+
+    //! Prepare to write a copy.
+    DataCache();
+
+    //! Remove the copy if it was not finished.
+    ~DataCache();
+
+    //! Start writing the copy of a file.
+    /*! \return false if the copy cannot be written
+     */
+    bool Start(const std::string& filename /*!< The compressed file. */);
+
+    //! Append decompressed data to the copy.
+    /*! \return false if writing failed or the copy would be larger
+     *  than the cache; the copy is then removed
+     */
+    bool Write(const char* data, unsigned int size);
+
+    //! Finish the copy after all data have been written.
+    /*! The copy is moved to its final name, and old copies are
+     *  removed if the cache is too large.
+     */
+    void Finish();
+
+private:
+    //! Get the name of the copy for a compressed file.
+    /*! \return the name, or an empty string if the file does not exist
+     */
+    static std::string CopyName(const std::string& filename /*!< The compressed file. */);
+
+    //! Remove the copies used least recently until the cache is small enough.
+    static void Shrink(const std::string& keep /*!< A copy that should be kept, if possible. */);
+
+    //! Remove the unfinished copy.
+    void Abort();
+
+    //! The cache directory, or empty if not used.
+    static std::string cache_dir;
+
+    //! The maximum size of all copies in the cache.
+    static long long cache_max;
+
+    //! The file for the copy being written, or 0.
+    std::FILE* file;
+
+    //! The temporary name of the copy being written.
+    std::string tmpname;
+
+    //! The final name of the copy being written.
+    std::string copyname;
+
+    //! The number of bytes written to the copy.
+    long long written;
+};
+
+#endif /* DATACACHE_H_ */
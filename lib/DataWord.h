@@ -0,0 +1,32 @@
+/* -*- c++ -*-
+ * DataWord.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef DATAWORD_H_
+#define DATAWORD_H_
+
+//! The type of a word: 0xC for an event header, 0 for a data word.
+inline unsigned int boe(unsigned int x) { return ((x&0xC0000000)>>28); }
+
+//! The number of data words after an event header.
+inline unsigned int ndw(unsigned int x) { return  (x&0x000000ff);      }
+
+//! The box of a data word.
+inline unsigned int box(unsigned int x) { return ((x&0x3f800000)>>23); }
+
+//! The channel of a data word.
+inline unsigned int chn(unsigned int x) { return ((x&0x007f0000)>>16); }
+
+//! The value of a data word.
+inline unsigned int dta(unsigned int x) { return  (x&0x0000ffff);      }
+
+//! Make a data word from box, channel and value.
+inline unsigned int data_word(unsigned int b, unsigned int c, unsigned int v)
+{ return (b<<23) | (c<<16) | (v & 0xffff); }
+
+//! The end-of-buffer marker.
+static const unsigned int EOB = 0x80000000;
+
+#endif /* DATAWORD_H_ */
@@ -9,6 +9,6 @@
 
 void Event::Reset()
 {
-    n_e = n_de = n_na = n_scaler = 0;
+    n_e = n_de = n_na = n_ppac = n_scaler = 0;
     has_time = has_pattern = false;
 }
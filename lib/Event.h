@@ -10,6 +10,12 @@
 //! A sirius event.
 struct Event {
 
+    //! The largest number of values of each kind.
+    /*! Values that do not fit are dropped by the Unpacker and counted
+     *  in its statistics. EventBatch has no such limits.
+     */
+    enum { MAX_E = 32, MAX_DE = 64, MAX_NA = 32, MAX_PPAC = 32, MAX_SCALER = 16 };
+
     //! Combination of channel id and ADC value.
     struct chn_adc {
         //! The channel id.
@@ -44,25 +50,34 @@ struct Event {
     int n_e;
 
     //! The SiRi back detector ADC values.
-    chn_adc e[32];
+    chn_adc e[MAX_E];
 
     //! The count of SiRi front detector ADC values.
     int n_de;
 
     //! The SiRi front detetcor ADC values.
-    chn_adc de[64];
+    chn_adc de[MAX_DE];
 
     //! The count of CACTUS TDC and ADC values.
     int n_na;
 
     //! The CACTUS TDC and ADC values.
-    chn_adc_tdc na[32];
+    chn_adc_tdc na[MAX_NA];
+
+    //! The count of PPAC TDC and ADC values.
+    int n_ppac;
+
+    //! The PPAC TDC and ADC values, with the CACTUS channel ids.
+    /*! PPACs are read out through channels of the CACTUS boxes, see
+     *  Unpacker::SetPPAC().
+     */
+    chn_adc_tdc ppac[MAX_PPAC];
 
     //! The count of scaler values.
     int n_scaler;
 
     //! The scaler values.
-    chn_scaler scaler[16];
+    chn_scaler scaler[MAX_SCALER];
 
     //! Flag indicating that the wall clock time is present.
     bool has_time;
@@ -0,0 +1,158 @@
+/*
+ * EventBatch.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "EventBatch.h"
+
+#include "Event.h"
+
+#include <algorithm>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+EventBatch::EventBatch()
+    : n_events( 0 )
+    , n_e( 0 )
+    , e_begin( 1, 0 )
+    , n_de( 0 )
+    , de_begin( 1, 0 )
+    , n_na( 0 )
+    , na_begin( 1, 0 )
+    , n_ppac( 0 )
+    , ppac_begin( 1, 0 )
+    , n_scaler( 0 )
+    , scaler_begin( 1, 0 )
+{
+}
+
+// ########################################################################
+
+void EventBatch::Reset(unsigned int words)
+{
+    n_events = n_e = n_de = n_na = n_ppac = n_scaler = 0;
+
+    // each event and each value needs at least one word
+    if( e_chn.size() < words ) {
+        e_begin.resize(words+1);
+        e_chn.resize(words);
+        e_adc.resize(words);
+        de_begin.resize(words+1);
+        de_chn.resize(words);
+        de_adc.resize(words);
+        na_begin.resize(words+1);
+        na_chn.resize(words);
+        na_adc.resize(words);
+        na_tdc.resize(words);
+        ppac_begin.resize(words+1);
+        ppac_chn.resize(words);
+        ppac_adc.resize(words);
+        ppac_tdc.resize(words);
+        scaler_begin.resize(words+1);
+        scaler_chn.resize(words);
+        scaler.resize(words);
+        has_time.resize(words);
+        time.resize(words);
+        has_pattern.resize(words);
+        pattern.resize(words);
+    }
+    e_begin[0] = de_begin[0] = na_begin[0] = ppac_begin[0] = scaler_begin[0] = 0;
+}
+
+// ########################################################################
+
+void EventBatch::GetEvent(int i, Event& event) const
+{
+    const int b_e = e_begin[i], n_e = std::min(e_begin[i+1] - b_e, int(Event::MAX_E));
+    for(int j=0; j<n_e; ++j) {
+        event.e[j].chn = e_chn[b_e + j];
+        event.e[j].adc = e_adc[b_e + j];
+    }
+    event.n_e = n_e;
+
+    const int b_de = de_begin[i], n_de = std::min(de_begin[i+1] - b_de, int(Event::MAX_DE));
+    for(int j=0; j<n_de; ++j) {
+        event.de[j].chn = de_chn[b_de + j];
+        event.de[j].adc = de_adc[b_de + j];
+    }
+    event.n_de = n_de;
+
+    const int b_na = na_begin[i], n_na = std::min(na_begin[i+1] - b_na, int(Event::MAX_NA));
+    for(int j=0; j<n_na; ++j) {
+        event.na[j].chn = na_chn[b_na + j];
+        event.na[j].adc = na_adc[b_na + j];
+        event.na[j].tdc = na_tdc[b_na + j];
+    }
+    event.n_na = n_na;
+
+    const int b_pp = ppac_begin[i], n_pp = std::min(ppac_begin[i+1] - b_pp, int(Event::MAX_PPAC));
+    for(int j=0; j<n_pp; ++j) {
+        event.ppac[j].chn = ppac_chn[b_pp + j];
+        event.ppac[j].adc = ppac_adc[b_pp + j];
+        event.ppac[j].tdc = ppac_tdc[b_pp + j];
+    }
+    event.n_ppac = n_pp;
+
+    const int b_s = scaler_begin[i], n_s = std::min(scaler_begin[i+1] - b_s, int(Event::MAX_SCALER));
+    for(int j=0; j<n_s; ++j) {
+        event.scaler[j].chn    = scaler_chn[b_s + j];
+        event.scaler[j].scaler = scaler[b_s + j];
+    }
+    event.n_scaler = n_s;
+
+    event.has_time = has_time[i] != 0;
+    event.time = time[i];
+    event.has_pattern = has_pattern[i] != 0;
+    event.pattern = pattern[i];
+}
+
+// ########################################################################
+
+//! Move the values of the kept events to the front of their columns.
+template<class T1, class T2>
+static int keep_values(const std::vector<char>& keep, int n_events, std::vector<int>& begin,
+                       std::vector<T1>& c1, std::vector<T2>& c2, std::vector<T2>* c3 = 0)
+{
+    int n = 0, k = 0;
+    for(int i=0; i<n_events; ++i) {
+        const int b = begin[i], e = begin[i+1];
+        if( keep[i] ) {
+            begin[k++] = n;
+            for(int j=b; j<e; ++j, ++n) {
+                c1[n] = c1[j];
+                c2[n] = c2[j];
+                if( c3 )
+                    (*c3)[n] = (*c3)[j];
+            }
+        }
+    }
+    begin[k] = n;
+    return n;
+}
+
+// ########################################################################
+
+void EventBatch::Keep(const std::vector<char>& keep)
+{
+    n_e      = keep_values(keep, n_events, e_begin, e_chn, e_adc);
+    n_de     = keep_values(keep, n_events, de_begin, de_chn, de_adc);
+    n_na     = keep_values(keep, n_events, na_begin, na_chn, na_adc, &na_tdc);
+    n_ppac   = keep_values(keep, n_events, ppac_begin, ppac_chn, ppac_adc, &ppac_tdc);
+    n_scaler = keep_values(keep, n_events, scaler_begin, scaler_chn, scaler);
+
+    int k = 0;
+    for(int i=0; i<n_events; ++i) {
+        if( keep[i] ) {
+            has_time[k]    = has_time[i];
+            time[k]        = time[i];
+            has_pattern[k] = has_pattern[i];
+            pattern[k]     = pattern[i];
+            k += 1;
+        }
+    }
+    n_events = k;
+}
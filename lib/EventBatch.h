@@ -0,0 +1,134 @@
+/* -*- c++ -*-
+ * EventBatch.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef EVENTBATCH_H_
+#define EVENTBATCH_H_
+
+#include <vector>
+
+struct Event;
+
+//! All events of a buffer, stored as columns.
+/*! The values of one kind are stored one after the other for all
+ *  events, so that calibrations and gates can be applied to all
+ *  values in a simple loop. The values of event i are at the indexes
+ *  from X_begin[i] to X_begin[i+1]-1, e.g. for the SiRi back
+ *  detectors
+ *  <pre>
+ *  for(int i=0; i<batch.n_events; ++i)
+ *      for(int j=batch.e_begin[i]; j<batch.e_begin[i+1]; ++j)
+ *          fill(batch.e_chn[j], batch.e_adc[j]);
+ *  </pre>
+ *  or, for all events at once,
+ *  <pre>
+ *  for(int j=0; j<batch.n_e; ++j)
+ *      fill(batch.e_chn[j], batch.e_adc[j]);
+ *  </pre>
+ */
+struct EventBatch {
+    //! Create an empty batch.
+    EventBatch();
+
+    //! The number of events.
+    int n_events;
+
+    //! The total count of SiRi back detector ADC values.
+    int n_e;
+
+    //! Index of the first SiRi back detector value for each event, and n_e at the end.
+    std::vector<int> e_begin;
+
+    //! The SiRi back detector channel ids.
+    std::vector<unsigned char> e_chn;
+
+    //! The SiRi back detector ADC values.
+    std::vector<unsigned short> e_adc;
+
+    //! The total count of SiRi front detector ADC values.
+    int n_de;
+
+    //! Index of the first SiRi front detector value for each event, and n_de at the end.
+    std::vector<int> de_begin;
+
+    //! The SiRi front detector channel ids.
+    std::vector<unsigned char> de_chn;
+
+    //! The SiRi front detector ADC values.
+    std::vector<unsigned short> de_adc;
+
+    //! The total count of CACTUS TDC and ADC values.
+    int n_na;
+
+    //! Index of the first CACTUS value for each event, and n_na at the end.
+    std::vector<int> na_begin;
+
+    //! The CACTUS channel ids.
+    std::vector<unsigned char> na_chn;
+
+    //! The CACTUS ADC values.
+    std::vector<unsigned short> na_adc;
+
+    //! The CACTUS TDC values.
+    std::vector<unsigned short> na_tdc;
+
+    //! The total count of PPAC TDC and ADC values.
+    int n_ppac;
+
+    //! Index of the first PPAC value for each event, and n_ppac at the end.
+    std::vector<int> ppac_begin;
+
+    //! The PPAC channel ids, i.e. the CACTUS channel ids.
+    std::vector<unsigned char> ppac_chn;
+
+    //! The PPAC ADC values.
+    std::vector<unsigned short> ppac_adc;
+
+    //! The PPAC TDC values.
+    std::vector<unsigned short> ppac_tdc;
+
+    //! The total count of scaler values.
+    int n_scaler;
+
+    //! Index of the first scaler value for each event, and n_scaler at the end.
+    std::vector<int> scaler_begin;
+
+    //! The scaler channel ids.
+    std::vector<unsigned char> scaler_chn;
+
+    //! The scaler values.
+    std::vector<unsigned int> scaler;
+
+    //! Flags indicating that the wall clock time is present.
+    std::vector<char> has_time;
+
+    //! The wall clock times, if present.
+    std::vector<unsigned int> time;
+
+    //! Flags indicating that the TPU pattern is present.
+    std::vector<char> has_pattern;
+
+    //! The TPU patterns, if present.
+    std::vector<unsigned short> pattern;
+
+    //! Remove all events.
+    /*! The columns are made large enough for the events from a buffer
+     *  with 'words' data words.
+     */
+    void Reset(unsigned int words /*!< The size of the buffer to unpack. */);
+
+    //! Copy one event into an Event structure.
+    /*! Values that do not fit into the Event structure are left out.
+     */
+    void GetEvent(int i,         /*!< The index of the event. */
+                  Event& event   /*!< The event structure to fill. */) const;
+
+    //! Keep only some of the events.
+    /*! The remaining events keep their order.
+     */
+    void Keep(const std::vector<char>& keep /*!< Non-zero for each event to keep. */);
+};
+
+#endif /* EVENTBATCH_H_ */
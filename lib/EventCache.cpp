@@ -0,0 +1,484 @@
+/*
+ * EventCache.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "EventCache.h"
+
+#include "Buffer.h"
+#include "EventBatch.h"
+#include "IOPrintf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MISSING_ZSTD
+#include <zstd.h>
+#endif
+#ifndef MISSING_ZLIB
+#include <zlib.h>
+#endif
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The marker at the start of an event cache file.
+static const char MAGIC[8] = { 'S', 'I', 'R', 'E', 'V', 'T', 'C', '1' };
+
+//! The marker at the start of each block.
+static const unsigned int BLOCK_MAGIC = 0x4b4c4245; // "EBLK"
+
+//! Block flag: the block starts a new data file.
+static const unsigned int RESTART = 1;
+
+//! How a column is stored.
+enum { RAW, ZLIB, ZSTD };
+
+//! The compression level; decompression speed matters more than size.
+static const int LEVEL = 1;
+
+//! The header of a block.
+struct BlockHeader {
+    //! BLOCK_MAGIC.
+    unsigned int magic;
+
+    //! Block flags, e.g. RESTART.
+    unsigned int flags;
+
+    //! The number of events.
+    unsigned int n_events;
+
+    //! The total number of each kind of value.
+    unsigned int n_e, n_de, n_na, n_ppac, n_scaler;
+};
+
+//! The header of a column in a block.
+struct ColumnHeader {
+    //! How the column is stored, RAW, ZLIB or ZSTD.
+    unsigned int codec;
+
+    //! The number of bytes stored, without padding.
+    unsigned int size;
+};
+
+//! The number of events after which a block is written.
+/*! Large blocks compress better and are faster to decompress than
+ *  one block per buffer.
+ */
+static const unsigned int BLOCK_EVENTS = 65536;
+
+//! The largest number of events in a block.
+/*! A block is written when it has BLOCK_EVENTS events or more, after
+ *  the batch from one buffer; each event needs at least one word.
+ */
+static const unsigned int MAX_BLOCK_EVENTS = BLOCK_EVENTS + SiriusBuffer::BUFSIZE;
+
+//! Get a pointer to the data of a column, also if it is empty.
+template<class T>
+static T* column(std::vector<T>& v)
+{
+    return v.empty() ? 0 : &v[0];
+}
+
+// ########################################################################
+
+//! Append the first values of a batch column to a column of a block.
+template<class T>
+static void append(std::vector<char>& col, const std::vector<T>& values, unsigned int n)
+{
+    if( n == 0 )
+        return;
+    const size_t pos = col.size();
+    col.resize(pos + n*sizeof(T));
+    std::memcpy(&col[pos], &values[0], n*sizeof(T));
+}
+
+// ########################################################################
+
+//! Append the number of values per event to a column of a block.
+/*! An event has at most 255 data words, so the numbers fit into one byte.
+ */
+static void append_counts(std::vector<char>& col, const std::vector<int>& begin, unsigned int n)
+{
+    const size_t pos = col.size();
+    col.resize(pos + n);
+    for(unsigned int i=0; i<n; ++i)
+        col[pos + i] = begin[i+1] - begin[i];
+}
+
+// ########################################################################
+// ########################################################################
+
+EventCacheWriter::EventCacheWriter()
+    : file( "events" )
+    , restart( true )
+    , n_events_block( 0 )
+    , n_e( 0 )
+    , n_de( 0 )
+    , n_na( 0 )
+    , n_ppac( 0 )
+    , n_scaler( 0 )
+    , zstd_ctx( 0 )
+    , n_blocks( 0 )
+    , n_events( 0 )
+    , n_bytes_raw( 0 )
+    , n_bytes_stored( 0 )
+{
+#ifndef MISSING_ZSTD
+    zstd_ctx = ZSTD_createCCtx();
+#endif
+}
+
+// ########################################################################
+
+EventCacheWriter::~EventCacheWriter()
+{
+    if( file.IsOpen() )
+        Close();
+#ifndef MISSING_ZSTD
+    ZSTD_freeCCtx( (ZSTD_CCtx*)zstd_ctx );
+#endif
+}
+
+// ########################################################################
+
+bool EventCacheWriter::Open(const std::string& fname)
+{
+    if( file.IsOpen() )
+        Close();
+
+    if( !file.Open(fname) || !file.Write(MAGIC, sizeof(MAGIC)) )
+        return false;
+    restart = true;
+    for(int c=0; c<COLUMNS; ++c)
+        columns[c].clear();
+    n_events_block = n_e = n_de = n_na = n_ppac = n_scaler = 0;
+    n_blocks = n_events = n_bytes_raw = n_bytes_stored = 0;
+    return true;
+}
+
+// ########################################################################
+
+void EventCacheWriter::Restart()
+{
+    if( n_events_block > 0 )
+        Flush();
+    restart = true;
+}
+
+// ########################################################################
+
+bool EventCacheWriter::Write(const EventBatch& batch)
+{
+    if( !file.IsOpen() )
+        return false;
+
+    // the same order as in EventCacheReader::Next()
+    const unsigned int n = batch.n_events;
+    append_counts(columns[ 0], batch.e_begin,      n);
+    append_counts(columns[ 1], batch.de_begin,     n);
+    append_counts(columns[ 2], batch.na_begin,     n);
+    append_counts(columns[ 3], batch.ppac_begin,   n);
+    append_counts(columns[ 4], batch.scaler_begin, n);
+
+    append(columns[ 5], batch.has_time,    n);
+    append(columns[ 6], batch.time,        n);
+    append(columns[ 7], batch.has_pattern, n);
+    append(columns[ 8], batch.pattern,     n);
+
+    append(columns[ 9], batch.e_chn,  batch.n_e);
+    append(columns[10], batch.e_adc,  batch.n_e);
+    append(columns[11], batch.de_chn, batch.n_de);
+    append(columns[12], batch.de_adc, batch.n_de);
+
+    append(columns[13], batch.na_chn,   batch.n_na);
+    append(columns[14], batch.na_adc,   batch.n_na);
+    append(columns[15], batch.na_tdc,   batch.n_na);
+    append(columns[16], batch.ppac_chn, batch.n_ppac);
+    append(columns[17], batch.ppac_adc, batch.n_ppac);
+    append(columns[18], batch.ppac_tdc, batch.n_ppac);
+
+    append(columns[19], batch.scaler_chn, batch.n_scaler);
+    append(columns[20], batch.scaler,     batch.n_scaler);
+
+    n_events_block += n;
+    n_e      += batch.n_e;
+    n_de     += batch.n_de;
+    n_na     += batch.n_na;
+    n_ppac   += batch.n_ppac;
+    n_scaler += batch.n_scaler;
+    return n_events_block < BLOCK_EVENTS || Flush();
+}
+
+// ########################################################################
+
+void EventCacheWriter::AddColumn(const std::vector<char>& data)
+{
+    const unsigned int size = data.size();
+    ColumnHeader ch = { RAW, size };
+    const char* out = size > 0 ? &data[0] : 0;
+    if( size > 0 ) {
+#ifndef MISSING_ZSTD
+        packed.resize(ZSTD_compressBound(size));
+        const size_t z = ZSTD_compressCCtx((ZSTD_CCtx*)zstd_ctx, &packed[0], packed.size(), &data[0], size, LEVEL);
+        if( !ZSTD_isError(z) && z < size ) {
+            ch.codec = ZSTD;
+            ch.size = z;
+            out = &packed[0];
+        }
+#elif !defined(MISSING_ZLIB)
+        uLongf z = compressBound(size);
+        packed.resize(z);
+        if( compress2((Bytef*)&packed[0], &z, (const Bytef*)&data[0], size, LEVEL) == Z_OK && z < size ) {
+            ch.codec = ZLIB;
+            ch.size = z;
+            out = &packed[0];
+        }
+#endif
+    }
+
+    // pad to 4 bytes
+    const unsigned int padded = (ch.size + 3) & ~3u;
+    const size_t pos = block.size();
+    block.resize(pos + sizeof(ch) + padded, 0);
+    std::memcpy(&block[pos], &ch, sizeof(ch));
+    if( ch.size > 0 )
+        std::memcpy(&block[pos + sizeof(ch)], out, ch.size);
+
+    n_bytes_raw += size;
+    n_bytes_stored += sizeof(ch) + padded;
+}
+
+// ########################################################################
+
+bool EventCacheWriter::Flush()
+{
+    if( !file.IsOpen() )
+        return false;
+    if( n_events_block == 0 )
+        return true;
+
+    const BlockHeader bh = { BLOCK_MAGIC, restart ? RESTART : 0, n_events_block,
+                             n_e, n_de, n_na, n_ppac, n_scaler };
+    block.resize(sizeof(bh));
+    std::memcpy(&block[0], &bh, sizeof(bh));
+    for(int c=0; c<COLUMNS; ++c) {
+        AddColumn(columns[c]);
+        columns[c].clear();
+    }
+
+    if( !file.Write(&block[0], block.size()) )
+        return false;
+    restart = false;
+    n_blocks += 1;
+    n_events += n_events_block;
+    n_events_block = n_e = n_de = n_na = n_ppac = n_scaler = 0;
+    return true;
+}
+
+// ########################################################################
+
+bool EventCacheWriter::Close()
+{
+    if( !file.IsOpen() || !Flush() || !file.Close() )
+        return false;
+
+    std::cout << "events: wrote " << n_events << " events in " << n_blocks << " blocks to '"
+              << file.GetFilename() << "', " << ioprintf("%.1f", n_bytes_stored/1048576.0) << " MB";
+    if( n_bytes_raw > 0 )
+        std::cout << ioprintf(" (%.0f%% of the columns)", 100.0*n_bytes_stored/n_bytes_raw);
+    std::cout << '.' << std::endl;
+    return true;
+}
+
+// ########################################################################
+
+void EventCacheWriter::Abort()
+{
+    file.Abort();
+}
+
+// ########################################################################
+// ########################################################################
+
+EventCacheReader::EventCacheReader()
+    : map_data( 0 )
+    , map_size( 0 )
+    , map_pos( 0 )
+    , zstd_ctx( 0 )
+{
+#ifndef MISSING_ZSTD
+    zstd_ctx = ZSTD_createDCtx();
+#endif
+}
+
+// ########################################################################
+
+EventCacheReader::~EventCacheReader()
+{
+    Close();
+#ifndef MISSING_ZSTD
+    ZSTD_freeDCtx( (ZSTD_DCtx*)zstd_ctx );
+#endif
+}
+
+// ########################################################################
+
+bool EventCacheReader::Open(const std::string& filename)
+{
+    Close();
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if( fd<0 )
+        return false;
+
+    struct stat st;
+    if( fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MAGIC) ) {
+        close(fd);
+        return false;
+    }
+    void* m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( m == MAP_FAILED )
+        return false;
+    madvise(m, st.st_size, MADV_SEQUENTIAL);
+
+    map_data = (const char*)m;
+    map_size = st.st_size;
+    if( std::memcmp(map_data, MAGIC, sizeof(MAGIC)) != 0 ) {
+        std::cerr << "events: '" << filename << "' is not an event cache file." << std::endl;
+        Close();
+        return false;
+    }
+    map_pos = sizeof(MAGIC);
+    return true;
+}
+
+// ########################################################################
+
+void EventCacheReader::Close()
+{
+    if( map_data )
+        munmap((void*)map_data, map_size);
+    map_data = 0;
+    map_size = map_pos = 0;
+}
+
+// ########################################################################
+
+bool EventCacheReader::GetColumn(void* data, unsigned int size)
+{
+    ColumnHeader ch;
+    if( map_pos + sizeof(ch) > map_size )
+        return false;
+    std::memcpy(&ch, map_data + map_pos, sizeof(ch));
+    map_pos += sizeof(ch);
+
+    const size_t padded = (ch.size + 3) & ~3u;
+    if( map_pos + padded > map_size )
+        return false;
+    const char* in = map_data + map_pos;
+    map_pos += padded;
+
+    if( ch.codec == RAW ) {
+        if( ch.size != size )
+            return false;
+        if( size > 0 )
+            std::memcpy(data, in, size);
+        return true;
+#ifndef MISSING_ZSTD
+    } else if( ch.codec == ZSTD ) {
+        return ZSTD_decompressDCtx((ZSTD_DCtx*)zstd_ctx, data, size, in, ch.size) == size;
+#endif
+#ifndef MISSING_ZLIB
+    } else if( ch.codec == ZLIB ) {
+        uLongf have = size;
+        return uncompress((Bytef*)data, &have, (const Bytef*)in, ch.size) == Z_OK && have == size;
+#endif
+    }
+    return false;
+}
+
+// ########################################################################
+
+bool EventCacheReader::GetCounts(std::vector<int>& begin, unsigned int n_events, unsigned int n_values)
+{
+    counts.resize(n_events);
+    if( !GetColumn(column(counts), n_events) )
+        return false;
+    begin[0] = 0;
+    for(unsigned int i=0; i<n_events; ++i)
+        begin[i+1] = begin[i] + counts[i];
+    return begin[n_events] == (int)n_values;
+}
+
+// ########################################################################
+
+int EventCacheReader::Next(EventBatch& batch, bool& restart)
+{
+    if( map_pos == map_size )
+        return 0;
+
+    BlockHeader bh;
+    if( map_pos + sizeof(bh) > map_size )
+        return -1;
+    std::memcpy(&bh, map_data + map_pos, sizeof(bh));
+    map_pos += sizeof(bh);
+    if( bh.magic != BLOCK_MAGIC )
+        return -1;
+
+    // the counts size the batch, so they must be checked before reading;
+    // an event has at most 255 data words, see append_counts()
+    const unsigned int n = bh.n_events;
+    const unsigned long long n_values = (unsigned long long)bh.n_e + bh.n_de + bh.n_na
+        + bh.n_ppac + bh.n_scaler;
+    if( n > MAX_BLOCK_EVENTS || n_values > 255ull*n )
+        return -1;
+    batch.Reset(std::max(std::max(std::max(n, bh.n_e), std::max(bh.n_de, bh.n_na)),
+                         std::max(std::max(bh.n_ppac, bh.n_scaler), 1u)));
+    // the same order as in EventCacheWriter::Write()
+    const bool ok = GetCounts(batch.e_begin,      n, bh.n_e)
+        &&          GetCounts(batch.de_begin,     n, bh.n_de)
+        &&          GetCounts(batch.na_begin,     n, bh.n_na)
+        &&          GetCounts(batch.ppac_begin,   n, bh.n_ppac)
+        &&          GetCounts(batch.scaler_begin, n, bh.n_scaler)
+
+        && GetColumn(&batch.has_time[0],    n)
+        && GetColumn(&batch.time[0],        n*sizeof(batch.time[0]))
+        && GetColumn(&batch.has_pattern[0], n)
+        && GetColumn(&batch.pattern[0],     n*sizeof(batch.pattern[0]))
+
+        && GetColumn(&batch.e_chn[0],  bh.n_e)
+        && GetColumn(&batch.e_adc[0],  bh.n_e*sizeof(batch.e_adc[0]))
+        && GetColumn(&batch.de_chn[0], bh.n_de)
+        && GetColumn(&batch.de_adc[0], bh.n_de*sizeof(batch.de_adc[0]))
+
+        && GetColumn(&batch.na_chn[0],   bh.n_na)
+        && GetColumn(&batch.na_adc[0],   bh.n_na*sizeof(batch.na_adc[0]))
+        && GetColumn(&batch.na_tdc[0],   bh.n_na*sizeof(batch.na_tdc[0]))
+        && GetColumn(&batch.ppac_chn[0], bh.n_ppac)
+        && GetColumn(&batch.ppac_adc[0], bh.n_ppac*sizeof(batch.ppac_adc[0]))
+        && GetColumn(&batch.ppac_tdc[0], bh.n_ppac*sizeof(batch.ppac_tdc[0]))
+
+        && GetColumn(&batch.scaler_chn[0], bh.n_scaler)
+        && GetColumn(&batch.scaler[0],     bh.n_scaler*sizeof(batch.scaler[0]));
+    if( !ok ) {
+        batch.Reset(0);
+        return -1;
+    }
+
+    batch.n_events = n;
+    batch.n_e      = bh.n_e;
+    batch.n_de     = bh.n_de;
+    batch.n_na     = bh.n_na;
+    batch.n_ppac   = bh.n_ppac;
+    batch.n_scaler = bh.n_scaler;
+    restart = (bh.flags & RESTART) != 0;
+    return 1;
+}
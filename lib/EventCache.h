@@ -0,0 +1,164 @@
+/* -*- c++ -*-
+ * EventCache.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef EVENTCACHE_H_
+#define EVENTCACHE_H_
+
+#include "TmpFile.h"
+
+#include <string>
+#include <vector>
+
+struct EventBatch;
+
+//! Writes a file with unpacked events, for sorting the same data again.
+/*! An event cache file contains blocks of events from many buffers,
+ *  with the columns of an EventBatch. Each column is
+ *  compressed on its own, with zstd if available, otherwise with zlib.
+ *  Sorting from the cache with EventCacheReader skips reading,
+ *  decompressing and unpacking the raw buffers.
+ *
+ *  The cache contains the unpacked values, not calibrated ones, so it
+ *  stays valid when calibrations, gates or binning change. It must be
+ *  written again when the unpacker settings change.
+ *
+ *  The file is in the byte order of the machine writing it: an 8-byte
+ *  magic, then the blocks. Each block starts with a header
+ *  (block magic, flags, the number of events and of each kind of
+ *  value), followed by the columns, each with codec and stored size
+ *  and padded to 4 bytes.
+ */
+class EventCacheWriter {
+public:
+    //! Prepare to write.
+    EventCacheWriter();
+
+    //! Finish the file, see Close().
+    ~EventCacheWriter();
+
+    //! Start writing a cache file.
+    /*! The file is written under a temporary name and renamed when
+     *  closed.
+     *
+     *  \return false if the file cannot be created
+     */
+    bool Open(const std::string& filename /*!< The name of the cache file. */);
+
+    //! Start a new block for the next data file.
+    /*! Events without time are then not assigned the time of an
+     *  event from the file before.
+     */
+    void Restart();
+
+    //! Append the events of a batch.
+    /*! The events are written when enough for a block are collected.
+     *
+     *  \return false if writing failed; the file is then removed
+     */
+    bool Write(const EventBatch& batch /*!< The events to append. */);
+
+    //! Finish the file and give it its final name.
+    /*! \return false if there was an error
+     */
+    bool Close();
+
+    //! Remove an unfinished file.
+    void Abort();
+
+    //! Get the name of the file.
+    const std::string& GetFilename() const
+        { return file.GetFilename(); }
+
+private:
+    //! The number of columns in a block.
+    enum { COLUMNS = 21 };
+
+    //! Write the collected events as one block.
+    /*! \return false if writing failed; the file is then removed
+     */
+    bool Flush();
+
+    //! Compress and append one column to 'block'.
+    void AddColumn(const std::vector<char>& data /*!< The column. */);
+
+    //! The file being written.
+    TmpFile file;
+
+    //! True if the next block starts a new file.
+    bool restart;
+
+    //! The columns of the events collected for the next block.
+    std::vector<char> columns[COLUMNS];
+
+    //! The number of events and values collected for the next block.
+    unsigned int n_events_block, n_e, n_de, n_na, n_ppac, n_scaler;
+
+    //! The block being written.
+    std::vector<char> block;
+
+    //! Space for compressing.
+    std::vector<char> packed;
+
+    //! The compression context, if zstd is used.
+    void* zstd_ctx;
+
+    //! Counters for the message after closing.
+    long long n_blocks, n_events, n_bytes_raw, n_bytes_stored;
+};
+
+// ########################################################################
+
+//! Reads an event cache file written by EventCacheWriter, mapped into memory.
+class EventCacheReader {
+public:
+    //! Prepare to read.
+    EventCacheReader();
+
+    //! Unmap the file.
+    ~EventCacheReader();
+
+    //! Map a cache file.
+    /*! \return false if the file cannot be mapped or is not a cache file
+     */
+    bool Open(const std::string& filename /*!< The name of the cache file. */);
+
+    //! Read the next block.
+    /*! \return 1 for a block, 0 at the end of the file, -1 for error
+     */
+    int Next(EventBatch& batch, /*!< The batch to fill, emptied first. */
+             bool& restart      /*!< Set to true if the block starts a new file. */);
+
+    //! Unmap the file.
+    void Close();
+
+private:
+    //! Decompress the next column of the block.
+    /*! \return false if the column is damaged
+     */
+    bool GetColumn(void* data, unsigned int size);
+
+    //! Make the begin indexes of a batch column from the next column with the values per event.
+    /*! \return false if the column is damaged or does not match the number of values
+     */
+    bool GetCounts(std::vector<int>& begin, unsigned int n_events, unsigned int n_values);
+
+    //! The mapped file.
+    const char* map_data;
+
+    //! The size of the mapped file.
+    size_t map_size;
+
+    //! The reading position in the mapped file.
+    size_t map_pos;
+
+    //! The number of values per event, for one column.
+    std::vector<unsigned char> counts;
+
+    //! The decompression context, if zstd is used.
+    void* zstd_ctx;
+};
+
+#endif /* EVENTCACHE_H_ */
@@ -22,6 +22,15 @@ public:
      */
     virtual Status Open(const std::string& filename, /*!< The name of the file to open.    */
                        int bufnum                   /*!< The buffer number to start from. */) = 0;
+
+    //! Tell which file will be opened after the current one.
+    /*! A fetcher may use this to start reading the next file while
+     *  the end of the current file is sorted. If Open() is called
+     *  with another file, the prepared one is discarded. The default
+     *  implementation does nothing.
+     */
+    virtual void Prepare(const std::string& /*filename*/, /*!< The name of the next file. */
+                         int /*bufnum*/                   /*!< The buffer number to start from. */) { }
 };
 
 #endif /* FILEBUFFERFETCHER_H_ */
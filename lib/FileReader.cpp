@@ -7,7 +7,16 @@
 
 #include "FileReader.h"
 
+#include "aptr.ipp"
 #include "Buffer.h"
+#include "DataCache.h"
+#include "GzIndex.h"
+#include "ParallelGzReader.h"
+#include "StringUtil.h"
+#include "UringReader.h"
+#include "ZstdReader.h"
+
+#include <iostream>
 
 FileReader::FileReader()
     : file_stdio(0)
@@ -27,54 +36,162 @@ FileReader::~FileReader()
 
 // ########################################################################
 
-int FileReader::Read(char* data, unsigned int size_req)
+bool FileReader::IsOpen() const
 {
-    if( errorflag || (!file_stdio
+    return !errorflag && (file_stdio
 #ifndef MISSING_ZLIB
-                      && !file_gz
+                          || file_gz
 #endif
-            ) )
-    {
-        return -1;
-    }
+                          || backend );
+}
 
-    unsigned int have = 0;
+// ########################################################################
+
+int FileReader::Fill(char* data, unsigned int size_req, unsigned int& have)
+{
+    int now = 1;
     while( have<size_req ) {
-        int now = -1;
+        now = -1;
         if( file_stdio )
             now = std::fread(data+have, 1, size_req-have, file_stdio);
 #ifndef MISSING_ZLIB
         else if( file_gz )
             now = gzread(file_gz, data+have, size_req-have);
 #endif
-        if( now<=0 ) {
-            errorflag = (now<0 || (have!= 0 && have!=size_req));
-            Close();
-            return errorflag ? -1 : 0;
-        } else {
-            have += now;
-        }
+        else if( backend )
+            now = backend->Read(data+have, size_req-have);
+        if( now<=0 )
+            break;
+        have += now;
+    }
+    return now;
+}
+
+// ########################################################################
+
+int FileReader::Read(char* data, unsigned int size_req)
+{
+    if( !IsOpen() )
+        return -1;
+
+    unsigned int have = 0;
+    const int now = Fill(data, size_req, have);
+    if( now<=0 ) {
+        errorflag = (now<0 || (have!= 0 && have!=size_req));
+        if( !errorflag && cache_copy )
+            cache_copy->Finish();
+        Close();
+        return errorflag ? -1 : 0;
     }
+    if( cache_copy && !cache_copy->Write(data, have) )
+        cache_copy.reset( 0 );
     return 1;
 }
 
 // ########################################################################
 
-bool FileReader::Open(const std::string & filename, unsigned int want)
+int FileReader::ReadSome(char* data, unsigned int size_req)
+{
+    if( !IsOpen() )
+        return -1;
+
+    unsigned int have = 0;
+    const int now = Fill(data, size_req, have);
+    if( now<0 || have == 0 ) {
+        // the end of the file is only reported when nothing is left
+        errorflag = (now<0);
+        if( !errorflag && cache_copy )
+            cache_copy->Finish();
+        Close();
+        return errorflag ? -1 : 0;
+    }
+    if( cache_copy && !cache_copy->Write(data, have) )
+        cache_copy.reset( 0 );
+    return have;
+}
+
+// ########################################################################
+
+bool FileReader::Open(const std::string & filename, off_t want)
 {
     Close();
-    if( filename.find(".gz") == filename.size()-3 ) {
+    const bool is_gz  = ends_with(filename, ".gz");
+    const bool is_zst = ends_with(filename, ".zst");
+    if( (is_gz || is_zst) && DataCache::IsEnabled() ) {
+        const std::string copy = DataCache::Find(filename);
+        if( !copy.empty() ) {
+            if( OpenPlain(copy, want) )
+                return true;
+            // removed since Find(), e.g. by another reader making room
+            Close();
+        }
+        if( want == 0 ) {
+            // copy while reading; only complete files end up in the cache
+            cache_copy.reset( new DataCache() );
+            if( !cache_copy->Start(filename) )
+                cache_copy.reset( 0 );
+        }
+    }
+
+    if( is_gz ) {
 #ifndef MISSING_ZLIB
+        if( want > 0 ) {
+            // gzseek would decompress everything before 'want'
+            GzIndexReader* gzidx = new GzIndexReader();
+            backend.reset( gzidx );
+            if( gzidx->Open(filename, want) ) {
+                errorflag = false;
+                return true;
+            }
+            std::cerr << "gzindex: falling back to gzseek for '" << filename << "'." << std::endl;
+            backend.reset( 0 );
+        } else if( ParallelGzReader::GetThreads() > 0 ) {
+            ParallelGzReader* gzpar = new ParallelGzReader();
+            backend.reset( gzpar );
+            const int p = gzpar->Open(filename);
+            if( p != 0 ) {
+                errorflag = (p < 0);
+                if( errorflag )
+                    backend.reset( 0 );
+                return !errorflag;
+            }
+            // not many members, use gzread
+            backend.reset( 0 );
+        }
         file_gz = gzopen(filename.c_str(), "rb");
         errorflag = (file_gz == 0)
-            || gzseek(file_gz, want, SEEK_SET) != (int)want;
+            || gzseek(file_gz, want, SEEK_SET) != want;
 #else
         errorflag = true;
 #endif
+    } else if( is_zst ) {
+#ifndef MISSING_ZSTD
+        ZstdReader* zstd = new ZstdReader();
+        backend.reset( zstd );
+        errorflag = !zstd->Open(filename, want);
+#else
+        errorflag = true;
+#endif
+    } else {
+        return OpenPlain(filename, want);
+    }
+    if( errorflag )
+        cache_copy.reset( 0 );
+    return !errorflag;
+}
+
+// ########################################################################
+
+bool FileReader::OpenPlain(const std::string & filename, off_t want)
+{
+    if( UringReader::GetDepth() > 0 ) {
+        UringReader* uring = new UringReader();
+        backend.reset( uring );
+        errorflag = !uring->Open(filename, want);
     } else {
         file_stdio = fopen(filename.c_str(), "rb");
         errorflag = (file_stdio == 0)
-            || std::fseek(file_stdio, want, SEEK_SET) != (int)want;
+            || fseeko(file_stdio, want, SEEK_SET) != 0;
     }
     return !errorflag;
 }
@@ -93,4 +210,6 @@ void FileReader::Close()
         file_gz = 0;
     }
 #endif
+    backend.reset( 0 );
+    cache_copy.reset( 0 );
 }
@@ -8,21 +8,37 @@
 #ifndef FILEREADER_H_
 #define FILEREADER_H_
 
+#include "aptr.h"
+
 #include <string>
 #include <cstdio>
+#include <sys/types.h>
 #ifndef MISSING_ZLIB
 #include <zlib.h>
 #endif
 
 class Buffer;
+class DataCache;
+class FileReaderBackend;
 
 //! Class for reading buffers from a file.
 /*! This class performs the actual reading for both
  *  STFileBufferFetcher and MTFileBufferFetcher.
  *  
- * It can be compiled to read both files compressed with gzip
- * (filename ending with <code>.gz</code>) and not compressed files
- * (any other ending).
+ * It can be compiled to read files compressed with gzip (filename
+ * ending with <code>.gz</code>) or Zstandard (<code>.zst</code>) and
+ * not compressed files (any other ending).
+ *
+ * Seeking in gzip files uses a GzIndex, so that only a bounded
+ * amount of data has to be decompressed. Gzip files with many
+ * members are decompressed in parallel by a ParallelGzReader.
+ * Uncompressed files can be read with many reads in flight by an
+ * UringReader. Zstandard files are read by a ZstdReader, which can
+ * seek quickly in files with a seek table.
+ *
+ * If a DataCache is configured, compressed files are read from their
+ * decompressed copy in the cache, and files without copy are copied
+ * while they are read.
  */
 class FileReader {
 public:
@@ -35,7 +51,7 @@ public:
     /*! \return true if both opening and seeking were successful.
      */
     bool Open(const std::string& filename, /*!< The name of the file to open. */
-              unsigned int seekpos         /*!< At which byte to position for reading. */);
+              off_t seekpos                /*!< At which byte to position for reading. */);
 
     //! Read a buffer from the file.
     /*! \return 1 for new buffer, 0 for end of file, -1 for error.
@@ -43,6 +59,15 @@ public:
     int Read(char* data,       /*!< The buffer to sore the file data into. */
              unsigned int size /*!< how many bytes to read. */);
 
+    //! Read up to a number of bytes from the file.
+    /*! Unlike Read(), less data than requested is not an error; this
+     *  is for files that do not consist of whole buffers.
+     *
+     *  \return the number of bytes read, 0 for end of file, -1 for error.
+     */
+    int ReadSome(char* data,       /*!< The buffer to sore the file data into. */
+                 unsigned int size /*!< The maximum number of bytes to read. */);
+
     //! Retrieve error flag.
     /*! \return The error flag.
      */
@@ -53,6 +78,23 @@ private:
     //! Close the file, reset the error flag.
     void Close();
 
+    //! Check if a file is open and there was no error.
+    bool IsOpen() const;
+
+    //! Read until 'size' bytes are there or the file ends.
+    /*! \return the result of the last read: > 0 if 'size' bytes are
+     *          there, 0 at the end of the file, -1 for error
+     */
+    int Fill(char* data,        /*!< The buffer to sore the file data into. */
+             unsigned int size, /*!< How many bytes to read. */
+             unsigned int& have /*!< The number of bytes read, counting up. */);
+
+    //! Open an uncompressed file and go to the specified position.
+    /*! \return true if both opening and seeking were successful.
+     */
+    bool OpenPlain(const std::string& filename, /*!< The name of the file to open. */
+                   off_t seekpos                /*!< At which byte to position for reading. */);
+
     //! The object for reading uncompressed files.
     std::FILE* file_stdio;
 
@@ -61,6 +103,12 @@ private:
     gzFile     file_gz;
 #endif
 
+    //! The object for reading files in special ways.
+    aptr<FileReaderBackend> backend;
+
+    //! The copy of a compressed file being written to the cache, or 0.
+    aptr<DataCache> cache_copy;
+
     //! The error flag.
     bool errorflag;
 };
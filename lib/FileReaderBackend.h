@@ -0,0 +1,26 @@
+/* -*- c++ -*-
+ * FileReaderBackend.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef FILEREADERBACKEND_H_
+#define FILEREADERBACKEND_H_
+
+//! Interface for reading file data in ways other than stdio or gzFile.
+/*! FileReader uses a backend for special cases like seeking in or
+ *  parallel decompression of gzip files.
+ */
+class FileReaderBackend {
+public:
+    //! Virtual no-op destructor.
+    virtual ~FileReaderBackend() { }
+
+    //! Read data from the file.
+    /*! \return the number of bytes read, 0 at the end of the file, or -1 for error
+     */
+    virtual int Read(char* data,       /*!< Where to store the data. */
+                     unsigned int size /*!< How many bytes to read at most. */) = 0;
+};
+
+#endif /* FILEREADERBACKEND_H_ */
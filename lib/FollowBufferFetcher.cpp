@@ -0,0 +1,258 @@
+/*
+ * FollowBufferFetcher.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "FollowBufferFetcher.h"
+
+#include "StringUtil.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! How long Next() waits for data before returning WAIT, in ms.
+static const int WAIT_MS = 250;
+
+//! How long to wait for more data after the writer closed the file, in s.
+static const int CLOSE_SECONDS = 30;
+
+// ########################################################################
+// ########################################################################
+
+FollowBufferFetcher::FollowBufferFetcher(bool wd, int idle)
+    : inotify_fd( -1 )
+    , file_wd( -1 )
+    , dir_wd( -1 )
+    , watch_directory( wd )
+    , idle_seconds( idle )
+    , fd( -1 )
+    , finished( false )
+    , closed( false )
+    , reopens( false )
+    , closed_at( 0 )
+    , have( 0 )
+{
+}
+
+// ########################################################################
+
+FollowBufferFetcher::~FollowBufferFetcher()
+{
+    Close();
+}
+
+// ########################################################################
+
+void FollowBufferFetcher::Close()
+{
+    CloseFile();
+    if( inotify_fd >= 0 ) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    dir_wd = -1;
+    queue.clear();
+}
+
+// ########################################################################
+
+void FollowBufferFetcher::CloseFile()
+{
+    if( file_wd >= 0 && inotify_fd >= 0 )
+        inotify_rm_watch(inotify_fd, file_wd);
+    file_wd = -1;
+    if( fd >= 0 ) {
+        close(fd);
+        fd = -1;
+    }
+    have = 0;
+    finished = false;
+    closed = false;
+    reopens = false;
+    byte_order.Reset();
+}
+
+// ########################################################################
+
+BufferFetcher::Status FollowBufferFetcher::Open(const std::string& fname, int bufnum)
+{
+    Close();
+    if( ends_with(fname, ".gz") || ends_with(fname, ".zst") ) {
+        std::cerr << "follow: cannot follow compressed file '" << fname << "'." << std::endl;
+        return ERROR;
+    }
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if( inotify_fd < 0 ) {
+        std::cerr << "follow: inotify not available: " << std::strerror(errno) << std::endl;
+        return ERROR;
+    }
+
+    const std::string::size_type slash = fname.rfind('/');
+    directory = (slash == std::string::npos) ? "./" : fname.substr(0, slash+1);
+    if( watch_directory ) {
+        dir_wd = inotify_add_watch(inotify_fd, directory.c_str(), IN_CREATE | IN_MOVED_TO);
+        if( dir_wd < 0 ) {
+            std::cerr << "follow: cannot watch directory '" << directory << "'." << std::endl;
+            return ERROR;
+        }
+    }
+
+    return OpenFile(fname, off_t(bufnum)*buffer.GetSize()*4) ? OKAY : ERROR;
+}
+
+// ########################################################################
+
+bool FollowBufferFetcher::OpenFile(const std::string& fname, off_t pos)
+{
+    CloseFile();
+    filename = fname;
+
+    // watch before opening, so that no event is missed
+    file_wd = inotify_add_watch(inotify_fd, filename.c_str(),
+                                IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+    fd = open(filename.c_str(), O_RDONLY);
+    if( file_wd < 0 || fd < 0 || lseek(fd, pos, SEEK_SET) != pos ) {
+        std::cerr << "follow: cannot open '" << filename << "'." << std::endl;
+        CloseFile();
+        return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool FollowBufferFetcher::WaitEvents(int timeout_ms)
+{
+    pollfd pfd;
+    pfd.fd = inotify_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if( poll(&pfd, 1, timeout_ms) <= 0 )
+        return false;
+
+    // inotify_event has a variable length name
+    char events[4096] __attribute__ ((aligned(__alignof__(inotify_event))));
+    bool any = false;
+    while( true ) {
+        const ssize_t n = read(inotify_fd, events, sizeof(events));
+        if( n <= 0 )
+            break;
+        for(const char* p = events; p < events + n; ) {
+            const inotify_event* ev = (const inotify_event*)p;
+            p += sizeof(inotify_event) + ev->len;
+            any = true;
+
+            if( ev->wd == file_wd ) {
+                if( ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF) )
+                    finished = true;
+                if( (ev->mask & IN_MODIFY) && closed ) {
+                    // the writer opens the file again for each buffer
+                    closed = false;
+                    reopens = true;
+                }
+                if( (ev->mask & IN_CLOSE_WRITE) && !reopens ) {
+                    closed = true;
+                    closed_at = time(0);
+                }
+            } else if( ev->wd == dir_wd && ev->len > 0 ) {
+                const std::string name = ev->name;
+                if( name[0] == '.' || ends_with(name, ".gzidx") || ends_with(name, ".bufidx")
+                    || ends_with(name, ".tmp") || ends_with(name, ".gz") || ends_with(name, ".zst") )
+                    continue;
+                const std::string path = directory + name;
+                if( path == filename )
+                    continue;
+                std::cout << "\nfollow: new file '" << path << "'" << std::endl;
+                queue.push_back(path);
+            }
+        }
+    }
+    return any;
+}
+
+// ########################################################################
+
+const Buffer* FollowBufferFetcher::Next(Status& state)
+{
+    if( inotify_fd < 0 ) {
+        state = ERROR;
+        return 0;
+    }
+
+    const unsigned int bytes = buffer.GetSize()*4;
+    char* data = (char*)buffer.GetBuffer();
+    while( true ) {
+        if( fd < 0 ) {
+            // waiting for a new file in the directory
+            if( !queue.empty() ) {
+                const std::string next = queue.front();
+                queue.pop_front();
+                std::cout << "\nfollow: continuing with '" << next << "'" << std::endl;
+                if( !OpenFile(next, 0) ) {
+                    state = ERROR;
+                    return 0;
+                }
+            } else if( !WaitEvents(WAIT_MS) ) {
+                state = WAIT;
+                return 0;
+            }
+            continue;
+        }
+
+        const ssize_t n = read(fd, data + have, bytes - have);
+        if( n < 0 && errno == EINTR )
+            continue;
+        if( n < 0 ) {
+            state = ERROR;
+            return 0;
+        }
+        if( n > 0 ) {
+            have += n;
+            if( have == bytes ) {
+                have = 0;
+                byte_order.Fix(buffer.GetBuffer(), buffer.GetSize());
+                state = OKAY;
+                return &buffer;
+            }
+            continue;
+        }
+
+        // at the end of the file; a new file in the directory also
+        // means that this one is complete
+        const time_t now = time(0);
+        struct stat st;
+        const bool idle = idle_seconds > 0 && fstat(fd, &st) == 0
+            && now >= st.st_mtime + idle_seconds;
+        const bool done = closed && now >= closed_at + CLOSE_SECONDS;
+        if( finished || done || idle || !queue.empty() ) {
+            if( have != 0 ) {
+                std::cerr << "\nfollow: incomplete buffer at the end of '" << filename << "'." << std::endl;
+                state = ERROR;
+                return 0;
+            }
+            CloseFile();
+            if( !watch_directory ) {
+                state = END;
+                return 0;
+            }
+            continue;
+        }
+
+        if( !WaitEvents(WAIT_MS) ) {
+            state = WAIT;
+            return 0;
+        }
+    }
+}
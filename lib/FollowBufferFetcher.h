@@ -0,0 +1,117 @@
+/* -*- c++ -*-
+ * FollowBufferFetcher.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef FOLLOWBUFFERFETCHER_H_
+#define FOLLOWBUFFERFETCHER_H_
+
+#include "Buffer.h"
+#include "ByteOrder.h"
+#include "FileBufferFetcher.h"
+
+#include <ctime>
+#include <deque>
+#include <string>
+#include <sys/types.h>
+
+//! Fetch buffers from a file that is still being written.
+/*! At the end of the file, Next() waits for the file to grow, using
+ *  inotify to wake up, and returns WAIT if no complete buffer arrived
+ *  within a short time. The file is finished when it is deleted or
+ *  renamed, or when it has not been modified for 'idle_seconds'; a
+ *  file written completely long before therefore ends as soon
+ *  as it has been read. When the writer closes the file, it is
+ *  finished if no more data arrive within half a minute; if the file
+ *  grows again after a close, the writer appends and closes for each
+ *  buffer, and later closes are ignored.
+ *
+ *  Optionally, the directory of the file is watched for new files. A
+ *  new file means that the current one is finished; new files are
+ *  queued and followed one after the other, and Next() returns WAIT
+ *  while waiting for the next file instead of END.
+ *
+ *  Only uncompressed files can be followed.
+ */
+class FollowBufferFetcher : public FileBufferFetcher {
+public:
+    //! Construct the buffer fetcher.
+    FollowBufferFetcher(bool watch_directory, /*!< True to follow new files in the directory. */
+                        int idle_seconds      /*!< Finish a file after no changes for this long, 0 for never. */);
+
+    //! Closes the file and inotify.
+    ~FollowBufferFetcher();
+
+    Status Open(const std::string& filename, int bufnum);
+
+    const Buffer* Next(Status& state);
+
+private:
+    //! Open a file and add an inotify watch for it.
+    /*! \return false in case of error
+     */
+    bool OpenFile(const std::string& filename, /*!< The name of the file. */
+                  off_t pos                    /*!< Where to start reading. */);
+
+    //! Close the current file.
+    void CloseFile();
+
+    //! Close the file and inotify.
+    void Close();
+
+    //! Wait for inotify events and handle them.
+    /*! \return true if there were events
+     */
+    bool WaitEvents(int timeout_ms /*!< How long to wait at most. */);
+
+    //! The inotify file descriptor.
+    int inotify_fd;
+
+    //! The watch descriptor for the current file, or -1.
+    int file_wd;
+
+    //! The watch descriptor for the directory, or -1.
+    int dir_wd;
+
+    //! True to watch the directory for new files.
+    const bool watch_directory;
+
+    //! Finish a file when it has not been modified for this many seconds, 0 for never.
+    const int idle_seconds;
+
+    //! The current file, or -1.
+    int fd;
+
+    //! The name of the current file.
+    std::string filename;
+
+    //! The directory of the first file, with '/' at the end.
+    std::string directory;
+
+    //! True if the file has been removed or renamed.
+    bool finished;
+
+    //! True if the writer has closed the file and no data arrived since.
+    bool closed;
+
+    //! True if the file was modified after a close; closes are then ignored.
+    bool reopens;
+
+    //! The time of the last close by the writer.
+    time_t closed_at;
+
+    //! New files found in the directory.
+    std::deque<std::string> queue;
+
+    //! The buffer to read into.
+    SiriusBuffer buffer;
+
+    //! The number of bytes in 'buffer'.
+    unsigned int have;
+
+    //! The byte order of the followed file.
+    ByteOrder byte_order;
+};
+
+#endif /* FOLLOWBUFFERFETCHER_H_ */
@@ -0,0 +1,440 @@
+/*
+ * GzIndex.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef MISSING_ZLIB
+
+#include "GzIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The distance between access points in the uncompressed data.
+static const off_t SPAN = 8*1024*1024;
+
+//! The size of the input buffer for compressed data.
+static const unsigned int CHUNK = 256*1024;
+
+//! The marker at the end of a sidecar file.
+static const char MAGIC[8] = { 'S', 'I', 'R', 'G', 'Z', 'I', 'X', '1' };
+
+// ########################################################################
+
+static bool write64(std::FILE* f, long long v)
+{
+    return std::fwrite(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool read64(std::FILE* f, long long& v)
+{
+    return std::fread(&v, sizeof(v), 1, f) == 1;
+}
+
+// ########################################################################
+// ########################################################################
+
+GzIndex::GzIndex(const std::string& gzfilename)
+    : filename( gzfilename )
+    , indexname( gzfilename + ".gzidx" )
+    , src_size( -1 )
+    , src_mtime( 0 )
+    , complete( false )
+    , total( 0 )
+    , idxfile( 0 )
+{
+    struct stat st;
+    if( stat(filename.c_str(), &st) == 0 ) {
+        src_size  = st.st_size;
+        src_mtime = st.st_mtime;
+    }
+}
+
+// ########################################################################
+
+GzIndex::~GzIndex()
+{
+    if( idxfile )
+        std::fclose(idxfile);
+}
+
+// ########################################################################
+
+bool GzIndex::Prepare(off_t want)
+{
+    if( src_size < 0 )
+        return false;
+
+    if( !Load() ) {
+        points.clear();
+        complete = false;
+        if( idxfile )
+            std::fclose(idxfile);
+        idxfile = std::fopen(indexname.c_str(), "w+b");
+        if( !idxfile ) {
+            std::cerr << "gzindex: cannot write index file '" << indexname << "'." << std::endl;
+            return false;
+        }
+    }
+
+    const off_t covered = points.empty() ? 0 : points.back().out;
+    if( complete || want < covered + SPAN )
+        return true;
+    return Extend(want);
+}
+
+// ########################################################################
+
+const GzIndex::Point* GzIndex::Find(off_t want) const
+{
+    int lo = 0, hi = points.size();
+    while( hi-lo > 1 ) {
+        const int mid = (lo+hi)/2;
+        if( points[mid].out <= want )
+            lo = mid;
+        else
+            hi = mid;
+    }
+    if( points.empty() || points[lo].out > want )
+        return 0;
+    return &points[lo];
+}
+
+// ########################################################################
+
+bool GzIndex::ReadWindow(const Point& p, unsigned char* window) const
+{
+    if( p.wlen <= 0 || p.wlen > (long long)compressBound(WINSIZE) )
+        return false;
+
+    std::vector<unsigned char> z(p.wlen);
+    if( fseeko(idxfile, p.wpos, SEEK_SET) != 0
+        || std::fread(&z[0], 1, p.wlen, idxfile) != (size_t)p.wlen )
+        return false;
+
+    uLongf wsize = WINSIZE;
+    return uncompress(window, &wsize, &z[0], p.wlen) == Z_OK && wsize == WINSIZE;
+}
+
+// ########################################################################
+
+bool GzIndex::Load()
+{
+    idxfile = std::fopen(indexname.c_str(), "r+b");
+    if( !idxfile )
+        return false;
+
+    const long TRAILER = sizeof(MAGIC) + 6*8;
+    char magic[sizeof(MAGIC)];
+    long long size, mtime, npoints, table_pos, ttl, cmplt;
+    if( fseeko(idxfile, -TRAILER, SEEK_END) != 0 )
+        return false;
+    const long long trailer_pos = ftello(idxfile);
+    if( std::fread(magic, sizeof(magic), 1, idxfile) != 1
+        || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+        || !read64(idxfile, size) || !read64(idxfile, mtime)
+        || !read64(idxfile, npoints) || !read64(idxfile, table_pos)
+        || !read64(idxfile, ttl) || !read64(idxfile, cmplt) )
+        return false;
+    if( size != src_size || mtime != src_mtime ) {
+        std::cout << "gzindex: '" << filename << "' has changed, rebuilding index." << std::endl;
+        return false;
+    }
+
+    // the table is just before the trailer; a damaged file must not
+    // make a huge allocation
+    const long long POINT = 5*8;
+    if( table_pos < 0 || table_pos > trailer_pos || npoints != (trailer_pos - table_pos) / POINT
+        || (trailer_pos - table_pos) % POINT != 0 ) {
+        std::cout << "gzindex: '" << indexname << "' is damaged, rebuilding index." << std::endl;
+        return false;
+    }
+    if( fseeko(idxfile, table_pos, SEEK_SET) != 0 )
+        return false;
+    points.resize(npoints);
+    for(long long i=0; i<npoints; ++i) {
+        long long out, in, wpos, bits, wlen;
+        if( !read64(idxfile, out) || !read64(idxfile, in) || !read64(idxfile, wpos)
+            || !read64(idxfile, bits) || !read64(idxfile, wlen) )
+            return false;
+        Point& p = points[i];
+        p.out  = out;
+        p.in   = in;
+        p.wpos = wpos;
+        p.bits = bits;
+        p.wlen = wlen;
+    }
+    total    = ttl;
+    complete = (cmplt != 0);
+    return true;
+}
+
+// ########################################################################
+
+bool GzIndex::Extend(off_t want)
+{
+    std::vector<unsigned char> window(WINSIZE, 0);
+    const Point* last = points.empty() ? 0 : &points.back();
+    if( last && !ReadWindow(*last, &window[0]) )
+        return false;
+
+    GzIndexReader reader;
+    if( !reader.Start(filename, last, &window[0]) )
+        return false;
+
+    // the window is used as a circular buffer for the output; the
+    // oldest data are at 'wpos'
+    unsigned int wpos = 0;
+    std::vector<unsigned char> ordered(WINSIZE), z(compressBound(WINSIZE));
+    while( reader.pos_out < want ) {
+        const int n = reader.Inflate(&window[wpos], WINSIZE-wpos, Z_BLOCK);
+        if( n < 0 ) {
+            std::cerr << "gzindex: error decompressing '" << filename << "'." << std::endl;
+            return false;
+        }
+        wpos = (wpos + n) % WINSIZE;
+        if( reader.at_end ) {
+            complete = true;
+            total = reader.pos_out;
+            break;
+        }
+        if( !reader.AtBlockEnd() || (!points.empty() && reader.pos_out - points.back().out <= SPAN) )
+            continue;
+
+        // add an access point at this block boundary
+        std::copy(window.begin()+wpos, window.end(), ordered.begin());
+        std::copy(window.begin(), window.begin()+wpos, ordered.begin()+(WINSIZE-wpos));
+        uLongf zlen = z.size();
+        if( compress2(&z[0], &zlen, &ordered[0], WINSIZE, 6) != Z_OK )
+            return false;
+
+        Point p;
+        p.out  = reader.pos_out;
+        p.in   = reader.PosIn();
+        p.bits = reader.strm.data_type & 7;
+        fseeko(idxfile, 0, SEEK_END);
+        p.wpos = ftello(idxfile);
+        p.wlen = zlen;
+        if( std::fwrite(&z[0], 1, zlen, idxfile) != zlen )
+            return false;
+        points.push_back(p);
+    }
+    return WriteTable();
+}
+
+// ########################################################################
+
+bool GzIndex::WriteTable()
+{
+    // the table is always appended, so an interrupted write cannot
+    // damage a table that was written before
+    if( fseeko(idxfile, 0, SEEK_END) != 0 )
+        return false;
+    const long long table_pos = ftello(idxfile);
+    bool ok = true;
+    for(unsigned int i=0; i<points.size(); ++i) {
+        const Point& p = points[i];
+        ok = ok && write64(idxfile, p.out) && write64(idxfile, p.in)
+            && write64(idxfile, p.wpos) && write64(idxfile, p.bits)
+            && write64(idxfile, p.wlen);
+    }
+    ok = ok && std::fwrite(MAGIC, sizeof(MAGIC), 1, idxfile) == 1
+        && write64(idxfile, src_size) && write64(idxfile, src_mtime)
+        && write64(idxfile, points.size()) && write64(idxfile, table_pos)
+        && write64(idxfile, total) && write64(idxfile, complete ? 1 : 0);
+    ok = ok && std::fflush(idxfile) == 0;
+    if( !ok )
+        std::cerr << "gzindex: error writing index file '" << indexname << "'." << std::endl;
+    return ok;
+}
+
+// ########################################################################
+// ########################################################################
+
+GzIndexReader::GzIndexReader()
+    : file( 0 )
+    , strm_ok( false )
+    , raw( false )
+    , at_end( true )
+    , input( CHUNK )
+    , input_start( 0 )
+    , pos_out( 0 )
+{
+    std::memset(&strm, 0, sizeof(strm));
+}
+
+// ########################################################################
+
+GzIndexReader::~GzIndexReader()
+{
+    Close();
+}
+
+// ########################################################################
+
+void GzIndexReader::Close()
+{
+    if( strm_ok ) {
+        inflateEnd(&strm);
+        strm_ok = false;
+    }
+    if( file ) {
+        std::fclose(file);
+        file = 0;
+    }
+    at_end = true;
+}
+
+// ########################################################################
+
+bool GzIndexReader::Open(const std::string& filename, off_t want)
+{
+    GzIndex index(filename);
+    if( !index.Prepare(want) )
+        return false;
+
+    const GzIndex::Point* p = index.Find(want);
+    std::vector<unsigned char> window(GzIndex::WINSIZE);
+    if( p && !index.ReadWindow(*p, &window[0]) )
+        return false;
+    if( !Start(filename, p, &window[0]) )
+        return false;
+
+    // decompress up to the wanted position
+    std::vector<unsigned char> skip(CHUNK);
+    while( pos_out < want ) {
+        const int n = Inflate(&skip[0], std::min(off_t(CHUNK), want-pos_out), Z_NO_FLUSH);
+        if( n <= 0 ) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool GzIndexReader::Start(const std::string& filename, const GzIndex::Point* p,
+                          const unsigned char* window)
+{
+    Close();
+    file = std::fopen(filename.c_str(), "rb");
+    if( !file )
+        return false;
+
+    const off_t start = p ? p->in - (p->bits ? 1 : 0) : 0;
+    if( fseeko(file, start, SEEK_SET) != 0 ) {
+        Close();
+        return false;
+    }
+    input_start = start;
+    strm.next_in  = &input[0];
+    strm.avail_in = 0;
+
+    // 47 = 15 + 32: window size 32kB, automatic gzip header detection
+    raw = (p != 0);
+    if( inflateInit2(&strm, raw ? -15 : 47) != Z_OK )
+        return false;
+    strm_ok = true;
+    at_end = false;
+    pos_out = p ? p->out : 0;
+
+    if( p ) {
+        if( p->bits ) {
+            if( !Fill() ) {
+                Close();
+                return false;
+            }
+            const int c = *strm.next_in;
+            strm.next_in  += 1;
+            strm.avail_in -= 1;
+            inflatePrime(&strm, p->bits, c >> (8 - p->bits));
+        }
+        inflateSetDictionary(&strm, window, GzIndex::WINSIZE);
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool GzIndexReader::Fill()
+{
+    input_start = PosIn();
+    const size_t n = std::fread(&input[0], 1, input.size(), file);
+    strm.next_in  = &input[0];
+    strm.avail_in = n;
+    return n > 0;
+}
+
+// ########################################################################
+
+int GzIndexReader::Read(char* data, unsigned int size)
+{
+    if( !strm_ok )
+        return -1;
+    if( at_end )
+        return 0;
+    return Inflate((unsigned char*)data, size, Z_NO_FLUSH);
+}
+
+// ########################################################################
+
+int GzIndexReader::Inflate(unsigned char* out, unsigned int size, int flush)
+{
+    strm.next_out  = out;
+    strm.avail_out = size;
+    while( strm.avail_out > 0 && !at_end ) {
+        if( strm.avail_in == 0 && !Fill() )
+            // file ends inside a gzip member
+            return -1;
+
+        const unsigned int before = strm.avail_out;
+        const int ret = inflate(&strm, flush);
+        pos_out += before - strm.avail_out;
+
+        if( ret == Z_STREAM_END ) {
+            const int nm = NextMember();
+            if( nm < 0 )
+                return -1;
+            else if( nm == 0 )
+                at_end = true;
+        } else if( ret != Z_OK && ret != Z_BUF_ERROR ) {
+            return -1;
+        } else if( flush == Z_BLOCK && AtBlockEnd() ) {
+            break;
+        }
+    }
+    return size - strm.avail_out;
+}
+
+// ########################################################################
+
+int GzIndexReader::NextMember()
+{
+    if( raw ) {
+        // skip the gzip trailer with CRC32 and size
+        for(int i=0; i<8; ++i) {
+            if( strm.avail_in == 0 && !Fill() )
+                return -1;
+            strm.next_in  += 1;
+            strm.avail_in -= 1;
+        }
+    }
+    if( strm.avail_in == 0 && !Fill() )
+        return std::ferror(file) ? -1 : 0;
+
+    // like gzip, ignore trailing data that is not a gzip member
+    if( *strm.next_in != 0x1f )
+        return 0;
+
+    raw = false;
+    return inflateReset2(&strm, 47) == Z_OK ? 1 : -1;
+}
+
+#endif /* MISSING_ZLIB */
@@ -0,0 +1,205 @@
+/* -*- c++ -*-
+ * GzIndex.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef GZINDEX_H_
+#define GZINDEX_H_
+
+#ifndef MISSING_ZLIB
+
+#include "FileReaderBackend.h"
+
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include <zlib.h>
+
+//! An index of access points into a gzip file.
+/*! An access point stores the state of the decompressor at a deflate
+ *  block boundary: the positions in the compressed and uncompressed
+ *  data and the last 32kB of uncompressed data. Decompression can
+ *  start at any access point, so seeking needs to decompress at most
+ *  the data between two access points (like zran.c from the zlib
+ *  examples).
+ *
+ *  The index is stored in a sidecar file next to the gzip file (name
+ *  with <code>.gzidx</code> appended). It is built only as far as
+ *  needed for a seek and extended by later seeks, so building it
+ *  never costs more than the gzseek() it replaces. The sidecar is
+ *  only written by appending, and the list of access points is at
+ *  the end of the file, after the 32kB windows.
+ */
+class GzIndex {
+public:
+    enum { WINSIZE = 32768 /*!< The size of the deflate window. */ };
+
+    //! An access point.
+    struct Point {
+        //! The position in the uncompressed data.
+        off_t out;
+
+        //! The position in the compressed file of the first full byte.
+        off_t in;
+
+        //! The number of bits of the byte before 'in' still to be used.
+        int bits;
+
+        //! Where the compressed window is stored in the sidecar file.
+        off_t wpos;
+
+        //! The size of the compressed window in the sidecar file.
+        int wlen;
+    };
+
+    //! Prepare to read the index for a gzip file.
+    GzIndex(const std::string& gzfilename /*!< The gzip file to index. */);
+
+    //! Close the sidecar file.
+    ~GzIndex();
+
+    //! Load the index, and extend it until it covers the given position.
+    /*! \return false if the sidecar file cannot be used or the gzip file is corrupt.
+     */
+    bool Prepare(off_t want /*!< The position in the uncompressed data. */);
+
+    //! Find the last access point before a position.
+    /*! \return the access point, or 0 if decompression has to start at the beginning
+     */
+    const Point* Find(off_t want /*!< The position in the uncompressed data. */) const;
+
+    //! Read the 32kB window of an access point from the sidecar file.
+    /*! \return true if the window could be read.
+     */
+    bool ReadWindow(const Point& p,        /*!< The access point. */
+                    unsigned char* window  /*!< Space for WINSIZE bytes. */) const;
+
+private:
+    //! Read the list of access points from the sidecar.
+    bool Load();
+
+    //! Decompress from the last access point and add new ones.
+    bool Extend(off_t want /*!< Stop once this position is reached. */);
+
+    //! Write the list of access points to the end of the sidecar.
+    bool WriteTable();
+
+    //! The name of the gzip file.
+    std::string filename;
+
+    //! The name of the sidecar file.
+    std::string indexname;
+
+    //! The size of the gzip file, to detect changes.
+    off_t src_size;
+
+    //! The modification time of the gzip file, to detect changes.
+    long src_mtime;
+
+    //! The access points, sorted by position.
+    std::vector<Point> points;
+
+    //! True if the index covers the whole file.
+    bool complete;
+
+    //! The size of the uncompressed data, if complete.
+    off_t total;
+
+    //! The sidecar file.
+    std::FILE* idxfile;
+};
+
+// ########################################################################
+// ########################################################################
+
+//! Read a gzip file starting at an arbitrary position.
+/*! Uses a GzIndex to start decompressing close to the wanted
+ *  position. Files with several gzip members are handled.
+ */
+class GzIndexReader : public FileReaderBackend {
+public:
+    GzIndexReader();
+
+    //! Closes the file, if still open.
+    ~GzIndexReader();
+
+    //! Open a file and go to the specified position.
+    /*! \return true if both opening and seeking were successful.
+     */
+    bool Open(const std::string& filename, /*!< The name of the file to open. */
+              off_t want                   /*!< At which byte to position for reading. */);
+
+    //! Read uncompressed data.
+    /*! \return the number of bytes read, 0 at the end of the file, or -1 for error
+     */
+    int Read(char* data,       /*!< Where to store the data. */
+             unsigned int size /*!< How many bytes to read at most. */);
+
+private:
+    //! Close the file and release the decompressor.
+    void Close();
+
+    //! Open the file and prepare decompression at an access point.
+    /*! \return true if the decompressor is ready
+     */
+    bool Start(const std::string& filename,  /*!< The name of the file to open. */
+               const GzIndex::Point* p,      /*!< The access point, or 0 for the beginning. */
+               const unsigned char* window   /*!< The 32kB window of the access point. */);
+
+    //! Decompress data.
+    /*! \return the number of bytes decompressed, or -1 for error
+     */
+    int Inflate(unsigned char* out, /*!< Where to store the data. */
+                unsigned int size,  /*!< How many bytes to produce at most. */
+                int flush           /*!< Z_NO_FLUSH, or Z_BLOCK to stop at deflate block ends. */);
+
+    //! Check if the decompressor stopped at the end of a deflate block.
+    bool AtBlockEnd() const
+        { return (strm.data_type & 128) && !(strm.data_type & 64); }
+
+    //! The position in the compressed file corresponding to the decompressor state.
+    off_t PosIn() const
+        { return input_start + (strm.next_in - &input[0]); }
+
+    //! Refill the input buffer.
+    /*! \return false if at end of file or error
+     */
+    bool Fill();
+
+    //! Handle the end of a gzip member.
+    /*! \return 1 if another member follows, 0 at end of file, -1 for error
+     */
+    int NextMember();
+
+    //! The compressed file.
+    std::FILE* file;
+
+    //! The decompressor state.
+    z_stream strm;
+
+    //! True if 'strm' has been initialized.
+    bool strm_ok;
+
+    //! True if decompressing raw deflate data (after starting at an access point).
+    bool raw;
+
+    //! True if the end of the file has been reached.
+    bool at_end;
+
+    //! The buffer for compressed data.
+    std::vector<unsigned char> input;
+
+    //! The position of the start of 'input' in the compressed file.
+    off_t input_start;
+
+    //! The position in the uncompressed data.
+    off_t pos_out;
+
+    friend class GzIndex;
+};
+
+#endif /* MISSING_ZLIB */
+
+#endif /* GZINDEX_H_ */
@@ -0,0 +1,476 @@
+/*
+ * ListModeBufferFetcher.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "ListModeBufferFetcher.h"
+
+#include "DataWord.h"
+#include "FileReader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The number of 32-bit words of one hit in a file.
+static const unsigned int HIT_WORDS = 3;
+
+//! The number of hits read from a file at once.
+static const unsigned int CHUNK_HITS = 16384;
+
+// ########################################################################
+// ########################################################################
+
+//! Reads the hits from one list-mode file, in time order.
+/*! The hits go through a reorder buffer: a hit is only returned when
+ *  'reorder' later hits have been read. Hits that arrive after a later
+ *  hit has already been returned are dropped and counted.
+ */
+class ListModeStream {
+public:
+    //! Initialize, without a file.
+    ListModeStream(unsigned int reorder /*!< The size of the reorder buffer. */)
+        : late( 0 ), chunk( CHUNK_HITS*HIT_WORDS ), chunk_pos( 0 ), chunk_end( 0 )
+        , at_end( false ), reorder( reorder ), last_time( 0 ), returned_any( false ) { }
+
+    //! Open a file.
+    /*! \return true if the file could be opened
+     */
+    bool Open(const std::string& filename)
+        { return reader.Open(filename, 0); }
+
+    //! Get the next hit.
+    /*! \return 1 for a hit, 0 at the end of the file, -1 for error
+     */
+    int Next(ListModeHit& hit);
+
+    //! The number of hits dropped because they came too late.
+    long long late;
+
+private:
+    //! Read the next chunk of hits.
+    /*! \return 1 if hits were read, 0 at the end of the file, -1 for error
+     */
+    int ReadChunk();
+
+    //! The object reading the file.
+    FileReader reader;
+
+    //! The hits read from the file, as words.
+    std::vector<unsigned int> chunk;
+
+    //! The position of the next hit and the end of the hits in 'chunk'.
+    unsigned int chunk_pos, chunk_end;
+
+    //! True when the end of the file is reached.
+    bool at_end;
+
+    //! The hits read, but not yet returned, in time order.
+    std::deque<ListModeHit> pending;
+
+    //! The size of the reorder buffer.
+    const unsigned int reorder;
+
+    //! The time of the hit returned last.
+    unsigned long long last_time;
+
+    //! True if any hit has been returned.
+    bool returned_any;
+};
+
+// ########################################################################
+
+int ListModeStream::ReadChunk()
+{
+    const int bytes = reader.ReadSome((char*)&chunk[0], chunk.size()*4);
+    if( bytes <= 0 )
+        return bytes;
+    if( bytes % (HIT_WORDS*4) != 0 ) {
+        std::cerr << "listmode: incomplete hit at the end of a file." << std::endl;
+        return -1;
+    }
+    chunk_pos = 0;
+    chunk_end = bytes/4;
+    return 1;
+}
+
+// ########################################################################
+
+int ListModeStream::Next(ListModeHit& hit)
+{
+    while( pending.size() <= reorder && !at_end ) {
+        if( chunk_pos >= chunk_end ) {
+            const int r = ReadChunk();
+            if( r < 0 )
+                return -1;
+            at_end = (r == 0);
+            continue;
+        }
+        ListModeHit h;
+        h.time = ((unsigned long long)chunk[chunk_pos+1] << 32) | chunk[chunk_pos];
+        h.word = chunk[chunk_pos+2];
+        chunk_pos += HIT_WORDS;
+        if( returned_any && h.time < last_time ) {
+            late += 1;
+            continue;
+        }
+
+        // insert in time order; usually, the hit belongs at the end
+        std::deque<ListModeHit>::iterator it = pending.end();
+        while( it != pending.begin() && (it-1)->time > h.time )
+            --it;
+        pending.insert(it, h);
+    }
+    if( pending.empty() )
+        return 0;
+
+    hit = pending.front();
+    pending.pop_front();
+    last_time = hit.time;
+    returned_any = true;
+    return 1;
+}
+
+// ########################################################################
+// ########################################################################
+
+//! Compares files by the time of their next hit, for the heap.
+class LaterHead {
+public:
+    LaterHead(const std::vector<ListModeHit>& h) : heads( h ) { }
+    bool operator()(unsigned int a, unsigned int b) const
+        { return heads[a].time > heads[b].time; }
+private:
+    const std::vector<ListModeHit>& heads;
+};
+
+// ########################################################################
+// ########################################################################
+
+ListModeBufferFetcher::ListModeBufferFetcher()
+    : has_lookahead( false )
+    , event_length( 0 )
+    , event_pending( false )
+    , error( false )
+    , n_hits( 0 )
+    , n_events( 0 )
+    , n_outside( 0 )
+    , n_late( 0 )
+    , n_truncated( 0 )
+{
+    SetDefaults();
+}
+
+// ########################################################################
+
+ListModeBufferFetcher::~ListModeBufferFetcher()
+{
+    Close();
+}
+
+// ########################################################################
+
+void ListModeBufferFetcher::SetDefaults()
+{
+    trigger_box = 0x21;   // SiRi E
+    window_before = 100;
+    window_after  = 200;
+    clock = 100000000;    // 10ns ticks
+    reorder = 1024;
+
+    tdc_mappings.clear();
+    TDCMapping nai = { 0x20, 0x10, 1, 200 }; // NaI energy and time
+    tdc_mappings.push_back(nai);
+}
+
+// ########################################################################
+
+//! Read a box id, allowing hexadecimal numbers.
+/*! \return the box id, or -1 if it is not valid
+ */
+static int read_box(std::istream& icmd)
+{
+    std::string id;
+    icmd >> id;
+    char* end = 0;
+    const long b = std::strtol(id.c_str(), &end, 0);
+    return (id.empty() || *end || b<0 || b>=128) ? -1 : b;
+}
+
+// ########################################################################
+
+bool ListModeBufferFetcher::Command(std::istream& icmd)
+{
+    std::string what;
+    icmd >> what;
+    if( what == "default" ) {
+        SetDefaults();
+        return true;
+    } else if( what == "trigger" ) {
+        const int b = read_box(icmd);
+        if( b < 0 ) {
+            std::cerr << "listmode: Expected listmode trigger <box>" << std::endl;
+            return false;
+        }
+        trigger_box = b;
+        return true;
+    } else if( what == "window" ) {
+        long long before = -1, after = -1;
+        icmd >> before >> after;
+        if( !icmd || before < 0 || after < 0 ) {
+            std::cerr << "listmode: Expected listmode window <ticks before> <ticks after>" << std::endl;
+            return false;
+        }
+        window_before = before;
+        window_after = after;
+        return true;
+    } else if( what == "tdc" ) {
+        std::string none;
+        std::streampos pos = icmd.tellg();
+        if( icmd >> none && none == "none" ) {
+            tdc_mappings.clear();
+            return true;
+        }
+        icmd.clear();
+        icmd.seekg(pos);
+        TDCMapping m;
+        const int adc = read_box(icmd), tdc = read_box(icmd);
+        int ticks = 0;
+        icmd >> ticks >> m.offset;
+        if( adc < 0 || tdc < 0 || !icmd || ticks <= 0 ) {
+            std::cerr << "listmode: Expected listmode tdc <adc box> <tdc box> <ticks per channel> <offset> | none" << std::endl;
+            return false;
+        }
+        m.adc_box = adc;
+        m.tdc_box = tdc;
+        m.ticks = ticks;
+        tdc_mappings.push_back(m);
+        return true;
+    } else if( what == "clock" ) {
+        long long c = -1;
+        icmd >> c;
+        if( !icmd || c < 0 ) {
+            std::cerr << "listmode: Expected listmode clock <ticks per second>" << std::endl;
+            return false;
+        }
+        clock = c;
+        return true;
+    } else if( what == "reorder" ) {
+        int r = -1;
+        icmd >> r;
+        if( !icmd || r < 0 ) {
+            std::cerr << "listmode: Expected listmode reorder <hits>" << std::endl;
+            return false;
+        }
+        reorder = r;
+        return true;
+    }
+    std::cerr << "listmode: Expected listmode trigger|window|tdc|clock|reorder|default" << std::endl;
+    return false;
+}
+
+// ########################################################################
+
+BufferFetcher::Status ListModeBufferFetcher::Open(const std::vector<std::string>& filenames)
+{
+    Close();
+    n_hits = n_events = n_outside = n_late = n_truncated = 0;
+
+    for(unsigned int f=0; f<filenames.size(); ++f) {
+        ListModeStream* s = new ListModeStream(reorder);
+        streams.push_back(s);
+        if( !s->Open(filenames[f]) ) {
+            std::cerr << "listmode: cannot open '" << filenames[f] << "'." << std::endl;
+            return ERROR;
+        }
+    }
+
+    // start the merge with the first hit of each file
+    heads.resize(streams.size());
+    for(unsigned int f=0; f<streams.size(); ++f) {
+        const int r = streams[f]->Next(heads[f]);
+        if( r < 0 )
+            return ERROR;
+        if( r > 0 )
+            heap.push_back(f);
+    }
+    std::make_heap(heap.begin(), heap.end(), LaterHead(heads));
+    return OKAY;
+}
+
+// ########################################################################
+
+void ListModeBufferFetcher::Close()
+{
+    for(unsigned int f=0; f<streams.size(); ++f) {
+        n_late += streams[f]->late;
+        delete streams[f];
+    }
+    streams.clear();
+    heads.clear();
+    heap.clear();
+    recent.clear();
+    has_lookahead = event_pending = error = false;
+}
+
+// ########################################################################
+
+bool ListModeBufferFetcher::NextHit(ListModeHit& hit)
+{
+    if( has_lookahead ) {
+        hit = lookahead;
+        has_lookahead = false;
+        return true;
+    }
+    if( heap.empty() )
+        return false;
+
+    // the file with the earliest hit is at the front of the heap
+    const LaterHead later(heads);
+    std::pop_heap(heap.begin(), heap.end(), later);
+    const unsigned int f = heap.back();
+    hit = heads[f];
+    n_hits += 1;
+
+    const int r = streams[f]->Next(heads[f]);
+    if( r > 0 ) {
+        std::push_heap(heap.begin(), heap.end(), later);
+    } else {
+        heap.pop_back();
+        if( r < 0 )
+            error = true;
+    }
+    return true;
+}
+
+// ########################################################################
+
+void ListModeBufferFetcher::AddHit(const ListModeHit& hit, unsigned long long trigger_time)
+{
+    const unsigned int b = box(hit.word);
+    int tdc_box = -1;
+    long long tdc = 0;
+    for(unsigned int m=0; m<tdc_mappings.size(); ++m) {
+        const TDCMapping& tm = tdc_mappings[m];
+        if( tm.adc_box == b ) {
+            tdc_box = tm.tdc_box;
+            tdc = tm.offset + ((long long)hit.time - (long long)trigger_time)/(long long)tm.ticks;
+            tdc = std::max(0LL, std::min(tdc, 0xffffLL));
+            break;
+        }
+    }
+
+    // keep room for the time words
+    const unsigned int need = (tdc_box >= 0) ? 2 : 1;
+    if( event_length + need > 255 - 2 ) {
+        n_truncated += 1;
+        return;
+    }
+    event_words[++event_length] = hit.word;
+    if( tdc_box >= 0 )
+        event_words[++event_length] = data_word(tdc_box, chn(hit.word), tdc);
+}
+
+// ########################################################################
+
+bool ListModeBufferFetcher::BuildEvent()
+{
+    ListModeHit hit;
+    while( NextHit(hit) ) {
+        if( box(hit.word) != trigger_box ) {
+            // may be in the window of a later trigger
+            recent.push_back(hit);
+            while( recent.front().time + window_before < hit.time ) {
+                recent.pop_front();
+                n_outside += 1;
+            }
+            continue;
+        }
+
+        // a trigger; take the hits before it
+        const unsigned long long trigger_time = hit.time;
+        event_length = 0;
+        for(unsigned int r=0; r<recent.size(); ++r) {
+            if( recent[r].time + window_before >= trigger_time )
+                AddHit(recent[r], trigger_time);
+            else
+                n_outside += 1;
+        }
+        recent.clear();
+        AddHit(hit, trigger_time);
+
+        // and the hits after it, including other trigger hits
+        while( NextHit(hit) ) {
+            if( hit.time > trigger_time + window_after ) {
+                lookahead = hit;
+                has_lookahead = true;
+                break;
+            }
+            AddHit(hit, trigger_time);
+        }
+
+        if( clock > 0 ) {
+            // wall clock time, high word ch 16 and low word ch 17
+            const unsigned long long seconds = trigger_time / clock;
+            event_words[++event_length] = data_word(0x01, 16, seconds >> 16);
+            event_words[++event_length] = data_word(0x01, 17, seconds);
+        }
+        event_words[0] = 0xC0000000 | event_length;
+        n_events += 1;
+        return true;
+    }
+    n_outside += recent.size();
+    recent.clear();
+    return false;
+}
+
+// ########################################################################
+
+const Buffer* ListModeBufferFetcher::Next(Status& state)
+{
+    unsigned int* data = buffer.GetBuffer();
+    const unsigned int size = buffer.GetSize();
+    unsigned int pos = 0;
+    while( event_pending || BuildEvent() ) {
+        const unsigned int n = event_length + 1;
+        // leave room for the end-of-buffer marker
+        if( pos + n + 1 > size ) {
+            event_pending = true;
+            break;
+        }
+        std::memcpy(data + pos, event_words, n*4);
+        pos += n;
+        event_pending = false;
+    }
+    if( error ) {
+        state = ERROR;
+        return 0;
+    }
+    if( pos == 0 ) {
+        state = END;
+        return 0;
+    }
+
+    data[pos++] = EOB;
+    std::memset(data + pos, 0, (size - pos)*4);
+    state = OKAY;
+    return &buffer;
+}
+
+// ########################################################################
+
+void ListModeBufferFetcher::Report(std::ostream& out) const
+{
+    long long late = n_late;
+    for(unsigned int f=0; f<streams.size(); ++f)
+        late += streams[f]->late;
+    out << "listmode: " << n_hits << " hits, " << n_events << " events, "
+        << n_outside << " hits outside of event windows, "
+        << late << " late hits dropped, "
+        << n_truncated << " hits dropped from too long events" << std::endl;
+}
@@ -0,0 +1,173 @@
+/* -*- c++ -*-
+ * ListModeBufferFetcher.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef LISTMODEBUFFERFETCHER_H_
+#define LISTMODEBUFFERFETCHER_H_
+
+#include "Buffer.h"
+#include "BufferFetcher.h"
+
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class ListModeStream;
+
+//! One hit from a list-mode file.
+/*! In the file, each hit consists of three 32-bit words in the byte
+ *  order of this machine: the low and the high word of the time
+ *  stamp in clock ticks, and a data word as from the VME setup, with
+ *  box id, channel id and value (see Unpacker).
+ */
+struct ListModeHit {
+    //! The time stamp in clock ticks.
+    unsigned long long time;
+
+    //! The data word, with box, channel and value.
+    unsigned int word;
+};
+
+//! Build events from time-stamped list-mode data.
+/*! Digital electronics write one file per digitizer, each with hits
+ *  ordered by time stamp, up to a few hits written late. The files of
+ *  one run are read at the same time, each through a bounded reorder
+ *  buffer, and merged by time stamp.
+ *
+ *  Each hit from the trigger box (by default the SiRi back detectors,
+ *  box 0x21) starts an event, unless it is already part of the event
+ *  before. The event contains all hits from 'before' ticks before to
+ *  'after' ticks after the trigger. Hits outside of all events are
+ *  dropped. For hits from ADC boxes with a TDC mapping (by default the
+ *  NaI energies, box 0x20), a TDC word is added, calculated from the
+ *  time difference to the trigger. The wall clock time, in seconds,
+ *  is added at the end of each event.
+ *
+ *  The events are written into sirius buffers, so that they are
+ *  unpacked and sorted exactly like events from the VME setup.
+ */
+class ListModeBufferFetcher : public BufferFetcher {
+public:
+    //! Construct the buffer fetcher with the default settings.
+    ListModeBufferFetcher();
+
+    //! Close the files.
+    ~ListModeBufferFetcher();
+
+    //! Set the default settings.
+    void SetDefaults();
+
+    //! Process a 'listmode' command from the batch file.
+    /*! The commands are
+     *  <pre>
+     *  listmode trigger &lt;box&gt;
+     *  listmode window &lt;before&gt; &lt;after&gt;
+     *  listmode tdc &lt;adc box&gt; &lt;tdc box&gt; &lt;ticks per channel&gt; &lt;offset&gt; | none
+     *  listmode clock &lt;ticks per second&gt;
+     *  listmode reorder &lt;hits&gt;
+     *  listmode default
+     *  </pre>
+     *
+     *  \return true if the command was understood
+     */
+    bool Command(std::istream& icmd /*!< The command, after 'listmode'. */);
+
+    //! Open the files of one run, one for each digitizer.
+    /*! \return the status after opening the files.
+     */
+    Status Open(const std::vector<std::string>& filenames /*!< The names of the files. */);
+
+    const Buffer* Next(Status& state);
+
+    //! Print the counters of the last run.
+    void Report(std::ostream& out /*!< Where to print. */) const;
+
+private:
+    //! Close all files.
+    void Close();
+
+    //! Get the next hit from all files, in time order.
+    /*! \return false at the end of all files, or for an error
+     */
+    bool NextHit(ListModeHit& hit);
+
+    //! Build the next event into 'event_words'.
+    /*! \return false if there are no more events
+     */
+    bool BuildEvent();
+
+    //! Add a hit to the event in 'event_words'.
+    void AddHit(const ListModeHit& hit,         /*!< The hit to add. */
+                unsigned long long trigger_time /*!< The time of the trigger. */);
+
+    //! A mapping from an ADC box to a TDC box.
+    struct TDCMapping {
+        //! The box with the energies.
+        unsigned int adc_box;
+
+        //! The box for the times.
+        unsigned int tdc_box;
+
+        //! The number of clock ticks per TDC channel.
+        unsigned int ticks;
+
+        //! The TDC value at the time of the trigger.
+        int offset;
+    };
+
+    //! The box of the trigger hits.
+    unsigned int trigger_box;
+
+    //! The part of the event window before and after the trigger, in ticks.
+    unsigned long long window_before, window_after;
+
+    //! The boxes which get TDC words.
+    std::vector<TDCMapping> tdc_mappings;
+
+    //! The number of clock ticks per second, or 0 for no time words.
+    unsigned long long clock;
+
+    //! The size of the reorder buffer of each file.
+    unsigned int reorder;
+
+    //! The files being read.
+    std::vector<ListModeStream*> streams;
+
+    //! The next hit of each file.
+    std::vector<ListModeHit> heads;
+
+    //! A heap of file indexes, ordered by the time of their next hit.
+    std::vector<unsigned int> heap;
+
+    //! A hit read too far, after the last event window.
+    ListModeHit lookahead;
+
+    //! True if 'lookahead' contains a hit.
+    bool has_lookahead;
+
+    //! Recent hits that may be in the window of a following trigger.
+    std::deque<ListModeHit> recent;
+
+    //! The header and the data words of the event being built.
+    unsigned int event_words[256];
+
+    //! The number of data words in 'event_words'.
+    unsigned int event_length;
+
+    //! True if 'event_words' contains an event that did not fit into the last buffer.
+    bool event_pending;
+
+    //! True if reading a file has failed.
+    bool error;
+
+    //! The buffer to build events in.
+    SiriusBuffer buffer;
+
+    //! Counters for Report().
+    long long n_hits, n_events, n_outside, n_late, n_truncated;
+};
+
+#endif /* LISTMODEBUFFERFETCHER_H_ */
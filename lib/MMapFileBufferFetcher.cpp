@@ -0,0 +1,195 @@
+/*
+ * MMapFileBufferFetcher.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "MMapFileBufferFetcher.h"
+
+#include "aptr.ipp"
+#include "MTFileBufferFetcher.h"
+#include "StringUtil.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! How far ahead of the current buffer the kernel is asked to read.
+static const off_t READAHEAD = 32*1024*1024;
+
+// ########################################################################
+
+MMapFileBufferFetcher::MMapFileBufferFetcher(unsigned int depth, unsigned int batch)
+    : view( SiriusBuffer::BUFSIZE )
+    , map_data( 0 )
+    , map_size( 0 )
+    , map_pos( 0 )
+    , advised( 0 )
+    , use_fallback( false )
+    , fallback_depth( depth )
+    , fallback_batch( batch )
+    , next_pos( 0 )
+{
+}
+
+// ########################################################################
+
+//! Check if a file is compressed and cannot be mapped.
+static bool is_compressed(const std::string& filename)
+{
+    return ends_with(filename, ".gz") || ends_with(filename, ".zst");
+}
+
+// ########################################################################
+
+MMapFileBufferFetcher::~MMapFileBufferFetcher()
+{
+    Close();
+}
+
+// ########################################################################
+
+MTFileBufferFetcher& MMapFileBufferFetcher::Fallback()
+{
+    if( !fallback )
+        fallback.reset( new MTFileBufferFetcher(fallback_depth, fallback_batch) );
+    return *fallback;
+}
+
+// ########################################################################
+
+BufferFetcher::Status MMapFileBufferFetcher::Open(const std::string& filename, int bufnum)
+{
+    Close();
+
+    if( is_compressed(filename) ) {
+        use_fallback = true;
+        return Fallback().Open( filename, bufnum );
+    }
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if( fd<0 )
+        return ERROR;
+
+    struct stat st;
+    if( fstat(fd, &st) != 0 ) {
+        close(fd);
+        return ERROR;
+    }
+    map_size = st.st_size;
+    map_pos = off_t(bufnum)*view.GetSize()*4;
+    if( map_pos > map_size ) {
+        close(fd);
+        return ERROR;
+    }
+
+    if( map_size > 0 ) {
+        // writable for swapping; pages are only copied when written
+        void* m = mmap(0, map_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if( m == MAP_FAILED ) {
+            std::cerr << "mmap: cannot map '" << filename << "'." << std::endl;
+            close(fd);
+            return ERROR;
+        }
+        map_data = (char*)m;
+        madvise(map_data, map_size, MADV_SEQUENTIAL);
+    }
+    // the mapping stays valid after closing the file descriptor
+    close(fd);
+
+    advised = map_pos;
+    Advise();
+    return OKAY;
+}
+
+// ########################################################################
+
+const Buffer* MMapFileBufferFetcher::Next(Status& state)
+{
+    if( use_fallback )
+        return fallback->Next(state);
+
+    const off_t bytes = off_t(view.GetSize())*4;
+    if( !map_data || map_pos >= map_size ) {
+        state = END;
+        return 0;
+    }
+    if( map_size - map_pos < bytes ) {
+        // incomplete buffer at the end of the file, like in FileReader
+        state = ERROR;
+        return 0;
+    }
+
+    view.SetView( (unsigned int*)(map_data + map_pos) );
+    byte_order.Fix(view.GetBuffer(), view.GetSize());
+    map_pos += bytes;
+    Advise();
+
+    state = OKAY;
+    return &view;
+}
+
+// ########################################################################
+
+void MMapFileBufferFetcher::Prepare(const std::string& filename, int bufnum)
+{
+    if( is_compressed(filename) ) {
+        Fallback().Prepare( filename, bufnum );
+        next_filename = "";
+    } else {
+        next_filename = filename;
+        next_pos = off_t(bufnum)*view.GetSize()*4;
+    }
+}
+
+// ########################################################################
+
+void MMapFileBufferFetcher::Advise()
+{
+    if( !next_filename.empty() && map_size - map_pos < READAHEAD ) {
+        // the end of this file is near, start reading the next one
+        const int fd = open(next_filename.c_str(), O_RDONLY);
+        if( fd>=0 ) {
+            posix_fadvise(fd, next_pos, READAHEAD, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+        next_filename = "";
+    }
+
+    if( !map_data || advised - map_pos >= READAHEAD/2 )
+        return;
+
+    // pages are page-aligned because buffers are 128kB each
+    const off_t end = std::min(map_pos + READAHEAD, map_size);
+    if( end > advised ) {
+        madvise(map_data + advised, end - advised, MADV_WILLNEED);
+        advised = end;
+    }
+
+    // drop the last completely sorted chunk from the mapping to limit
+    // the resident size; the kernel page cache keeps the data anyway;
+    // the buffer returned last must stay mapped
+    const off_t done = ((map_pos - off_t(view.GetSize())*4)/READAHEAD)*READAHEAD;
+    if( done >= READAHEAD )
+        madvise(map_data + done - READAHEAD, READAHEAD, MADV_DONTNEED);
+}
+
+// ########################################################################
+
+void MMapFileBufferFetcher::Close()
+{
+    if( map_data ) {
+        munmap(map_data, map_size);
+        map_data = 0;
+    }
+    map_size = map_pos = advised = 0;
+    byte_order.Reset();
+    use_fallback = false;
+    next_filename = "";
+}
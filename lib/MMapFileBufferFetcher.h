@@ -0,0 +1,98 @@
+/* -*- c++ -*-
+ * MMapFileBufferFetcher.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef MMAPFILEBUFFERFETCHER_H_
+#define MMAPFILEBUFFERFETCHER_H_
+
+#include "aptr.h"
+#include "Buffer.h"
+#include "ByteOrder.h"
+#include "FileBufferFetcher.h"
+
+#include <string>
+#include <sys/types.h>
+
+class MTFileBufferFetcher;
+
+//! Fetch buffers from a memory-mapped file without copying.
+/*! The whole file is mapped into memory and the buffers returned by
+ *  Next() point directly into the mapping. A buffer is valid until
+ *  the next call to Next() or Open().
+ *
+ *  The mapping is private and writable, so that buffers of files
+ *  with the other byte order can be swapped in place; the file itself
+ *  is not changed.
+ *
+ *  Compressed files (ending with <code>.gz</code> or <code>.zst</code>) cannot be mapped;
+ *  they are read using a MTFileBufferFetcher instead.
+ */
+class MMapFileBufferFetcher : public FileBufferFetcher {
+public:
+    //! Construct the buffer fetcher.
+    /*! The arguments are passed to the MTFileBufferFetcher for
+     *  compressed files.
+     */
+    MMapFileBufferFetcher(unsigned int depth=32, /*!< How many buffers to read in advance. */
+                          unsigned int batch=4   /*!< How many buffers to hand over at once. */);
+
+    //! Unmaps the file, if still mapped.
+    ~MMapFileBufferFetcher();
+
+    Status Open(const std::string& filename, int bufnum);
+
+    const Buffer* Next(Status& state);
+
+    /*! For uncompressed files, the kernel is asked to read the
+     *  beginning of the next file when the end of the current file
+     *  is near.
+     */
+    void Prepare(const std::string& filename, int bufnum);
+
+private:
+    //! Unmap the file, if mapped.
+    void Close();
+
+    //! Get the fetcher for files that cannot be mapped, creating it if needed.
+    MTFileBufferFetcher& Fallback();
+
+    //! Ask the kernel to read ahead of the current position.
+    void Advise();
+
+    //! The view into the mapped file that is returned by Next().
+    BufferView view;
+
+    //! The start of the mapping, or 0 if no file is mapped.
+    char* map_data;
+
+    //! The size of the mapping in bytes.
+    off_t map_size;
+
+    //! The offset of the next buffer to return.
+    off_t map_pos;
+
+    //! The offset up to which the read-ahead has been requested.
+    off_t advised;
+
+    //! The byte order of the mapped file.
+    ByteOrder byte_order;
+
+    //! Fetcher for files that cannot be mapped.
+    aptr<MTFileBufferFetcher> fallback;
+
+    //! True if the current file is read by the fallback fetcher.
+    bool use_fallback;
+
+    //! The read-ahead depth and batch size for the fallback fetcher.
+    unsigned int fallback_depth, fallback_batch;
+
+    //! The name of the file to read ahead, or empty.
+    std::string next_filename;
+
+    //! The offset to start reading ahead in the next file.
+    off_t next_pos;
+};
+
+#endif /* MMAPFILEBUFFERFETCHER_H_ */
@@ -10,10 +10,15 @@
 #include "aptr.ipp"
 #include "FileReader.h"
 #include "Buffer.h"
+#include "BufferStock.h"
+#include "ByteOrder.h"
+#include "PThreadMutex.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <pthread.h>
+#include <vector>
 
 #define NDEBUG 1
 #include "debug.h"
@@ -21,183 +26,80 @@
 // ########################################################################
 // ########################################################################
 
-//! A helper class for handling pthread mutex objects.
-class PThreadMutex {
-public:
-    //! Initialize the mutex.
-    PThreadMutex()
-        { pthread_mutex_init( &mutex, 0 ); }
-
-    //! Finalize the mutex.
-    ~PThreadMutex()
-        { pthread_mutex_destroy( &mutex ); }
-
-    //! Lock the mutex.
-    void Lock()
-        { pthread_mutex_lock( &mutex ); }
-
-    //! Unlock the mutex.
-    void Unlock()
-        { pthread_mutex_unlock( &mutex ); }
-
-    //! Wait for a condition.
-    void Wait( pthread_cond_t* cond /*!< The condition to wait for. */)
-        { pthread_cond_wait( cond, &mutex ); }
-
-private:
-    // disabled, not implemented
-    PThreadMutex(const PThreadMutex& other);
-    PThreadMutex& operator=(const PThreadMutex& other);
-
-    //! The pthread mutex.
-    pthread_mutex_t mutex;
-};
-
-// ########################################################################
-// ########################################################################
-
-//! A helper class for unlocking a mutex.
-class PThreadMutexLock {
-public:
-    //! Lock the mutex.
-    PThreadMutexLock(PThreadMutex& mtx /*!< The mutex to be locked. */)
-        : mutex(mtx) { mutex.Lock(); }
-    
-    //! Unlock the mutex.
-    ~PThreadMutexLock()
-        { mutex.Unlock(); }
-    
-private:
-    // disabled, not implemented
-    PThreadMutexLock(const PThreadMutexLock& other);
-    PThreadMutexLock& operator=(const PThreadMutexLock& other);
-
-    //! The mutex to be locked and unlocked.
-    PThreadMutex& mutex;
-};
-
-// ########################################################################
-// ########################################################################
-
-//! A ring buffer.
-/*! The implementation is messy.
- */
-template<class T, int N, bool created>
-class RingBuffer {
-public:
-    RingBuffer();
-    ~RingBuffer();
-
-    bool Full() const { return size==N; }
-    bool Empty() const { return size==0; }
-    T* Put(T* t=dummy);
-    T* Get();
-    void Set(unsigned int idx, T* t)
-        { ring[idx] = t; }
-
-private:
-    static T* dummy;
-
-    T* ring[N];
-    int head, tail, size;
-};
-
-// ########################################################################
-
-template<class T, int N, bool created>
-RingBuffer<T,N,created>::RingBuffer()
-    : head(0), tail(0), size(0)
-{
-    for(int i=0; i<N; ++i)
-        ring[i] = 0;
-}
-
-// ########################################################################
-
-template<class T, int N, bool created>
-RingBuffer<T,N,created>::~RingBuffer()
-{
-    if( created ) {
-        for(int i=0; i<N; ++i)
-            delete ring[i];
-    }
-}
-
-// ########################################################################
-
-template<class T, int N, bool created>
-T* RingBuffer<T,N,created>::Put(T* t)
-{
-    if( Full() )
-        return 0;
-    if( created ) {
-        t = ring[head];
-    } else {
-        ring[head] = t;
-    }
-    head = (head+1)%N;
-    size += 1;
-    return t;
-}
-
-// ########################################################################
-
-template<class T, int N, bool created>
-T* RingBuffer<T,N,created>::Get()
-{
-    if( Empty() )
-        return 0;
-    T* r = created ? 0 : ring[tail];
-    tail = (tail+1)%N;
-    size -= 1;
-    return r;
-}
-
-// ########################################################################
-
-template<class T, int N, bool created>
-T* RingBuffer<T,N,created>::dummy = 0;
-
-// ########################################################################
-// ########################################################################
-
 //! Class used by MTFileBufferFetcher to read buffers in a separate thread.
+/*! The buffers are passed between the prefetch thread and the main
+ *  thread through a single-producer/single-consumer ring. Both sides
+ *  only use atomic counters as long as the ring is neither full nor
+ *  empty; the mutex and the conditions are only used to sleep. The
+ *  prefetch thread publishes filled buffers in batches, and it is
+ *  only woken up again when a whole batch of ring slots is free.
+ *
+ *  The ring holds pointers to buffers from a BufferStock. A slot is
+ *  free as soon as the main thread has taken the buffer; the buffer
+ *  itself goes back to the stock when it is no longer used.
+ */
 class PrefetchThread {
 public:
     //! Initialize, but do not yet start running.
-    PrefetchThread(FileReader* reader,     /*!< Helper to perform the actual file reading. */
-                   Buffer* template_buffer /*!< Buffer object to be "multiplied". */);
+    PrefetchThread(FileReader* reader,      /*!< Helper to perform the actual file reading. */
+                   BufferStock* stock,      /*!< Where to take buffers from. */
+                   unsigned int depth,      /*!< The number of slots in the ring, a power of 2. */
+                   unsigned int batch       /*!< The number of buffers handed over at once. */);
 
     //! Cleanup after the thread stopped running.
+    /*! Buffers still in the ring are given back to the stock.
+     */
     ~PrefetchThread();
 
     //! Start the new thread.
     void Start();
 
     //! Called to get a new buffer for sorting.
+    /*! \return the buffer, to be given back to the stock, or 0 at the end
+     */
     Buffer* ReadingBegins();
 
-    //! Called after sorting a buffer has finished.
-    void ReadingEnds();
-
     //! Stop the thread.
     void Stop();
 
+    //! Check if the thread has reached the end of the file.
+    bool IsFinished() const
+        { return Load(finished) != 0; }
+
 private:
     //! The main loop of the thread.
     void StartReading();
 
+    //! Make filled buffers visible to the main thread.
+    void Publish(unsigned int produced /*!< The number of buffers filled so far. */);
+
+    //! Sleep in the prefetch thread until a batch of ring slots is free.
+    void WaitForSpace(unsigned int produced /*!< The number of buffers filled so far. */);
+
+    //! Sleep in the main thread until a buffer is filled or reading is finished.
+    void WaitForData();
+
     //! Helper for pthread_create.
     static void* Run(void* v)
         { ((PrefetchThread*)v)->StartReading(); return 0; }
 
-    //! The mutex for synchonizing acces to the ring buffers.
+    //! Atomically read a counter or flag.
+    template<class T>
+    static T Load(const T& t)
+        { return __atomic_load_n(&t, __ATOMIC_SEQ_CST); }
+
+    //! Atomically write a counter or flag.
+    template<class T>
+    static void Store(T& t, T v)
+        { __atomic_store_n(&t, v, __ATOMIC_SEQ_CST); }
+
+    //! The mutex for sleeping, not needed to access the ring.
     PThreadMutex mutex;
 
-    //! The condition "write ring full".
-    pthread_cond_t cond_full;
+    //! The condition "a batch of buffers is free".
+    pthread_cond_t cond_space;
 
-    //! The condition "read ring not empty".
+    //! The condition "buffer filled or reading finished".
     pthread_cond_t cond_avail;
 
     //! The thread object;
@@ -206,33 +108,62 @@ private:
     //! The file reading implementation.
     FileReader* reader;
 
-    enum { NBUFFERS = 8 /*!< By default, read up to 8 buffers in advance. */ };
+    //! Where to take buffers from.
+    BufferStock* stock;
+
+    //! The byte order of the file, buffers are fixed in the prefetch thread.
+    ByteOrder byte_order;
+
+    //! The buffers in the ring.
+    std::vector<Buffer*> buffers;
+
+    //! The number of buffers in the ring minus 1, for wrapping the counters.
+    const unsigned int mask;
+
+    //! The number of buffers handed over at once.
+    const unsigned int batch;
 
-    //! The ring for fetching buffers.
-    RingBuffer<Buffer,NBUFFERS,true> writeRing;
+    //! The number of buffers filled and published. Only written by the prefetch thread.
+    unsigned int filled;
 
-    //! The ring for reading buffers.
-    RingBuffer<Buffer,NBUFFERS,false> readRing;
+    //! The number of ring slots freed. Only written by the main thread.
+    unsigned int released;
+
+    //! The number of buffers given to the main thread. Only used by the main thread.
+    unsigned int reading;
 
     //! Flag set to stop the thread. Only written by main thread.
-    bool cancel;
+    int cancel;
 
     //! Flag that reading the file is finished. Only written by the prefetch thread.
-    bool finished;
+    int finished;
+
+    //! Flag that the prefetch thread sleeps or is about to.
+    int producer_waiting;
+
+    //! Flag that the main thread sleeps or is about to.
+    int consumer_waiting;
 };
 
 // ########################################################################
 
-PrefetchThread::PrefetchThread(FileReader* rdr, Buffer* template_buffer)
+PrefetchThread::PrefetchThread(FileReader* rdr, BufferStock* stk,
+                               unsigned int depth, unsigned int bat)
     : reader( rdr )
-    , cancel( false )
-    , finished( false )
+    , stock( stk )
+    , buffers( depth, (Buffer*)0 )
+    , mask( depth-1 )
+    , batch( bat )
+    , filled( 0 )
+    , released( 0 )
+    , reading( 0 )
+    , cancel( 0 )
+    , finished( 0 )
+    , producer_waiting( 0 )
+    , consumer_waiting( 0 )
 {
-    pthread_cond_init( &cond_full,  0 );
+    pthread_cond_init( &cond_space, 0 );
     pthread_cond_init( &cond_avail, 0 );
-
-    for(int i=0; i<NBUFFERS; ++i)
-        writeRing.Set(i, template_buffer->New());
 }
 
 // ########################################################################
@@ -247,26 +178,67 @@ void PrefetchThread::Start()
 
 // ########################################################################
 
-void PrefetchThread::ReadingEnds()
+Buffer* PrefetchThread::ReadingBegins()
+{
+    while( true ) {
+        if( reading != Load(filled) ) {
+            Buffer* b = buffers[(reading++) & mask];
+            Store(released, reading);
+
+            // the prefetch thread published everything before going to
+            // sleep, so 'filled' tells how many slots are in use
+            if( Load(producer_waiting) && (mask+1) - (Load(filled) - reading) >= batch ) {
+                PThreadMutexLock lock( mutex );
+                pthread_cond_signal( &cond_space );
+            }
+            return b;
+        }
+        if( Load(finished) ) {
+            // 'filled' may have been published just before 'finished'
+            if( reading != Load(filled) )
+                continue;
+            return 0;
+        }
+        WaitForData();
+    }
+}
+
+// ########################################################################
+
+void PrefetchThread::WaitForData()
 {
     PThreadMutexLock lock( mutex );
-    writeRing.Get();
-    pthread_cond_signal( &cond_full );
+    Store(consumer_waiting, 1);
+    while( reading == Load(filled) && !Load(finished) )
+        mutex.Wait( &cond_avail );
+    Store(consumer_waiting, 0);
 }
 
 // ########################################################################
 
-Buffer* PrefetchThread::ReadingBegins()
+void PrefetchThread::WaitForSpace(unsigned int produced)
 {
     PThreadMutexLock lock( mutex );
-    while( true ) {
-        if( finished && readRing.Empty() )
-            return 0;
-        if( readRing.Empty() ) {
-            mutex.Wait( &cond_avail );
-            continue;
-        }
-        return readRing.Get();
+    Store(producer_waiting, 1);
+    while( !Load(cancel) && (mask+1) - (produced - Load(released)) < batch )
+        mutex.Wait( &cond_space );
+    Store(producer_waiting, 0);
+}
+
+// ########################################################################
+
+void PrefetchThread::Publish(unsigned int produced)
+{
+    if( produced == filled )
+        return;
+    Store(filled, produced);
+
+    // the main thread sets the flag before checking 'filled' again
+    // with the mutex locked, so either it sees the new value or it
+    // receives the signal
+    if( Load(consumer_waiting) ) {
+        PThreadMutexLock lock( mutex );
+        pthread_cond_signal( &cond_avail );
     }
 }
 
@@ -274,41 +246,45 @@ Buffer* PrefetchThread::ReadingBegins()
 
 void PrefetchThread::StartReading()
 {
-    while( !cancel && !finished ) {
-        Buffer* buffer = 0;
-        { // critical section
-            PThreadMutexLock lock( mutex );
-            while( !cancel && !finished && writeRing.Full() )
-                mutex.Wait( &cond_full );
-            if( cancel || finished )
-                return;
-        
-            // claim a buffer, but do not yet say it is filled
-            buffer = writeRing.Put();
-        } // unlock in 'lock' destructor
-
-        // reading is time-consuming and should be performed while the
-        // lock is released
-        if( reader->Read((char*)buffer->GetBuffer(), buffer->GetSize()*4 ) <= 0 )
-            finished = true;
-
-        { // critical section
-            PThreadMutexLock lock( mutex );
-            if( !finished ) {
-                // mark the buffer as readable
-                readRing.Put(buffer);
-            } else {
-                // would be wrong if > 1 thread; fortunately we have
-                // only 1; for two threads T1 and T2, if T1 finishes
-                // the previous critical section first, then T2 runs
-                // that section, reads a buffer before T1, and detects
-                // end of file, then T2 would "free" the buffer taken
-                // by T1
-                writeRing.Get();
-            }
-            // tell main thread that data are available
-            pthread_cond_signal( &cond_avail );
-        } // unlock in 'lock' destructor
+    unsigned int produced = 0;
+    while( !Load(cancel) ) {
+        if( produced - Load(released) > mask ) {
+            // ring full
+            Publish(produced);
+            WaitForSpace(produced);
+            continue;
+        }
+
+        // do not keep buffers back if the main thread is waiting,
+        // reading the next one might take a while
+        if( Load(consumer_waiting) )
+            Publish(produced);
+
+        // if all buffers are in use, hand over the filled ones before waiting
+        Buffer* buffer = stock->TryTake();
+        if( !buffer ) {
+            Publish(produced);
+            buffer = stock->Take(cancel);
+            if( !buffer )
+                break;
+        }
+        if( reader->Read((char*)buffer->GetBuffer(), buffer->GetSize()*4 ) <= 0 ) {
+            stock->Recycle(buffer);
+            break;
+        }
+        byte_order.Fix(buffer->GetBuffer(), buffer->GetSize());
+
+        buffers[produced & mask] = buffer;
+        produced += 1;
+        if( produced - filled >= batch )
+            Publish(produced);
+    }
+
+    Publish(produced);
+    Store(finished, 1);
+    if( Load(consumer_waiting) ) {
+        PThreadMutexLock lock( mutex );
+        pthread_cond_signal( &cond_avail );
     }
 }
 
@@ -316,11 +292,12 @@ void PrefetchThread::StartReading()
 
 void PrefetchThread::Stop()
 {
+    Store(cancel, 1);
     { // critical section
         PThreadMutexLock lock( mutex );
-        cancel = true;
-        pthread_cond_signal( &cond_full );
+        pthread_cond_signal( &cond_space );
     } // unlock in 'lock' destructor
+    stock->WakeUp();
 
     // wait for thread to terminate
     pthread_join( thread, NULL );
@@ -330,18 +307,30 @@ void PrefetchThread::Stop()
 
 PrefetchThread::~PrefetchThread()
 {
-    pthread_cond_destroy( &cond_full );
+    for(unsigned int i=reading; i!=filled; ++i)
+        stock->Recycle(buffers[i & mask]);
+    pthread_cond_destroy( &cond_space );
     pthread_cond_destroy( &cond_avail );
 }
 
 // ########################################################################
 // ########################################################################
 
-MTFileBufferFetcher::MTFileBufferFetcher()
+MTFileBufferFetcher::MTFileBufferFetcher(unsigned int d, unsigned int b)
     : reader( new FileReader() )
-    , template_buffer( new SiriusBuffer() )
+    , template_buffer( 0 )
+    , stock( 0 )
     , prefetch( 0 )
+    , next_prefetch( 0 )
+    , next_bufnum( 0 )
+    , depth( 2 )
+    , batch( 1 )
 {
+    // round up to a power of 2 so that the counters may wrap around
+    while( depth < d )
+        depth *= 2;
+    batch = std::max(1u, std::min(b, depth/2));
+    SetBuffer( new SiriusBuffer() );
 }
 
 // ########################################################################
@@ -349,29 +338,59 @@ MTFileBufferFetcher::MTFileBufferFetcher()
 MTFileBufferFetcher::~MTFileBufferFetcher()
 {
     StopPrefetching();
+    StopNext();
+    current.Reset();
+    stock->Dispose();
+}
+
+// ########################################################################
+
+void MTFileBufferFetcher::SetBuffer(Buffer* buf)
+{
+    StopPrefetching();
+    StopNext();
+    current.Reset();
+    if( stock )
+        stock->Dispose();
+    template_buffer.reset( buf );
+
+    // enough for two full rings (current and prepared file) and a few
+    // buffers held by the sorting
+    stock = new BufferStock( buf->New(), 2*depth + 2 );
 }
 
 // ########################################################################
 
 const Buffer* MTFileBufferFetcher::Next(Status& state)
+{
+    // the buffer from the last call is given back when 'current' is replaced
+    current = NextHandle(state);
+    return current.Get();
+}
+
+// ########################################################################
+
+BufferHandle MTFileBufferFetcher::NextHandle(Status& state)
 {
     if( reader->IsError() ) {
         state = ERROR;
-        return 0;
+        return BufferHandle();
     }
 
     if( !prefetch ) {
-        prefetch = new PrefetchThread( reader.get(), template_buffer.get() );
+        prefetch = new PrefetchThread( reader.get(), stock, depth, batch );
         prefetch->Start();
-    } else {
-        // finish reading the buffer from the last call to Next()
-        prefetch->ReadingEnds();
     }
 
+    // start reading the next file while the buffers at the end of
+    // this one are sorted
+    if( !next_filename.empty() && !next_prefetch && prefetch->IsFinished() )
+        StartNext();
+
     // fetch the next buffer
-    const Buffer* b = prefetch->ReadingBegins();
+    Buffer* b = prefetch->ReadingBegins();
     state = b ? OKAY : END;
-    return b;
+    return b ? BufferHandle(b, stock) : BufferHandle();
 }
 
 // ########################################################################
@@ -379,7 +398,17 @@ const Buffer* MTFileBufferFetcher::Next(Status& state)
 BufferFetcher::Status MTFileBufferFetcher::Open(const std::string& filename, int bufnum)
 {
     StopPrefetching();
-    int i = reader->Open( filename, bufnum*template_buffer->GetSize()*4 );
+    if( next_prefetch && filename == next_filename && bufnum == next_bufnum ) {
+        // the prepared file is already being read
+        reader.reset( next_reader.release() );
+        prefetch = next_prefetch;
+        next_prefetch = 0;
+        next_filename = "";
+        return OKAY;
+    }
+    StopNext();
+
+    int i = reader->Open( filename, off_t(bufnum)*template_buffer->GetSize()*4 );
     if( i>0 ) return OKAY; else if( i==0 ) return END; else return ERROR;
 }
 
@@ -394,3 +423,40 @@ void MTFileBufferFetcher::StopPrefetching()
     delete prefetch;
     prefetch = 0;
 }
+
+// ########################################################################
+
+void MTFileBufferFetcher::Prepare(const std::string& filename, int bufnum)
+{
+    StopNext();
+    next_filename = filename;
+    next_bufnum = bufnum;
+}
+
+// ########################################################################
+
+void MTFileBufferFetcher::StartNext()
+{
+    next_reader.reset( new FileReader() );
+    if( next_reader->Open( next_filename, off_t(next_bufnum)*template_buffer->GetSize()*4 ) <= 0 ) {
+        // Open() will try again and report the problem
+        next_reader.reset( 0 );
+        next_filename = "";
+        return;
+    }
+    next_prefetch = new PrefetchThread( next_reader.get(), stock, depth, batch );
+    next_prefetch->Start();
+}
+
+// ########################################################################
+
+void MTFileBufferFetcher::StopNext()
+{
+    if( next_prefetch ) {
+        next_prefetch->Stop();
+        delete next_prefetch;
+        next_prefetch = 0;
+    }
+    next_reader.reset( 0 );
+    next_filename = "";
+}
@@ -9,45 +9,92 @@
 #define MTFILEBUFFERFETCHER_H_
 
 #include "aptr.h"
+#include "BufferHandle.h"
 #include "FileBufferFetcher.h"
 
 #include <string>
 
+class BufferStock;
 class FileReader;
 
 //! Fetch buffers from a file in a separate thread.
 /*! This class spawns a thread to prefetch buffers on the first call
  *  to Next(). This is a bit more complicated, but it can also make
- *  the sorting 50% faster.
+ *  the sorting 50% faster. The sortbench tool measures the reading
+ *  speed of this and the other fetchers.
+ *
+ *  The buffers are handed over through a lock-free ring; a deeper
+ *  ring helps to bridge short stalls of the disk. Buffers taken with
+ *  NextHandle() are not copied; they are filled again only after the
+ *  last handle has been dropped. Reading stops while more than about
+ *  two rings of buffers are held.
+ *
+ *  If the next file is announced with Prepare(), it is opened and a
+ *  second thread starts prefetching from it as soon as the first
+ *  thread has reached the end of the current file.
  */
 class MTFileBufferFetcher : public FileBufferFetcher {
 public:
     //! Construct the buffer fetcher.
-    MTFileBufferFetcher();
+    MTFileBufferFetcher(unsigned int depth=32, /*!< How many buffers to read in advance, rounded up to a power of 2. */
+                        unsigned int batch=4   /*!< How many buffers to hand over to the sorting at once. */);
 
     //! Closes the file, if still open.
     ~MTFileBufferFetcher();
 
     Status Open(const std::string& filename, int bufnum);
 
+    void Prepare(const std::string& filename, int bufnum);
+
     /*! Creates a new thread which prefetches some buffers while the
      *  main thread is sorting.
      */
     const Buffer* Next(Status& state);
 
+    BufferHandle NextHandle(Status& state);
+
     //! Set the buffer template.
-    void SetBuffer(Buffer* buf)
-        { template_buffer.reset( buf ); }
+    void SetBuffer(Buffer* buf);
 
 private:
     //! Stop the prefetch thread.
     void StopPrefetching();
 
+    //! Open the prepared file and start prefetching from it.
+    void StartNext();
+
+    //! Stop prefetching the prepared file and forget about it.
+    void StopNext();
+
     aptr<FileReader> reader;
 
     aptr<Buffer> template_buffer;
 
+    //! The buffers to be filled by the prefetch threads.
+    BufferStock* stock;
+
+    //! The buffer returned by Next(), given back at the next call.
+    BufferHandle current;
+
     class PrefetchThread* prefetch;
+
+    //! The reader for the prepared file.
+    aptr<FileReader> next_reader;
+
+    //! The prefetch thread for the prepared file, or 0 if not yet started.
+    class PrefetchThread* next_prefetch;
+
+    //! The name of the prepared file, or empty.
+    std::string next_filename;
+
+    //! The buffer number to start from in the prepared file.
+    int next_bufnum;
+
+    //! The number of buffers in the prefetch ring.
+    unsigned int depth;
+
+    //! The number of buffers handed over at once.
+    unsigned int batch;
 };
 
 #endif /* MTFILEBUFFERFETCHER_H_ */
@@ -7,19 +7,35 @@
 
 #include "OfflineSorting.h"
 
+#include "DataCache.h"
 #include "Event.h"
+#include "EventBatch.h"
+#include "FollowBufferFetcher.h"
+#include "ListModeBufferFetcher.h"
 #include "MTFileBufferFetcher.h"
+#include "ParallelGzReader.h"
+#include "PThreadMutex.h"
 #include "RateMeter.h"
 #include "RootWriter.h"
 #include "MamaWriter.h"
+#include "MMapFileBufferFetcher.h"
+#include "SocketBufferFetcher.h"
 #include "STFileBufferFetcher.h"
+#include "StringUtil.h"
 #include "Unpacker.h"
+#include "UringReader.h"
 #include "UserRoutine.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 #include <fstream>
+#include <glob.h>
 #include <iostream>
 #include <signal.h>
 #include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "aptr.ipp"
 
@@ -56,7 +72,6 @@ static std::string trim_whitespace( const std::string& text /*!< The text to cle
     return text.substr(start, end-start+1);
 }
 
-// ########################################################################
 // ########################################################################
 // ########################################################################
 
@@ -64,7 +79,31 @@ OfflineSorting::OfflineSorting(UserRoutine& us)
     : userRoutine( us )
     , is_tty( isatty(STDOUT_FILENO) )
     , maxBuffers(-1)
-    , bufferFetcher(new MTFileBufferFetcher())
+    , lookahead( true )
+    , fetcher_type( "mt" )
+    , fetcher_depth( 32 )
+    , fetcher_batch( 4 )
+    , glob_threads( 0 )
+    , split_threads( 0 )
+    , split_shared( 0 )
+    , quiet( false )
+    , sorted_buffers( 0 )
+    , bad_buffers( 0 )
+    , make_index( true )
+    , skip_bad( false )
+    , time_select( false )
+    , time_from( 0 )
+    , time_to( 0 )
+    , event_time( 0 )
+    , event_time_valid( false )
+    , start_time( false )
+    , index_record( 0 )
+    , batch_next( 0 )
+    , follow_directory( false )
+    , follow_idle( 600 )
+    , periodic_interval( 0 )
+    , periodic_last( 0 )
+    , bufferFetcher(new_fetcher())
     , rateMeter(500, !is_tty)
 {
     signal(SIGINT, keyb_int); // set up interrupt handler (Ctrl-C)
@@ -80,6 +119,18 @@ void OfflineSorting::SetBufferFetcher(FileBufferFetcher* bf)
 
 // ########################################################################
 
+FileBufferFetcher* OfflineSorting::new_fetcher() const
+{
+    if( fetcher_type == "st" )
+        return new STFileBufferFetcher();
+    else if( fetcher_type == "mmap" )
+        return new MMapFileBufferFetcher(fetcher_depth, fetcher_batch);
+    else
+        return new MTFileBufferFetcher(fetcher_depth, fetcher_batch);
+}
+
+// ########################################################################
+
 void OfflineSorting::SetMaxBuffers(int mb)
 {
     maxBuffers = mb;
@@ -89,23 +140,386 @@ void OfflineSorting::SetMaxBuffers(int mb)
 
 bool OfflineSorting::SortBuffer(const Buffer* buffer)
 {
+    // a skim file is written from single events
+    if( !split_parts.empty() && !skim )
+        return SortSplit(buffer);
+
     unpack.SetBuffer(buffer);
+    buffer_info.events = 0;
+    buffer_info.has_time = false;
+
+    // the event cache is written from batches
+    if( (userRoutine.SortsBatches() || event_cache) && !skim )
+        return SortBatch();
         
     // unpack and sort all events from this buffer
     int unpack_err = Unpacker::END;
     while(leaveprog=='n') {
+        const unsigned int event_begin = unpack.GetPosition();
         unpack_err = unpack.Next(event);
         if( unpack_err != Unpacker::OKAY )
             break;
+
+        buffer_info.events += 1;
+        if( event.has_time ) {
+            if( !buffer_info.has_time )
+                buffer_info.time_first = event.time;
+            buffer_info.time_last = event.time;
+            buffer_info.has_time = true;
+            event_time = event.time;
+            event_time_valid = true;
+        }
+        // events without time word belong to the time of the event before
+        if( time_select && (!event_time_valid || event_time < time_from || event_time > time_to) )
+            continue;
+
         userRoutine.Sort(event);
+        if( userRoutine.TakeSelected() )
+            write_skim(buffer, event_begin);
+    }
+    buffer_info.okay = (unpack_err == Unpacker::END);
+    return buffer_info.okay;
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortBatch()
+{
+    if( leaveprog != 'n' ) {
+        buffer_info.okay = true;
+        return true;
+    }
+
+    // unpack all events from this buffer at once
+    const int unpack_err = unpack.NextBatch(event_batch);
+    write_events(event_batch);
+    select_events(event_batch);
+
+    userRoutine.SortBatch(event_batch);
+    buffer_info.okay = (unpack_err == Unpacker::END);
+    return buffer_info.okay;
+}
+
+// ########################################################################
+
+void OfflineSorting::write_events(const EventBatch& batch)
+{
+    // on errors, the writer removes the file, and sorting continues without it
+    if( event_cache && !event_cache->Write(batch) )
+        event_cache.reset( 0 );
+}
+
+// ########################################################################
+
+void OfflineSorting::write_skim(const Buffer* buffer, unsigned int begin)
+{
+    if( skim && !skim->Write(buffer, begin, unpack.GetPosition()) )
+        skim.reset( 0 );
+}
+
+// ########################################################################
+
+void OfflineSorting::select_events(EventBatch& batch)
+{
+    buffer_info.events += batch.n_events;
+    if( time_select )
+        event_selected.resize(batch.n_events);
+    for(int i=0; i<batch.n_events; ++i) {
+        if( batch.has_time[i] ) {
+            if( !buffer_info.has_time )
+                buffer_info.time_first = batch.time[i];
+            buffer_info.time_last = batch.time[i];
+            buffer_info.has_time = true;
+            event_time = batch.time[i];
+            event_time_valid = true;
+        }
+        // events without time word belong to the time of the event before
+        if( time_select )
+            event_selected[i] = event_time_valid && event_time >= time_from && event_time <= time_to;
+    }
+    if( time_select )
+        batch.Keep(event_selected);
+}
+
+// ########################################################################
+
+//! The state shared by the threads of SortSplit().
+struct SplitShared {
+    //! Initialize the conditions.
+    SplitShared()
+        : step( 0 ), generation( 0 ), pending( 0 ), buffer( 0 )
+        { pthread_cond_init( &cond_work, 0 ); pthread_cond_init( &cond_done, 0 ); }
+
+    //! Finalize the conditions.
+    ~SplitShared()
+        { pthread_cond_destroy( &cond_work ); pthread_cond_destroy( &cond_done ); }
+
+    //! What the parts do next.
+    int step;
+
+    //! Counts the steps, so that the threads notice a new one.
+    unsigned int generation;
+
+    //! The number of threads still working on the step.
+    int pending;
+
+    //! The buffer being sorted.
+    const Buffer* buffer;
+
+    //! Protects the members above.
+    PThreadMutex mutex;
+
+    //! The condition "a new step starts".
+    pthread_cond_t cond_work;
+
+    //! The condition "all threads have finished the step".
+    pthread_cond_t cond_done;
+};
+
+// ########################################################################
+
+//! One part of a buffer for SortSplit().
+struct SplitPart {
+    //! The steps for all parts.
+    enum { UNPACK, SORT, QUIT };
+
+    //! Do one step for this part.
+    void Run(int step, const Buffer* buffer);
+
+    //! The state shared by all threads.
+    SplitShared* shared;
+
+    //! The routine sorting this part.
+    UserRoutine* routine;
+
+    //! The unpacker for this part, with the same box table as the main one.
+    Unpacker unpack;
+
+    //! The events of this part.
+    EventBatch batch;
+
+    //! The position of the first event header and the end of the last event.
+    unsigned int begin, end;
+
+    //! The status after unpacking.
+    int status;
+
+    //! The thread; part 0 runs in the main thread.
+    pthread_t thread;
+};
+
+// ########################################################################
+
+void SplitPart::Run(int step, const Buffer* buffer)
+{
+    if( step == UNPACK ) {
+        unpack.SetBuffer(buffer, begin, end);
+        status = unpack.NextBatch(batch);
+    } else if( step == SORT && batch.n_events > 0 ) {
+        routine->SortBatch(batch);
     }
-    return unpack_err == Unpacker::END;
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortSplit(const Buffer* buffer)
+{
+    buffer_info.events = 0;
+    buffer_info.has_time = false;
+    if( leaveprog != 'n' ) {
+        buffer_info.okay = true;
+        return true;
+    }
+
+    // find the events and divide them into parts of equal size
+    split_headers.resize(buffer->GetSize() + 1);
+    split_scan.headers = &split_headers[0];
+    bool okay = (split_scan.Prescan(buffer->GetBuffer(), buffer->GetSize()) == BufferScan::OKAY);
+    const unsigned int n_parts = split_parts.size(), n_events = split_scan.events;
+    for(unsigned int p=0; p<n_parts; ++p) {
+        split_parts[p]->begin = split_headers[ p   *n_events/n_parts];
+        split_parts[p]->end   = split_headers[(p+1)*n_events/n_parts];
+    }
+    split_shared->buffer = buffer;
+    run_split(SplitPart::UNPACK);
+
+    // go through the parts in order, as the time of an event may come
+    // from the part before; like for one thread, stop at a bad event
+    bool stopped = false;
+    for(unsigned int p=0; p<n_parts; ++p) {
+        SplitPart& part = *split_parts[p];
+        if( stopped ) {
+            part.batch.Reset(0);
+            continue;
+        }
+        write_events(part.batch);
+        select_events(part.batch);
+        if( part.status != Unpacker::END )
+            okay = false, stopped = true;
+    }
+
+    // the copies count the time from the first event, which the user
+    // routine may not have seen yet
+    for(unsigned int p=0; p<n_parts && !start_time; ++p) {
+        const EventBatch& batch = split_parts[p]->batch;
+        for(int i=0; i<batch.n_events && !start_time; ++i) {
+            if( batch.has_time[i] ) {
+                userRoutine.StartTime(batch.time[i]);
+                start_time = true;
+            }
+        }
+    }
+
+    run_split(SplitPart::SORT);
+    buffer_info.okay = okay;
+    return okay;
+}
+
+// ########################################################################
+
+void OfflineSorting::run_split(int step)
+{
+    SplitShared& shared = *split_shared;
+    { // critical section
+        PThreadMutexLock lock( shared.mutex );
+        shared.step = step;
+        shared.pending = split_parts.size() - 1;
+        shared.generation += 1;
+        pthread_cond_broadcast( &shared.cond_work );
+    } // unlock in 'lock' destructor
+    if( step == SplitPart::QUIT )
+        return;
+
+    split_parts[0]->Run(step, shared.buffer);
+
+    PThreadMutexLock lock( shared.mutex );
+    while( shared.pending > 0 )
+        shared.mutex.Wait( &shared.cond_done );
+}
+
+// ########################################################################
+
+void* OfflineSorting::SplitThread(void* v)
+{
+    SplitPart* part = (SplitPart*)v;
+    SplitShared& shared = *part->shared;
+    unsigned int seen = 0;
+    while( true ) {
+        int step;
+        { // critical section
+            PThreadMutexLock lock( shared.mutex );
+            while( shared.generation == seen )
+                shared.mutex.Wait( &shared.cond_work );
+            seen = shared.generation;
+            step = shared.step;
+        } // unlock in 'lock' destructor
+        if( step == SplitPart::QUIT )
+            break;
+
+        part->Run(step, shared.buffer);
+
+        PThreadMutexLock lock( shared.mutex );
+        if( --shared.pending == 0 )
+            pthread_cond_signal( &shared.cond_done );
+    }
+    return 0;
+}
+
+// ########################################################################
+
+void OfflineSorting::start_split()
+{
+    if( split_threads <= 1 || !split_parts.empty() )
+        return;
+
+    std::vector<UserRoutine*> copies;
+    for(int t=1; t<split_threads; ++t) {
+        UserRoutine* r = copy_routine();
+        if( !r )
+            break;
+        copies.push_back(r);
+    }
+    if( (int)copies.size() != split_threads-1 ) {
+        for(unsigned int t=0; t<copies.size(); ++t)
+            delete copies[t];
+        std::cout << "data: the user routine cannot be copied, sorting each buffer in one thread." << std::endl;
+        split_threads = 0;
+        return;
+    }
+
+    split_shared = new SplitShared();
+    for(int t=0; t<split_threads; ++t) {
+        SplitPart* part = new SplitPart();
+        part->shared = split_shared;
+        part->routine = (t == 0) ? &userRoutine : copies[t-1];
+        part->unpack = unpack; // the box table
+        part->unpack.GetStatistics().Reset();
+        split_parts.push_back(part);
+    }
+    for(int t=1; t<split_threads; ++t) {
+        if( pthread_create( &split_parts[t]->thread, NULL, OfflineSorting::SplitThread, split_parts[t] ) != 0 ) {
+            std::cerr << "data: cannot create sorting thread." << std::endl;
+            exit( -1 );
+        }
+    }
+}
+
+// ########################################################################
+
+void OfflineSorting::merge_split()
+{
+    for(unsigned int t=1; t<split_parts.size(); ++t) {
+        Histograms& h = split_parts[t]->routine->GetHistograms();
+        userRoutine.GetHistograms().Merge( h );
+        h.ResetAll();
+    }
+}
+
+// ########################################################################
+
+void OfflineSorting::stop_split()
+{
+    if( split_parts.empty() )
+        return;
+
+    run_split(SplitPart::QUIT);
+    for(unsigned int t=1; t<split_parts.size(); ++t)
+        pthread_join( split_parts[t]->thread, NULL );
+    merge_split();
+
+    for(unsigned int t=0; t<split_parts.size(); ++t) {
+        unpack.GetStatistics().Add( split_parts[t]->unpack.GetStatistics() );
+        if( t > 0 )
+            delete split_parts[t]->routine;
+        delete split_parts[t];
+    }
+    split_parts.clear();
+    delete split_shared;
+    split_shared = 0;
+}
+
+// ########################################################################
+
+UserRoutine* OfflineSorting::copy_routine()
+{
+    UserRoutine* r = userRoutine.New();
+    if( !r )
+        return 0;
+    r->Start();
+    for(unsigned int c=0; c<routine_commands.size(); ++c)
+        r->Command(routine_commands[c]);
+    return r;
 }
 
 // ########################################################################
 
 bool OfflineSorting::SortFile(const std::string& filename, int buf_start, int buf_end)
 {
+    RunIndex index(filename);
+    const bool have_index = index.Read();
+    if( have_index && (skip_bad || time_select) )
+        return SortSelected(filename, index, buf_start, buf_end);
+
     // open data file
     if( bufferFetcher->Open(filename, buf_start) != BufferFetcher::OKAY ) {
         // TODO: exception
@@ -113,32 +527,466 @@ bool OfflineSorting::SortFile(const std::string& filename, int buf_start, int bu
                   << buf_start << "'." << std::endl;
         return false;
     }
+    if( lookahead )
+        prepare_next_file();
+
+    // record the index only if the whole file is sorted
+    const bool record = make_index && !have_index && buf_start == 0 && buf_end < 0;
+    index_record = record ? &index : 0;
+    if( have_index )
+        index_time(index, buf_start);
+    else
+        event_time_valid = false;
+    if( event_cache )
+        event_cache->Restart();
+    const bool ok = SortBuffers(*bufferFetcher, buf_start, buf_end);
+    index_record = 0;
+    if( record && ok && leaveprog == 'n' && index.Size() > 0 && index.Write() && !quiet )
+        std::cout << "data: wrote buffer index '" << RunIndex::IndexName(filename) << "'." << std::endl;
+    return ok;
+}
+
+// ########################################################################
+
+void OfflineSorting::index_time(const RunIndex& index, unsigned int buffer)
+{
+    // events without time word belong to the time of the event before,
+    // which may be in one of the buffers before
+    event_time_valid = false;
+    for(unsigned int b=std::min(buffer, index.Size()); b>0; --b) {
+        if( index[b-1].has_time ) {
+            event_time = index[b-1].time_last;
+            event_time_valid = true;
+            break;
+        }
+    }
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortSelected(const std::string& filename, const RunIndex& index,
+                                  int buf_start, int buf_end)
+{
+    const unsigned int end = (buf_end < 0) ? index.Size() : std::min(index.Size(), (unsigned int)buf_end);
+
+    // collect ranges of consecutive selected buffers
+    std::vector<std::pair<unsigned int, unsigned int> > ranges;
+    unsigned int selected = 0;
+    for(unsigned int b=buf_start; b<end; ++b) {
+        const RunIndex::Entry& e = index[b];
+        if( skip_bad && !e.okay )
+            continue;
+        if( time_select && e.has_time && (e.time_last < time_from || e.time_first > time_to) )
+            continue;
+        if( !ranges.empty() && ranges.back().second == b )
+            ranges.back().second += 1;
+        else
+            ranges.push_back( std::make_pair(b, b+1) );
+        selected += 1;
+    }
+    if( !quiet )
+        std::cout << "data: index selects " << selected << " of " << (end - std::min(end, (unsigned int)buf_start))
+                  << " buffers in " << ranges.size() << " ranges." << std::endl;
+
+    for(unsigned int r=0; r<ranges.size() && leaveprog == 'n'; ++r) {
+        if( bufferFetcher->Open(filename, ranges[r].first) != BufferFetcher::OKAY ) {
+            std::cerr << "data: could not open '" << filename << "' or not seek to "
+                      << ranges[r].first << "'." << std::endl;
+            return false;
+        }
+        if( lookahead && r+1 == ranges.size() )
+            prepare_next_file();
+
+        // continue with the time of the buffer before a part of a file,
+        // but not across buffers that are skipped
+        if( r == 0 && ranges[r].first == (unsigned int)buf_start )
+            index_time(index, buf_start);
+        else
+            event_time_valid = false;
+        if( event_cache )
+            event_cache->Restart();
+        if( !SortBuffers(*bufferFetcher, ranges[r].first, ranges[r].second) )
+            return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortOnline(const std::string& address)
+{
+    SocketBufferFetcher socketFetcher;
+    if( socketFetcher.Open(address) != BufferFetcher::OKAY ) {
+        std::cerr << "data: could not connect to '" << address << "'." << std::endl;
+        return false;
+    }
+    return SortBuffers(socketFetcher, 0, -1);
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortFollow(const std::string& filename)
+{
+    FollowBufferFetcher followFetcher(follow_directory, follow_idle);
+    if( followFetcher.Open(filename, 0) != BufferFetcher::OKAY ) {
+        std::cerr << "data: could not follow '" << filename << "'." << std::endl;
+        return false;
+    }
+    return SortBuffers(followFetcher, 0, -1);
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortListMode(const std::vector<std::string>& filenames)
+{
+    if( listmode.Open(filenames) != BufferFetcher::OKAY ) {
+        std::cerr << "data: could not open the list-mode files." << std::endl;
+        return false;
+    }
+    const bool ok = SortBuffers(listmode, 0, -1);
+    listmode.Report(std::cout);
+    return ok;
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortEvents(const std::string& filename)
+{
+    EventCacheReader reader;
+    if( !reader.Open(filename) ) {
+        std::cerr << "data: could not open event cache '" << filename << "'." << std::endl;
+        return false;
+    }
+
+    int block_count = 0;
+    long long event_count = 0;
+    if( skim )
+        std::cerr << "data: events from an event cache are not written to the skim file." << std::endl;
+
+    rateMeter.Reset();
+    event_time_valid = false;
+    int status = 0;
+    bool restart = false;
+    while( leaveprog == 'n' && (status = reader.Next(event_batch, restart)) > 0 ) {
+        periodic_export();
+
+        if( restart )
+            event_time_valid = false;
+        event_count += event_batch.n_events;
+        select_events(event_batch);
+        userRoutine.SortBatch(event_batch);
+
+        block_count += 1;
+        const float blocks_per_sec = rateMeter.Rate();
+        if( blocks_per_sec > 0 ) {
+            if( is_tty )
+                std::cout << "        " << std::flush << '\r' << block_count << ' ' << blocks_per_sec << " blocks/s " << std::flush;
+            else
+                std::cout << '.' << std::flush;
+        }
+    }
+    if( status < 0 )
+        std::cerr << "\ndata: event cache '" << filename << "' is damaged after block " << block_count << std::endl;
+    std::cout << '\r' << block_count << " blocks, " << event_count << " events, "
+              << rateMeter.TotalRate() << " blocks/s" << std::endl;
+    return status >= 0;
+}
+
+// ########################################################################
+
+//! A file, or a range of buffers of a file, for one thread of SortGlob().
+struct GlobPart {
+    //! The name of the file.
+    std::string filename;
+
+    //! The first buffer, and the buffer after the last one or -1 for the end.
+    int begin, end;
+};
+
+//! The work shared by the threads of SortGlob().
+struct GlobShared {
+    //! The files to sort.
+    std::vector<std::string> files;
+
+    //! The parts of the files handed out to the threads.
+    std::vector<GlobPart> parts;
+
+    //! The index of the next part to sort.
+    unsigned int next;
+
+    //! Protects 'next' and the output.
+    PThreadMutex mutex;
+
+    //! False if sorting a file has failed.
+    bool ok;
+};
+
+// ########################################################################
+
+bool OfflineSorting::glob_start_time(const GlobShared& shared, long& time)
+{
+    Unpacker u = unpack; // the box table
+    Event e;
+    aptr<FileBufferFetcher> fetcher( new_fetcher() );
+    for(unsigned int p=0; p<shared.parts.size(); ++p) {
+        const GlobPart& part = shared.parts[p];
+        if( fetcher->Open(part.filename, part.begin) != BufferFetcher::OKAY )
+            continue;
+        for(int b=part.begin; part.end<0 || b<part.end; ++b) {
+            BufferFetcher::Status fstate;
+            const Buffer* buf = fetcher->Next(fstate);
+            if( fstate != BufferFetcher::OKAY )
+                break;
+            u.SetBuffer(buf);
+            while( u.Next(e) == Unpacker::OKAY ) {
+                // like the time window in SortBuffer()
+                if( e.has_time && (!time_select || (e.time >= time_from && e.time <= time_to)) ) {
+                    time = e.time;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// ########################################################################
+
+//! One thread of SortGlob().
+struct GlobWorker {
+    //! The work shared by all threads.
+    GlobShared* shared;
+
+    //! The copy of the user routine for this thread.
+    UserRoutine* routine;
+
+    //! The sorting object for this thread, using 'routine'.
+    OfflineSorting* sorting;
+
+    //! The thread.
+    pthread_t thread;
+};
+
+// ########################################################################
+
+bool OfflineSorting::SortGlob(const std::string& pat)
+{
+    // prepend data_directory, but only for relative paths
+    std::string pattern = pat;
+    if( !data_directory.empty() && pattern[0] != '/' )
+        pattern = data_directory + "/" + pattern;
+
+    GlobShared shared;
+    shared.next = 0;
+    shared.ok = true;
+    glob_t g;
+    if( glob(pattern.c_str(), 0, 0, &g) == 0 ) {
+        for(size_t i=0; i<g.gl_pathc; ++i) {
+            // skip the sidecar files written next to the data files
+            const std::string f = g.gl_pathv[i];
+            if( !ends_with(f, ".gzidx") && !ends_with(f, ".bufidx") && !ends_with(f, ".tmp") )
+                shared.files.push_back(f);
+        }
+        globfree(&g);
+    }
+    if( shared.files.empty() ) {
+        std::cerr << "data: no files match '" << pattern << "'." << std::endl;
+        return false;
+    }
+
+    int nthreads = (glob_threads > 0) ? glob_threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+    // with fewer files than threads, files with a buffer index are
+    // split into ranges with similar numbers of events; .gz files are
+    // not split, as seeking in them may extend their .gzidx
+    const unsigned int n_files = shared.files.size();
+    const unsigned int n_split = (nthreads > (int)n_files) ? (nthreads + n_files - 1)/n_files : 1;
+    for(unsigned int f=0; f<n_files; ++f) {
+        GlobPart part = { shared.files[f], 0, maxBuffers };
+        RunIndex index(part.filename);
+        if( n_split > 1 && !ends_with(part.filename, ".gz") && index.Read() && index.Size() > 0 ) {
+            unsigned int end = index.Size();
+            if( maxBuffers >= 0 )
+                end = std::min(end, (unsigned int)maxBuffers);
+            const std::vector<unsigned int> starts = index.Split(0, end, n_split);
+            for(unsigned int p=0; p+1<starts.size(); ++p) {
+                part.begin = starts[p];
+                part.end = (p+2 == starts.size() && maxBuffers < 0) ? -1 : (int)starts[p+1];
+                shared.parts.push_back(part);
+            }
+        } else {
+            shared.parts.push_back(part);
+        }
+    }
+    nthreads = std::max(1, std::min(nthreads, (int)shared.parts.size()));
+    const bool writing = event_cache || skim;
+    UserRoutine* first = (nthreads > 1 && !writing) ? copy_routine() : 0;
+    if( !first ) {
+        if( nthreads > 1 && writing )
+            std::cout << "data: writing events, sorting one file after the other." << std::endl;
+        else if( nthreads > 1 )
+            std::cout << "data: the user routine cannot be copied, sorting one file after the other." << std::endl;
+        // like the threads, go on with the other files after an error
+        for(unsigned int i=0; i<shared.files.size() && leaveprog == 'n'; ++i) {
+            std::cout << "data: reading file '" << shared.files[i] << "'." << std::endl;
+            if( !SortFile(shared.files[i], 0, maxBuffers) ) {
+                std::cout << "data: error sorting '" << shared.files[i] << "'" << std::endl;
+                shared.ok = false;
+            }
+        }
+        return shared.ok;
+    }
+    // the copies count the time from the first event of the first part
+    long first_time;
+    if( !start_time && glob_start_time(shared, first_time) ) {
+        userRoutine.StartTime(first_time);
+        start_time = true;
+    }
+
+    std::cout << "data: sorting " << shared.files.size() << " files matching '" << pattern
+              << "' in " << shared.parts.size() << " parts with " << nthreads << " threads." << std::endl;
+
+    // set up the copies in this thread, like the user routine itself
+    std::vector<GlobWorker> workers(nthreads);
+    for(int t=0; t<nthreads; ++t) {
+        GlobWorker& w = workers[t];
+        w.shared = &shared;
+        w.routine = (t == 0) ? first : copy_routine();
+
+        w.sorting = new OfflineSorting(*w.routine);
+        OfflineSorting& s = *w.sorting;
+        s.fetcher_type  = fetcher_type;
+        s.fetcher_depth = fetcher_depth;
+        s.fetcher_batch = fetcher_batch;
+        s.SetBufferFetcher( s.new_fetcher() );
+        s.unpack      = unpack; // the box table
+        s.unpack.GetStatistics().Reset();
+        s.maxBuffers  = maxBuffers;
+        s.make_index  = make_index;
+        s.skip_bad    = skip_bad;
+        s.time_select = time_select;
+        s.time_from   = time_from;
+        s.time_to     = time_to;
+        s.quiet       = true;
+    }
 
+#ifndef MISSING_ZLIB
+    // each thread reads its own file; share the decompression threads
+    ParallelGzReader::SetReaders( nthreads );
+#endif
+    for(int t=0; t<nthreads; ++t) {
+        if( pthread_create( &workers[t].thread, NULL, OfflineSorting::GlobThread, &workers[t] ) != 0 ) {
+            std::cerr << "data: cannot create sorting thread." << std::endl;
+            exit( -1 );
+        }
+    }
+    for(int t=0; t<nthreads; ++t) {
+        pthread_join( workers[t].thread, NULL );
+        userRoutine.GetHistograms().Merge( workers[t].routine->GetHistograms() );
+        unpack.GetStatistics().Add( workers[t].sorting->unpack.GetStatistics() );
+        delete workers[t].sorting;
+        delete workers[t].routine;
+    }
+#ifndef MISSING_ZLIB
+    ParallelGzReader::SetReaders( 1 );
+#endif
+    return shared.ok;
+}
+
+// ########################################################################
+
+void* OfflineSorting::GlobThread(void* v)
+{
+    GlobWorker* w = (GlobWorker*)v;
+    GlobShared& shared = *w->shared;
+    OfflineSorting& s = *w->sorting;
+    while( leaveprog == 'n' ) {
+        GlobPart part;
+        {
+            PThreadMutexLock lock( shared.mutex );
+            if( shared.next >= shared.parts.size() )
+                break;
+            part = shared.parts[shared.next++];
+        }
+        s.sorted_buffers = s.bad_buffers = 0;
+        const bool ok = s.SortFile(part.filename, part.begin, part.end);
+
+        PThreadMutexLock lock( shared.mutex );
+        if( !ok )
+            shared.ok = false;
+        std::cout << "data: " << (ok ? "sorted" : "error sorting") << " '" << part.filename << "' ";
+        if( part.end >= 0 )
+            std::cout << "buffers [" << part.begin << ',' << part.end << "[ ";
+        else if( part.begin > 0 )
+            std::cout << "buffers [" << part.begin << ",end[ ";
+        std::cout << s.sorted_buffers << '/' << s.bad_buffers << std::endl;
+    }
+    return 0;
+}
+
+// ########################################################################
+
+void OfflineSorting::periodic_export()
+{
+    if( periodic_interval <= 0 )
+        return;
+    const time_t now = time(0);
+    if( now < periodic_last + periodic_interval )
+        return;
+    periodic_last = now;
+
+    merge_split();
+
+    // write to a temporary file, so that the file is always complete
+    const std::string tmp = periodic_file + ".tmp.root";
+    RootWriter::Write( userRoutine.GetHistograms(), tmp );
+    if( rename(tmp.c_str(), periodic_file.c_str()) != 0 )
+        std::cerr << "export periodic: cannot rename '" << tmp << "'." << std::endl;
+}
+
+// ########################################################################
+
+bool OfflineSorting::SortBuffers(BufferFetcher& fetcher, int buf_start, int buf_end)
+{
     int buffer_count = 0, bad_buffer_count = 0;
     rateMeter.Reset();
+    start_split();
 
     // loop over all buffers
-    for(int b=buf_start; buf_end<0 || b<buf_end; ++b) {
+    for(int b=buf_start; buf_end<0 || b<buf_end; ) {
         // stop if Ctrl-C has been pressed
         if( leaveprog != 'n' )
             break;
 
+        periodic_export();
+
         // fetch next buffer
         BufferFetcher::Status fstate;
-        const Buffer* buf = bufferFetcher->Next(fstate);
+        const Buffer* buf = fetcher.Next(fstate);
         if( fstate == BufferFetcher::END ) {
             break;
         } else if( fstate == BufferFetcher::ERROR ) {
             // TODO exception
             std::cerr << "\ndata: error reading buffer " << b << std::endl;
+            stop_split();
             return false;
+        } else if( fstate == BufferFetcher::WAIT ) {
+            // the fetcher has waited a while already, no need to sleep
+            continue;
         }
 
         // sort buffer
-        buffer_count += 1;
         const bool sort_ok = SortBuffer(buf);
         if( !sort_ok )
             bad_buffer_count += 1;
+        if( index_record ) {
+            buffer_info.offset = off_t(b)*buf->GetSize()*4;
+            index_record->Add(buffer_info);
+        }
+        b += 1;
+        buffer_count += 1;
+        if( quiet )
+            continue;
 
         // from time to time, print a message
         const float bufs_per_sec = rateMeter.Rate();
@@ -154,6 +1002,12 @@ bool OfflineSorting::SortFile(const std::string& filename, int buf_start, int bu
         }
     }
 
+    stop_split();
+    sorted_buffers += buffer_count;
+    bad_buffers += bad_buffer_count;
+    if( quiet )
+        return true;
+
     // print counters and rate at the end
     std::cout << '\r' << buffer_count << '/' << bad_buffer_count
               << ' ' << unpack.GetAverageLength()
@@ -167,6 +1021,12 @@ bool OfflineSorting::data_command(std::istream& icmd)
 {
     int buf_start=0, buf_end=maxBuffers;
 
+    // the parameters of the routine may have changed since the last command
+    if( !userRoutine.SetupUnpacker(unpack) ) {
+        std::cerr << "data: the user routine could not set up the unpacker." << std::endl;
+        return false;
+    }
+
     std::string tmp;
     icmd >> tmp;
     if( tmp == "directory" ) {
@@ -181,6 +1041,332 @@ bool OfflineSorting::data_command(std::istream& icmd)
         return true;
     }
 
+    if( tmp == "fetcher" ) {
+        icmd >> tmp;
+        if( tmp == "mt" ) {
+            // values that are not given keep their current setting
+            int depth = fetcher_depth, batch = fetcher_batch;
+            if( icmd >> depth )
+                icmd >> batch;
+            if( depth <= 0 || batch <= 0 ) {
+                std::cerr << "data: Expected data fetcher mt [<depth> [<batch>]]" << std::endl;
+                return false;
+            }
+            fetcher_depth = depth;
+            fetcher_batch = batch;
+        } else if( tmp != "st" && tmp != "mmap" ) {
+            std::cerr << "data: Expected data fetcher mt [<depth> [<batch>]]|st|mmap, not '" << tmp << "'" << std::endl;
+            return false;
+        }
+        fetcher_type = tmp;
+        SetBufferFetcher( new_fetcher() );
+        std::cout << "Set data fetcher to '" << tmp << "'";
+        if( tmp == "mt" )
+            std::cout << " reading " << fetcher_depth << " buffers ahead, " << fetcher_batch << " at once";
+        std::cout << std::endl;
+        return true;
+    }
+
+    if( tmp == "gzthreads" ) {
+        int n = -1;
+        icmd >> n;
+        if( n < 0 ) {
+            std::cerr << "data: Expected data gzthreads <count>" << std::endl;
+            return false;
+        }
+#ifndef MISSING_ZLIB
+        ParallelGzReader::SetThreads( n );
+#endif
+        std::cout << "Set gzip decompression threads to " << n << std::endl;
+        return true;
+    }
+
+    if( tmp == "uring" ) {
+        int depth = -1;
+        std::string opt;
+        icmd >> depth >> opt;
+        const bool direct = (opt == "direct");
+        if( depth < 0 || (!direct && !opt.empty()) ) {
+            std::cerr << "data: Expected data uring <depth> [direct]" << std::endl;
+            return false;
+        }
+        UringReader::Configure( depth, direct );
+        std::cout << "Set asynchronous read depth to " << depth
+                  << (direct ? " with O_DIRECT" : "") << std::endl;
+        return true;
+    }
+
+    if( tmp == "cache" ) {
+        std::string dir;
+        long long mb = -1;
+        icmd >> dir >> mb;
+        if( dir == "off" ) {
+            DataCache::Configure( "", 0 );
+            std::cout << "Set no cache for compressed files" << std::endl;
+            return true;
+        }
+        struct stat st;
+        if( dir.empty() || mb <= 0 ) {
+            std::cerr << "data: Expected data cache <directory> <MB>|off" << std::endl;
+            return false;
+        }
+        if( stat(dir.c_str(), &st) != 0 && mkdir(dir.c_str(), 0755) != 0 ) {
+            std::cerr << "data: cannot create cache directory '" << dir << "'" << std::endl;
+            return false;
+        }
+        DataCache::Configure( dir, mb*1024*1024 );
+        std::cout << "Set cache for compressed files to '" << dir << "' with "
+                  << mb << "MB" << std::endl;
+        return true;
+    }
+
+    if( tmp == "online" ) {
+        std::string addr;
+        std::getline( icmd, addr );
+        const std::string address = trim_whitespace( addr );
+        if( address.empty() ) {
+            std::cerr << "data: Expected data online unix:<path>|tcp:<host>:<port>" << std::endl;
+            return false;
+        }
+        std::cout << "data: receiving buffers from '" << address << "'." << std::endl;
+        return SortOnline(address);
+    }
+
+    if( tmp == "follow" ) {
+        // the rest is the file name, like for 'data file'
+        std::string filename;
+        int buf_start, buf_end;
+        if( !file_arguments(icmd, "file", filename, buf_start, buf_end, true) )
+            return false;
+        std::cout << "data: following file '" << filename << "'";
+        if( follow_directory )
+            std::cout << " and new files in its directory";
+        std::cout << "; a file ends ";
+        if( follow_idle > 0 )
+            std::cout << "after " << follow_idle << "s without changes or ";
+        std::cout << "when its writer closes it for good." << std::endl;
+        return SortFollow(filename);
+    }
+
+    if( tmp == "write_events" ) {
+        std::string filename;
+        std::getline( icmd, filename );
+        filename = trim_whitespace( filename );
+        if( filename.empty() ) {
+            std::cerr << "data: Expected data write_events <filename>|off" << std::endl;
+            return false;
+        }
+        event_cache.reset( 0 ); // finish the file written before
+        if( filename == "off" )
+            return true;
+        if( skim ) {
+            std::cerr << "data: cannot write an event cache and a skim file at the same time." << std::endl;
+            return false;
+        }
+        event_cache.reset( new EventCacheWriter() );
+        if( !event_cache->Open(filename) ) {
+            event_cache.reset( 0 );
+            return false;
+        }
+        std::cout << "data: writing unpacked events to '" << filename << "'." << std::endl;
+        return true;
+    }
+
+    if( tmp == "skim" ) {
+        std::string filename;
+        std::getline( icmd, filename );
+        filename = trim_whitespace( filename );
+        if( filename.empty() ) {
+            std::cerr << "data: Expected data skim <filename>|off" << std::endl;
+            return false;
+        }
+        skim.reset( 0 ); // finish the file written before
+        if( filename == "off" )
+            return true;
+        if( event_cache ) {
+            std::cerr << "data: cannot write an event cache and a skim file at the same time." << std::endl;
+            return false;
+        }
+        skim.reset( new SkimWriter() );
+        if( !skim->Open(filename) ) {
+            skim.reset( 0 );
+            return false;
+        }
+        userRoutine.TakeSelected(); // forget marks from events sorted before
+        std::cout << "data: writing selected events to '" << filename << "'." << std::endl;
+        return true;
+    }
+
+    if( tmp == "events" ) {
+        std::string filename;
+        std::getline( icmd, filename );
+        filename = trim_whitespace( filename );
+        if( filename.empty() ) {
+            std::cerr << "data: Expected data events <filename>" << std::endl;
+            return false;
+        }
+        // prepend data_directory, but only for relative paths
+        if( !data_directory.empty() && filename[0] != '/' )
+            filename = data_directory + "/" + filename;
+        std::cout << "data: reading events from '" << filename << "'." << std::endl;
+        return SortEvents(filename);
+    }
+
+    if( tmp == "listmode" ) {
+        std::vector<std::string> filenames;
+        std::string filename;
+        while( icmd >> filename ) {
+            // prepend data_directory, but only for relative paths
+            if( !data_directory.empty() && filename[0] != '/' )
+                filename = data_directory + "/" + filename;
+            filenames.push_back(filename);
+        }
+        if( filenames.empty() ) {
+            std::cerr << "data: Expected data listmode <file> [<file> ...]" << std::endl;
+            return false;
+        }
+        std::cout << "data: building events from " << filenames.size() << " list-mode file(s):";
+        for(unsigned int f=0; f<filenames.size(); ++f)
+            std::cout << " '" << filenames[f] << "'";
+        std::cout << std::endl;
+        return SortListMode(filenames);
+    }
+
+    if( tmp == "follow_directory" ) {
+        icmd >> tmp;
+        if( tmp == "on" || tmp == "off" ) {
+            follow_directory = (tmp == "on");
+        } else {
+            std::cerr << "data: Expected data follow_directory on|off, not '" << tmp << "'" << std::endl;
+            return false;
+        }
+        std::cout << "Set following new files in the directory " << tmp << std::endl;
+        return true;
+    }
+
+    if( tmp == "follow_idle" ) {
+        int idle = -1;
+        icmd >> idle;
+        if( idle < 0 ) {
+            std::cerr << "data: Expected data follow_idle <seconds>" << std::endl;
+            return false;
+        }
+        follow_idle = idle;
+        std::cout << "Set end of followed files after " << idle << "s without data" << std::endl;
+        return true;
+    }
+
+    if( tmp == "index" || tmp == "skip_bad" ) {
+        const std::string which = tmp;
+        icmd >> tmp;
+        if( tmp != "on" && tmp != "off" ) {
+            std::cerr << "data: Expected data " << which << " on|off, not '" << tmp << "'" << std::endl;
+            return false;
+        }
+        if( which == "index" ) {
+            make_index = (tmp == "on");
+            std::cout << "Set recording buffer indexes " << tmp << std::endl;
+        } else {
+            skip_bad = (tmp == "on");
+            std::cout << "Set skipping bad buffers from the index " << tmp << std::endl;
+        }
+        return true;
+    }
+
+    if( tmp == "time" ) {
+        icmd >> tmp;
+        if( tmp == "all" ) {
+            time_select = false;
+            std::cout << "Set sorting all times" << std::endl;
+            return true;
+        }
+        std::istringstream ifrom(tmp.c_str());
+        long from = -1, to = -1;
+        ifrom >> from;
+        icmd >> to;
+        if( !ifrom || !icmd || from < 0 || to < from ) {
+            std::cerr << "data: Expected data time <from> <to>|all" << std::endl;
+            return false;
+        }
+        time_select = true;
+        time_from = from;
+        time_to = to;
+        std::cout << "Set sorting times from " << from << " to " << to << std::endl;
+        return true;
+    }
+
+    if( tmp == "glob" ) {
+        std::string pattern;
+        std::getline( icmd, pattern );
+        pattern = trim_whitespace( pattern );
+        if( pattern.empty() ) {
+            std::cerr << "data: Expected data glob <pattern>" << std::endl;
+            return false;
+        }
+        return SortGlob(pattern);
+    }
+
+    if( tmp == "threads" ) {
+        int n = -1;
+        icmd >> n;
+        if( n < 0 ) {
+            std::cerr << "data: Expected data threads <count>" << std::endl;
+            return false;
+        }
+        glob_threads = n;
+        std::cout << "Set threads for data glob to " << n << std::endl;
+        return true;
+    }
+
+    if( tmp == "split" ) {
+        int n = -1;
+        icmd >> n;
+        if( n < 0 ) {
+            std::cerr << "data: Expected data split <threads>" << std::endl;
+            return false;
+        }
+        split_threads = n;
+        std::cout << "Set threads for sorting each buffer to " << n << std::endl;
+        return true;
+    }
+
+    if( tmp == "lookahead" ) {
+        icmd >> tmp;
+        if( tmp == "on" || tmp == "off" ) {
+            lookahead = (tmp == "on");
+        } else {
+            std::cerr << "data: Expected data lookahead on|off, not '" << tmp << "'" << std::endl;
+            return false;
+        }
+        std::cout << "Set reading the next file in advance " << tmp << std::endl;
+        return true;
+    }
+
+    std::string filename;
+    if( !file_arguments(icmd, tmp, filename, buf_start, buf_end, true) )
+        return false;
+
+    // annouce what we will try to do
+    std::cout << "data: reading file '" << filename
+              << "' buffers [" << buf_start << ',';
+    if( buf_end < 0 )
+        std::cout << "end";
+    else
+        std::cout << buf_end;
+    std::cout << "[." << std::endl;
+
+    // and go!
+    return SortFile(filename, buf_start, buf_end);
+}
+
+// ########################################################################
+
+bool OfflineSorting::file_arguments(std::istream& icmd, std::string tmp, std::string& filename,
+                                    int& buf_start, int& buf_end, bool verbose)
+{
+    buf_start = 0;
+    buf_end = maxBuffers;
+
     if( tmp == "buffers" ) {
         icmd >> buf_start >> buf_end >> tmp;
         if( maxBuffers>0 )
@@ -188,33 +1374,57 @@ bool OfflineSorting::data_command(std::istream& icmd)
     }
 
     if( tmp != "file" ) {
-        std::cerr << "data: Expected data [buffers <from> <to>] file <filename>.\n";
+        if( verbose )
+            std::cerr << "data: Expected data [buffers <from> <to>] file <filename>.\n";
         return false;
     }
 
     // extract filename, trying to allow filenames with spaces inside
     std::string filenm;
     std::getline( icmd, filenm );
-    std::string filename = trim_whitespace( filenm );
+    filename = trim_whitespace( filenm );
     if( filename.empty() ) {
-        std::cerr << "data: Do not understand filename '" << filenm << "'" << std::endl;
+        if( verbose )
+            std::cerr << "data: Do not understand filename '" << filenm << "'" << std::endl;
         return false;
     }
     // prepend data_directory, but only for relative paths
     if( !data_directory.empty() && filename[0] != '/' )
         filename = data_directory + "/" + filename;
+    return true;
+}
 
-    // annouce what we will try to do
-    std::cout << "data: reading file '" << filename
-              << "' buffers [" << buf_start << ',';
-    if( buf_end < 0 )
-        std::cout << "end";
-    else
-        std::cout << buf_end;
-    std::cout << "[." << std::endl;
+// ########################################################################
 
-    // and go!
-    return SortFile(filename, buf_start, buf_end);
+void OfflineSorting::prepare_next_file()
+{
+    for(unsigned int i=batch_next; i<batch_commands.size(); ++i) {
+        std::istringstream icmd(batch_commands[i].c_str());
+        std::string name, tmp;
+        icmd >> name >> tmp;
+        if( name != "data" )
+            continue;
+
+        // other 'data' commands might change the file name or the fetcher
+        std::string filename;
+        int buf_start, buf_end;
+        if( file_arguments(icmd, tmp, filename, buf_start, buf_end, false) )
+            bufferFetcher->Prepare(filename, buf_start);
+        return;
+    }
+}
+
+// ########################################################################
+
+void OfflineSorting::report_statistics()
+{
+    UnpackerStatistics& stats = unpack.GetStatistics();
+    if( !unpack.HasStatistics() || stats.IsEmpty() )
+        return;
+
+    stats.Report(std::cout);
+    stats.Fill(userRoutine.GetHistograms());
+    stats.Reset();
 }
 
 // ########################################################################
@@ -276,6 +1486,23 @@ bool OfflineSorting::export_command(std::istream& icmd)
             return false;
         }
         return true;
+    } else if( tmp == "periodic" ) {
+        int interval = -1;
+        icmd >> interval >> tmp;
+        std::string rootfile = trim_whitespace( tmp );
+        if( interval < 0 || (interval > 0 && rootfile.empty()) ) {
+            std::cerr << "export periodic: expected export periodic <seconds> <ROOT filename>" << std::endl;
+            return false;
+        }
+        periodic_interval = interval;
+        periodic_file = rootfile;
+        periodic_last = time(0);
+        if( interval > 0 )
+            std::cout << "export as ROOT file into '" << rootfile << "' every "
+                      << interval << "s while sorting" << std::endl;
+        else
+            std::cout << "no periodic export" << std::endl;
+        return true;
     }
     return false;
 }
@@ -293,9 +1520,15 @@ bool OfflineSorting::next_command(const std::string& cmd)
         leaveprog = 'y';
         return true;
     } else if( name == "data" ) {
-        return data_command(icmd);
+        const bool ok = data_command(icmd);
+        report_statistics();
+        return ok;
     } else if( name == "export" ) {
         return export_command(icmd);
+    } else if( name == "unpacker" ) {
+        return unpack.Command(icmd);
+    } else if( name == "listmode" ) {
+        return listmode.Command(icmd);
     } else if( name == "reset_histograms" ) {
         userRoutine.GetHistograms().ResetAll();
         return true;
@@ -305,7 +1538,10 @@ bool OfflineSorting::next_command(const std::string& cmd)
         SetMaxBuffers(mb);
         return true;
     } else {
-        return userRoutine.Command(cmd);
+        const bool ok = userRoutine.Command(cmd);
+        if( ok )
+            routine_commands.push_back(cmd);
+        return ok;
     }
 }
 
@@ -333,16 +1569,32 @@ bool OfflineSorting::next_commandline(std::istream& in, std::string& cmd_line)
 
 void OfflineSorting::Run(const std::string& batchfilename)
 {
+    // read all commands first, so that the next file is known while
+    // sorting the current one
     std::ifstream batch_file(batchfilename.c_str());
     std::string batch_line;
-    while( leaveprog=='n' && next_commandline(batch_file, batch_line) ) {
+    batch_commands.clear();
+    while( next_commandline(batch_file, batch_line) ) {
         if( batch_line.size()==0 || batch_line[0] == '#' )
             continue;
+        batch_commands.push_back(batch_line);
+    }
+
+    for(batch_next=0; leaveprog=='n' && batch_next<batch_commands.size(); ) {
+        batch_line = batch_commands[batch_next++];
         if( !next_command(batch_line) ) {
             std::cout << "Do not understand batch line '" << batch_line << "'" << std::endl;
             break;
         }
     }
+
+    // an interrupted event cache or skim file would miss events
+    if( event_cache && leaveprog != 'n' )
+        event_cache->Abort();
+    event_cache.reset( 0 );
+    if( skim && leaveprog != 'n' )
+        skim->Abort();
+    skim.reset( 0 );
 }
 
 // ########################################################################
@@ -8,13 +8,22 @@
 #ifndef OFFLINESORTING_H_
 #define OFFLINESORTING_H_
 
+#include "BufferScan.h"
+#include "EventCache.h"
 #include "RateMeter.h"
+#include "RunIndex.h"
+#include "SkimWriter.h"
 #include "Unpacker.h"
 #include "Event.h"
+#include "EventBatch.h"
+#include "ListModeBufferFetcher.h"
 
 #include "aptr.h"
+#include <ctime>
 #include <string>
+#include <vector>
 
+class BufferFetcher;
 class FileBufferFetcher;
 class UserRoutine;
 
@@ -48,27 +57,168 @@ public:
     void SetBufferFetcher(FileBufferFetcher* bf /*!< The object used to read the data files. */);
 
     //! Sort one file.
-    /*! \return true if all was okay.
+    /*! If there is a buffer index for the file, it is used to skip
+     *  bad buffers and buffers outside the time window, if requested.
+     *  Otherwise, if the whole file is sorted, the index is recorded.
+     *
+     *  \return true if all was okay.
      */
     bool SortFile(const std::string& filename, /*!< The name of the file to read. */
                   int begin,                   /*!< The first buffer to read. */
                   int end                      /*!< The last buffer to read. */ );
 
+    //! Sort buffers received from a socket until the sender closes it.
+    /*! \return true if all was okay.
+     */
+    bool SortOnline(const std::string& address /*!< unix:path or tcp:host:port */);
+
+    //! Sort a file that is still being written, waiting for more data at its end.
+    /*! \return true if all was okay.
+     */
+    bool SortFollow(const std::string& filename /*!< The name of the file to follow. */);
+
+    //! Sort events built from list-mode files, one for each digitizer.
+    /*! The events are built as set up with the 'listmode' commands.
+     *
+     *  \return true if all was okay.
+     */
+    bool SortListMode(const std::vector<std::string>& filenames /*!< The names of the files. */);
+
+    //! Sort the events from an event cache file, see 'data write_events'.
+    /*! The time window is applied like for the raw data.
+     *
+     *  \return true if all was okay.
+     */
+    bool SortEvents(const std::string& filename /*!< The name of the event cache file. */);
+
+    //! Sort all files matching a pattern, several files at the same time.
+    /*! Each thread sorts whole files with its own buffer fetcher and
+     *  its own copy of the user routine, made with UserRoutine::New().
+     *  If there are fewer files than threads, files with a buffer index
+     *  are split into ranges of buffers with similar numbers of events,
+     *  see RunIndex::Split().
+     *  The histograms of the copies are added to the histograms of the
+     *  user routine at the end. If the user routine cannot be copied,
+     *  the files are sorted one after the other.
+     *
+     *  \return true if all was okay.
+     */
+    bool SortGlob(const std::string& pattern /*!< The file name pattern, see glob(3). */);
+
 protected:
-    //! Sort one buffer.
+    //! Sort buffers from a fetcher.
+    /*! If the fetcher returns WAIT, the loop continues without
+     *  counting a buffer; the fetcher is expected to wait a little
+     *  before returning WAIT.
+     *
+     *  \return true if all was okay.
+     */
+    bool SortBuffers(BufferFetcher& fetcher, /*!< Where to get the buffers from. */
+                     int begin,              /*!< The number of the first buffer. */
+                     int end                 /*!< The buffer number to stop at, or -1. */ );
+
+    //! Sort the buffers of a file selected using its buffer index.
     /*! \return true if all was okay.
      */
+    bool SortSelected(const std::string& filename, /*!< The name of the file to read. */
+                      const RunIndex& index,       /*!< The buffer index of the file. */
+                      int begin,                   /*!< The first buffer to read. */
+                      int end                      /*!< The last buffer to read. */ );
+
+    //! Sort one buffer.
+    /*! Fills 'buffer_info' with the number of events and the time range.
+     *
+     *  \return true if all was okay.
+     */
     bool SortBuffer(const Buffer* buffer /*<! The buffer to sort. */);
 
 private:
+    //! Sort the buffer given to the unpacker as one EventBatch.
+    /*! \return true if all was okay.
+     */
+    bool SortBatch();
+
+    //! Count the events of a batch for 'buffer_info' and apply the time window.
+    void select_events(EventBatch& batch /*!< The events, events outside the time window are removed. */);
+
+    //! Set the time for the events without time word at the start of a range of buffers.
+    /*! The time is taken from the buffer index: the time of the last
+     *  event with a time word before the range.
+     */
+    void index_time(const RunIndex& index, /*!< The buffer index of the file. */
+                    unsigned int buffer    /*!< The first buffer of the range. */);
+
+    //! Append the events of a batch to the event cache, if one is written.
+    void write_events(const EventBatch& batch /*!< The events of one buffer, before the time window. */);
+
+    //! Append an event to the skim file, if one is written.
+    void write_skim(const Buffer* buffer, /*!< The buffer with the event. */
+                    unsigned int begin    /*!< The position of the event header. */);
+
+    //! Sort a buffer in parts, with several threads.
+    /*! The events are found with BufferScan::Prescan(). Each thread
+     *  unpacks a part of them into its own EventBatch; then the time
+     *  window is applied, and each thread sorts its batch with its own
+     *  copy of the user routine.
+     *
+     *  \return true if all was okay.
+     */
+    bool SortSplit(const Buffer* buffer /*<! The buffer to sort. */);
+
+    //! Start the threads for SortSplit(), if requested with 'data split'.
+    void start_split();
+
+    //! Add the histograms of the copies of the user routine for SortSplit().
+    /*! The histograms of the copies are reset afterwards.
+     */
+    void merge_split();
+
+    //! Stop the threads for SortSplit() and merge their histograms.
+    void stop_split();
+
+    //! Let all parts of SortSplit() do one step, and wait for them.
+    void run_split(int step /*!< What to do, see SplitPart. */);
+
+    //! Helper for pthread_create, running parts for SortSplit().
+    static void* SplitThread(void* v);
+
+    //! Make a copy of the user routine, set up with the same commands.
+    /*! \return the copy, or 0 if the routine cannot be copied
+     */
+    UserRoutine* copy_routine();
+
     //! The user routine for actually making the spectra.
     /*! \return true if all was okay.
      */
     UserRoutine& userRoutine;
 
+    //! Helper for pthread_create, sorting files for SortGlob().
+    static void* GlobThread(void* v);
+
+    //! Find the time of the first event that SortGlob() will sort.
+    /*! Reads the parts in order until an event with a time inside the
+     *  time window is found.
+     *
+     *  \return false if no event has a time
+     */
+    bool glob_start_time(const struct GlobShared& shared, /*!< The parts to sort. */
+                         long& time                       /*!< Set to the time of the first event. */);
+
+    //! Create a buffer fetcher of the type selected with 'data fetcher'.
+    FileBufferFetcher* new_fetcher() const;
+
     //! Handles 'export' commands.
     bool export_command(std::istream& icmd);
 
+    //! Write the histograms into a ROOT file from time to time while sorting.
+    void periodic_export();
+
+    //! Print the unpacker statistics and add them to the histograms, if enabled.
+    /*! Called after each 'data' command; the statistics are reset
+     *  afterwards.
+     */
+    void report_statistics();
+
     //! Handles 'data' commands.
     /*! Reads the parameters and calls SortFile().
      *
@@ -76,6 +226,23 @@ private:
      */
     bool data_command(std::istream& icmd /*!< The part of the command after 'data'. */ );
 
+    //! Read the parameters of a 'data [buffers <from> <to>] file <filename>' command.
+    /*! \return true if all was okay.
+     */
+    bool file_arguments(std::istream& icmd,     /*!< The part of the command after 'data'. */
+                        std::string tmp,        /*!< The first word after 'data', already read. */
+                        std::string& filename,  /*!< The full name of the file. */
+                        int& buf_start,         /*!< The first buffer to read. */
+                        int& buf_end,           /*!< The last buffer to read. */
+                        bool verbose            /*!< True to print error messages. */);
+
+    //! Tell the buffer fetcher which file will be sorted next.
+    /*! Looks for the next 'data' command in the batch file. If it is a
+     *  'data file' command, the buffer fetcher may start reading this
+     *  file while the current one is still being sorted.
+     */
+    void prepare_next_file();
+
     //! Handle a command.
     /*! \return true if all was okay.
      */
@@ -100,9 +267,102 @@ private:
     //! The maximum number of buffers to read from each file.
     int maxBuffers;
 
+    //! True to let the buffer fetcher read the next file in advance.
+    bool lookahead;
+
+    //! The type of buffer fetcher selected with 'data fetcher'.
+    std::string fetcher_type;
+
+    //! The number of buffers read in advance and handed over at once by the 'mt' fetcher.
+    int fetcher_depth, fetcher_batch;
+
+    //! The number of threads for 'data glob', or 0 for one per core.
+    int glob_threads;
+
+    //! The number of threads for sorting each buffer, or 0 to sort in one thread.
+    int split_threads;
+
+    //! The parts of a buffer for SortSplit(); part 0 is sorted in this thread.
+    std::vector<struct SplitPart*> split_parts;
+
+    //! The state shared with the threads of SortSplit().
+    struct SplitShared* split_shared;
+
+    //! Finds the events for SortSplit().
+    BufferScan split_scan;
+
+    //! The event headers for SortSplit().
+    std::vector<unsigned int> split_headers;
+
+    //! True to print no progress messages, for the threads of SortGlob().
+    bool quiet;
+
+    //! The number of buffers and of bad buffers sorted by SortBuffers().
+    int sorted_buffers, bad_buffers;
+
+    //! The commands passed to the user routine, to set up copies for SortGlob().
+    std::vector<std::string> routine_commands;
+
+    //! True to record a buffer index when a file without index is sorted.
+    bool make_index;
+
+    //! True to skip buffers marked as bad in the buffer index.
+    bool skip_bad;
+
+    //! True to sort only events in the time window.
+    bool time_select;
+
+    //! The first and the last time of the time window.
+    long time_from, time_to;
+
+    //! The time of the last event with a time word, for the time window.
+    long event_time;
+
+    //! True if 'event_time' is set.
+    bool event_time_valid;
+
+    //! True after UserRoutine::StartTime() has been called.
+    bool start_time;
+
+    //! The index to add the sorted buffers to, or 0.
+    RunIndex* index_record;
+
+    //! The event cache to write the unpacked events to, if requested with 'data write_events'.
+    aptr<EventCacheWriter> event_cache;
+
+    //! The skim file to write the selected events to, if requested with 'data skim'.
+    aptr<SkimWriter> skim;
+
+    //! The information about the last sorted buffer.
+    RunIndex::Entry buffer_info;
+
+    //! The commands from the batch file.
+    std::vector<std::string> batch_commands;
+
+    //! The index of the next command in 'batch_commands'.
+    unsigned int batch_next;
+
+    //! True to follow new files in the directory of a followed file.
+    bool follow_directory;
+
+    //! The time without changes after which a followed file is finished, or 0 (default 600s).
+    int follow_idle;
+
+    //! The interval for exporting while sorting, in seconds, or 0.
+    int periodic_interval;
+
+    //! The time of the last export while sorting.
+    time_t periodic_last;
+
+    //! The ROOT file for exporting while sorting.
+    std::string periodic_file;
+
     //! The object used to read the files.
     aptr<FileBufferFetcher> bufferFetcher;
 
+    //! The event builder for list-mode files, keeping the 'listmode' settings.
+    ListModeBufferFetcher listmode;
+
     //! The ratemeter for the buffer rate measurement.
     RateMeter rateMeter;
 
@@ -111,6 +371,12 @@ private:
 
     //! The event structure used for unpacking and sorting.
     Event event;
+
+    //! The events of the buffer being sorted, if the routine sorts batches.
+    EventBatch event_batch;
+
+    //! The events in the time window, for the buffer being sorted.
+    std::vector<char> event_selected;
 };
 
 #endif /* OFFLINESORTING_H_ */
@@ -0,0 +1,344 @@
+/*
+ * ParallelGzReader.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef MISSING_ZLIB
+
+#include "ParallelGzReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! Members with more decompressed data than this are read serially.
+static const unsigned int MAX_MEMBER = 8*1024*1024;
+
+//! How many jobs per thread may be waiting or finished ahead of reading.
+static const unsigned int JOBS_PER_THREAD = 2;
+
+int ParallelGzReader::n_threads = std::min(8L, sysconf(_SC_NPROCESSORS_ONLN));
+int ParallelGzReader::n_readers = 1;
+
+// ########################################################################
+
+ParallelGzReader::ParallelGzReader()
+    : map_data( 0 )
+    , map_size( 0 )
+    , scan_pos( 0 )
+    , expected( 0 )
+    , current( 0 )
+    , current_pos( 0 )
+    , in_serial( false )
+    , cancel( false )
+{
+    std::memset(&serial, 0, sizeof(serial));
+    pthread_cond_init( &cond_jobs, 0 );
+}
+
+// ########################################################################
+
+ParallelGzReader::~ParallelGzReader()
+{
+    Close();
+    pthread_cond_destroy( &cond_jobs );
+}
+
+// ########################################################################
+
+int ParallelGzReader::Open(const std::string& filename)
+{
+    Close();
+    const int n = n_threads / n_readers;
+    if( n <= 0 )
+        return 0;
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if( fd<0 )
+        return -1;
+    struct stat st;
+    if( fstat(fd, &st) != 0 || st.st_size < 2 ) {
+        close(fd);
+        return st.st_size < 2 ? 0 : -1;
+    }
+    void* m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( m == MAP_FAILED )
+        return 0;
+    map_data = (const unsigned char*)m;
+    map_size = st.st_size;
+    madvise(m, map_size, MADV_SEQUENTIAL);
+
+    // decompress the first member to see if it is small and followed
+    // by another one
+    Job* first = new Job;
+    first->start = 0;
+    first->discard = false;
+    if( !IsHeader(0) || !Decompress(first) || !IsHeader(first->end) ) {
+        delete first;
+        Close();
+        return 0;
+    }
+    first->state = Job::DONE;
+    jobs.push_back(first);
+    scan_pos = first->end;
+
+    cancel = false;
+    threads.resize(n);
+    for(int i=0; i<n; ++i) {
+        if( pthread_create( &threads[i], NULL, ParallelGzReader::Run, this ) != 0 ) {
+            std::cerr << "cannot create decompression thread." << std::endl;
+            exit( -1 );
+        }
+    }
+    return 1;
+}
+
+// ########################################################################
+
+void ParallelGzReader::Close()
+{
+    { // critical section
+        PThreadMutexLock lock( mutex );
+        cancel = true;
+        pthread_cond_broadcast( &cond_jobs );
+    } // unlock in 'lock' destructor
+    for(unsigned int i=0; i<threads.size(); ++i)
+        pthread_join( threads[i], NULL );
+    threads.clear();
+
+    for(unsigned int i=0; i<jobs.size(); ++i)
+        delete jobs[i];
+    jobs.clear();
+    delete current;
+    current = 0;
+
+    if( in_serial ) {
+        inflateEnd(&serial);
+        in_serial = false;
+    }
+    if( map_data ) {
+        munmap((void*)map_data, map_size);
+        map_data = 0;
+    }
+    map_size = scan_pos = expected = 0;
+}
+
+// ########################################################################
+
+bool ParallelGzReader::IsHeader(off_t pos) const
+{
+    // magic bytes, deflate method, reserved flag bits zero
+    return pos+10 <= map_size && map_data[pos] == 0x1f && map_data[pos+1] == 0x8b
+        && map_data[pos+2] == 8 && (map_data[pos+3] & 0xe0) == 0;
+}
+
+// ########################################################################
+
+bool ParallelGzReader::AddJob()
+{
+    while( scan_pos < map_size ) {
+        const void* p = std::memchr(map_data + scan_pos, 0x1f, map_size - scan_pos);
+        if( !p ) {
+            scan_pos = map_size;
+            break;
+        }
+        const off_t pos = (const unsigned char*)p - map_data;
+        scan_pos = pos + 1;
+        if( IsHeader(pos) ) {
+            Job* job = new Job;
+            job->start = pos;
+            job->end = 0;
+            job->state = Job::PENDING;
+            job->discard = false;
+            jobs.push_back(job);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ########################################################################
+
+bool ParallelGzReader::Decompress(Job* job)
+{
+    z_stream strm;
+    std::memset(&strm, 0, sizeof(strm));
+    if( inflateInit2(&strm, 31) != Z_OK )
+        return false;
+
+    const unsigned char* in = map_data + job->start;
+    const off_t avail = map_size - job->start;
+    strm.next_in  = (Bytef*)in;
+    strm.avail_in = std::min(avail, off_t(1)<<30);
+
+    job->data.resize(256*1024);
+    bool okay = false;
+    // 'discard' is set by NextMember() while this runs without the mutex
+    while( !__atomic_load_n(&job->discard, __ATOMIC_SEQ_CST) ) {
+        if( strm.total_out == job->data.size() ) {
+            if( job->data.size() >= MAX_MEMBER )
+                break;
+            job->data.resize(std::min<size_t>(2*job->data.size(), MAX_MEMBER));
+        }
+        strm.next_out  = (Bytef*)&job->data[strm.total_out];
+        strm.avail_out = job->data.size() - strm.total_out;
+
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        if( ret == Z_STREAM_END ) {
+            okay = true;
+            break;
+        } else if( ret != Z_OK && !(ret == Z_BUF_ERROR && strm.avail_out == 0) ) {
+            break;
+        }
+    }
+    job->data.resize(strm.total_out);
+    job->end = job->start + strm.total_in;
+    inflateEnd(&strm);
+    return okay;
+}
+
+// ########################################################################
+
+void ParallelGzReader::Work()
+{
+    PThreadMutexLock lock( mutex );
+    while( !cancel ) {
+        // find the first pending job, or add a new one
+        Job* job = 0;
+        for(unsigned int i=0; i<jobs.size() && !job; ++i) {
+            if( jobs[i]->state == Job::PENDING )
+                job = jobs[i];
+        }
+        if( !job && jobs.size() < JOBS_PER_THREAD*threads.size() && AddJob() )
+            job = jobs.back();
+        if( !job ) {
+            mutex.Wait( &cond_jobs );
+            continue;
+        }
+
+        job->state = Job::RUNNING;
+        mutex.Unlock();
+        const bool okay = Decompress(job);
+        mutex.Lock();
+
+        if( job->discard ) {
+            delete job;
+        } else {
+            job->state = okay ? Job::DONE : Job::FAILED;
+            pthread_cond_broadcast( &cond_jobs );
+        }
+    }
+}
+
+// ########################################################################
+
+int ParallelGzReader::NextMember()
+{
+    PThreadMutexLock lock( mutex );
+    delete current;
+    current = 0;
+    current_pos = 0;
+
+    while( true ) {
+        // drop candidates inside the previous member
+        while( !jobs.empty() && jobs.front()->start < expected ) {
+            Job* job = jobs.front();
+            jobs.pop_front();
+            if( job->state == Job::RUNNING )
+                __atomic_store_n(&job->discard, true, __ATOMIC_SEQ_CST);
+            else
+                delete job;
+            pthread_cond_broadcast( &cond_jobs );
+        }
+        if( jobs.empty() && scan_pos < expected )
+            scan_pos = expected;
+
+        if( expected >= map_size || (!IsHeader(expected) && expected+10 <= map_size) ) {
+            // end of file, or trailing data that are not a gzip member
+            return 0;
+        }
+        if( jobs.empty() && !AddJob() )
+            return 0;
+
+        Job* job = jobs.front();
+        if( job->start != expected ) {
+            // a member must start at 'expected'; cannot happen for
+            // valid files because all headers are candidates
+            return -1;
+        }
+        if( job->state == Job::PENDING || job->state == Job::RUNNING ) {
+            mutex.Wait( &cond_jobs );
+            continue;
+        }
+
+        jobs.pop_front();
+        pthread_cond_broadcast( &cond_jobs );
+        if( job->state == Job::DONE ) {
+            current = job;
+            expected = job->end;
+            return 1;
+        }
+
+        // decompression failed or member too large: read it serially
+        delete job;
+        if( inflateInit2(&serial, 31) != Z_OK )
+            return -1;
+        serial.next_in  = (Bytef*)(map_data + expected);
+        serial.avail_in = std::min(map_size - expected, off_t(1)<<30);
+        serial.total_in = 0;
+        in_serial = true;
+        return 1;
+    }
+}
+
+// ########################################################################
+
+int ParallelGzReader::Read(char* data, unsigned int size)
+{
+    while( true ) {
+        if( in_serial ) {
+            serial.next_out  = (Bytef*)data;
+            serial.avail_out = size;
+            const int ret = inflate(&serial, Z_NO_FLUSH);
+            const int have = size - serial.avail_out;
+            if( ret == Z_STREAM_END ) {
+                expected += serial.total_in;
+                inflateEnd(&serial);
+                in_serial = false;
+            } else if( ret != Z_OK ) {
+                return -1;
+            } else if( serial.avail_in == 0 ) {
+                // more than 1GB of compressed data in one member
+                const off_t pos = (const unsigned char*)serial.next_in - map_data;
+                serial.avail_in = std::min(map_size - pos, off_t(1)<<30);
+                if( serial.avail_in == 0 )
+                    return -1;
+            }
+            if( have>0 )
+                return have;
+            continue;
+        }
+
+        if( current && current_pos < current->data.size() ) {
+            const unsigned int n = std::min(size, (unsigned int)(current->data.size() - current_pos));
+            std::memcpy(data, &current->data[current_pos], n);
+            current_pos += n;
+            return n;
+        }
+
+        const int nm = NextMember();
+        if( nm <= 0 )
+            return nm;
+    }
+}
+
+#endif /* MISSING_ZLIB */
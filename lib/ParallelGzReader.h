@@ -0,0 +1,167 @@
+/* -*- c++ -*-
+ * ParallelGzReader.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef PARALLELGZREADER_H_
+#define PARALLELGZREADER_H_
+
+#ifndef MISSING_ZLIB
+
+#include "FileReaderBackend.h"
+#include "PThreadMutex.h"
+
+#include <deque>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include <zlib.h>
+
+//! Decompress gzip files with many members using several threads.
+/*! Files written by bgzip, by pigz-like tools writing independent
+ *  members, or by concatenating gzip files consist of many
+ *  independent gzip members. The file is memory-mapped and scanned
+ *  for gzip headers; each header is a candidate for the start of a
+ *  member and is decompressed by a pool of threads. The data are
+ *  returned in order by following the chain of members: the next
+ *  member starts where the previous one ended, and candidates that
+ *  are not at such a position (gzip magic bytes inside compressed
+ *  data) are discarded.
+ *
+ *  Files with only one member, or with members that are too large,
+ *  are not handled; Open() returns 0 and FileReader uses gzread().
+ */
+class ParallelGzReader : public FileReaderBackend {
+public:
+    ParallelGzReader();
+
+    //! Stops the threads and unmaps the file.
+    ~ParallelGzReader();
+
+    //! Map the file and check if it has many small members.
+    /*! \return 1 if the file can be read in parallel, 0 if it should
+     *          be read in the normal way, -1 for error
+     */
+    int Open(const std::string& filename /*!< The name of the file to open. */);
+
+    int Read(char* data, unsigned int size);
+
+    //! Set the number of decompression threads for files opened later.
+    /*! If the number is 0, parallel decompression is disabled.
+     */
+    static void SetThreads(int n /*!< The number of threads. */)
+        { n_threads = n; }
+
+    //! Get the number of decompression threads.
+    static int GetThreads()
+        { return n_threads; }
+
+    //! Set the number of files read at the same time.
+    /*! The decompression threads are divided among them; if there are
+     *  fewer threads than files, files are read in the normal way.
+     */
+    static void SetReaders(int n /*!< The number of files, at least 1. */)
+        { n_readers = n; }
+
+private:
+    //! A member or member candidate to decompress.
+    struct Job {
+        //! Offset of the candidate gzip header in the file.
+        off_t start;
+
+        //! Offset after the member's trailer, if decompressed successfully.
+        off_t end;
+
+        //! The state of the job.
+        enum { PENDING, RUNNING, DONE, FAILED } state;
+
+        //! Set if the job is no longer needed while a thread works on it.
+        /*! Read by Decompress() without the mutex, so it is accessed
+         *  atomically there and where it is set.
+         */
+        bool discard;
+
+        //! The decompressed data.
+        std::vector<char> data;
+    };
+
+    //! Stop the threads and unmap the file.
+    void Close();
+
+    //! Decompress one member.
+    /*! \return true if the member was decompressed completely.
+     */
+    bool Decompress(Job* job /*!< The job describing the member. */);
+
+    //! Find the next candidate gzip header and add a job for it.
+    /*! Must be called with the mutex locked.
+     *
+     *  \return false if there are no more candidates
+     */
+    bool AddJob();
+
+    //! Check for a gzip header at an offset.
+    bool IsHeader(off_t pos) const;
+
+    //! The main loop of the decompression threads.
+    void Work();
+
+    //! Helper for pthread_create.
+    static void* Run(void* v)
+        { ((ParallelGzReader*)v)->Work(); return 0; }
+
+    //! Make the first job the current one after the current one is used up.
+    /*! \return 1 if okay, 0 at the end of the file, -1 for error
+     */
+    int NextMember();
+
+    //! The mapped file.
+    const unsigned char* map_data;
+
+    //! The size of the mapped file.
+    off_t map_size;
+
+    //! Where to continue scanning for candidates.
+    off_t scan_pos;
+
+    //! Where the next member must start.
+    off_t expected;
+
+    //! The jobs, sorted by their start offset.
+    std::deque<Job*> jobs;
+
+    //! The member that is being read, or 0.
+    Job* current;
+
+    //! The read position in the current member.
+    unsigned int current_pos;
+
+    //! Decompressor used if a member cannot be decompressed in parallel.
+    z_stream serial;
+
+    //! True while reading a member with the 'serial' decompressor.
+    bool in_serial;
+
+    //! The threads.
+    std::vector<pthread_t> threads;
+
+    //! Flag set to stop the threads.
+    bool cancel;
+
+    //! The mutex for synchronizing access to 'jobs'.
+    PThreadMutex mutex;
+
+    //! The condition "job added or finished".
+    pthread_cond_t cond_jobs;
+
+    //! The number of threads to use for new files.
+    static int n_threads;
+
+    //! The number of files read at the same time.
+    static int n_readers;
+};
+
+#endif /* MISSING_ZLIB */
+
+#endif /* PARALLELGZREADER_H_ */
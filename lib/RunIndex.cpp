@@ -0,0 +1,152 @@
+/*
+ * RunIndex.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "RunIndex.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The marker at the start of a sidecar file.
+static const char MAGIC[8] = { 'S', 'I', 'R', 'B', 'U', 'F', 'X', '1' };
+
+// ########################################################################
+
+static bool write64(std::FILE* f, long long v)
+{
+    return std::fwrite(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool read64(std::FILE* f, long long& v)
+{
+    return std::fread(&v, sizeof(v), 1, f) == 1;
+}
+
+// ########################################################################
+// ########################################################################
+
+RunIndex::RunIndex(const std::string& datafilename)
+    : filename( datafilename )
+    , src_size( -1 )
+    , src_mtime( 0 )
+{
+    struct stat st;
+    if( stat(filename.c_str(), &st) == 0 ) {
+        src_size  = st.st_size;
+        src_mtime = st.st_mtime;
+    }
+}
+
+// ########################################################################
+
+bool RunIndex::Read()
+{
+    entries.clear();
+    if( src_size < 0 )
+        return false;
+
+    std::FILE* idxfile = std::fopen(IndexName(filename).c_str(), "rb");
+    if( !idxfile )
+        return false;
+
+    char magic[sizeof(MAGIC)];
+    long long size, mtime, count;
+    bool ok = std::fread(magic, sizeof(magic), 1, idxfile) == 1
+        && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+        && read64(idxfile, size) && read64(idxfile, mtime) && read64(idxfile, count);
+    if( ok && (size != src_size || mtime != src_mtime) ) {
+        std::cout << "bufidx: '" << filename << "' has changed, ignoring index." << std::endl;
+        ok = false;
+    }
+    // each entry has 5 numbers; a damaged file must not make a huge allocation
+    struct stat st;
+    const long long header = sizeof(MAGIC) + 3*8, entry = 5*8;
+    if( ok && (fstat(fileno(idxfile), &st) != 0 || st.st_size < header
+               || (st.st_size - header) % entry != 0 || count != (st.st_size - header) / entry) ) {
+        std::cout << "bufidx: '" << IndexName(filename) << "' is damaged, ignoring index." << std::endl;
+        ok = false;
+    }
+    if( ok ) {
+        entries.resize(count);
+        for(int i=0; ok && i<count; ++i) {
+            long long offset, first, last, events, flags;
+            ok = read64(idxfile, offset) && read64(idxfile, first) && read64(idxfile, last)
+                && read64(idxfile, events) && read64(idxfile, flags);
+            Entry& e = entries[i];
+            e.offset     = offset;
+            e.time_first = first;
+            e.time_last  = last;
+            e.events     = events;
+            e.okay       = (flags & 1) != 0;
+            e.has_time   = (flags & 2) != 0;
+        }
+    }
+    std::fclose(idxfile);
+    if( !ok )
+        entries.clear();
+    return ok;
+}
+
+// ########################################################################
+
+bool RunIndex::Write() const
+{
+    const std::string indexname = IndexName(filename), tmp = indexname + ".tmp";
+    std::FILE* idxfile = std::fopen(tmp.c_str(), "wb");
+    if( !idxfile ) {
+        std::cerr << "bufidx: cannot write index file '" << indexname << "'." << std::endl;
+        return false;
+    }
+
+    bool ok = std::fwrite(MAGIC, sizeof(MAGIC), 1, idxfile) == 1
+        && write64(idxfile, src_size) && write64(idxfile, src_mtime)
+        && write64(idxfile, entries.size());
+    for(unsigned int i=0; ok && i<entries.size(); ++i) {
+        const Entry& e = entries[i];
+        const long long flags = (e.okay ? 1 : 0) | (e.has_time ? 2 : 0);
+        ok = write64(idxfile, e.offset) && write64(idxfile, e.time_first)
+            && write64(idxfile, e.time_last) && write64(idxfile, e.events)
+            && write64(idxfile, flags);
+    }
+    ok = (std::fclose(idxfile) == 0) && ok;
+    ok = ok && std::rename(tmp.c_str(), indexname.c_str()) == 0;
+    if( !ok ) {
+        std::cerr << "bufidx: error writing index file '" << indexname << "'." << std::endl;
+        std::remove(tmp.c_str());
+    }
+    return ok;
+}
+
+// ########################################################################
+
+std::vector<unsigned int> RunIndex::Split(unsigned int begin, unsigned int end, unsigned int parts) const
+{
+    if( end > entries.size() )
+        end = entries.size();
+    if( begin > end )
+        begin = end;
+    if( parts == 0 )
+        parts = 1;
+
+    long long total = 0;
+    for(unsigned int b=begin; b<end; ++b)
+        total += entries[b].events;
+
+    // start a new part each time the event sum passes a multiple of total/parts
+    std::vector<unsigned int> starts(1, begin);
+    long long sum = 0;
+    for(unsigned int b=begin; b<end && starts.size()<parts; ++b) {
+        if( sum*parts >= total*(long long)starts.size() && b > starts.back() )
+            starts.push_back(b);
+        sum += entries[b].events;
+    }
+    starts.push_back(end);
+    return starts;
+}
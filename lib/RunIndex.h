@@ -0,0 +1,107 @@
+/* -*- c++ -*-
+ * RunIndex.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef RUNINDEX_H_
+#define RUNINDEX_H_
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+//! A per-buffer index of a data file.
+/*! For each buffer, the index records the position in the
+ *  (uncompressed) data, the number of events, whether the buffer could
+ *  be unpacked, and the first and last wall-clock time. It is stored in
+ *  a sidecar file next to the data file (name with
+ *  <code>.bufidx</code> appended) and written by the first complete
+ *  sort of a file or by the sortscan tool. Later sorts can use it to
+ *  skip bad buffers and to select buffers by time without reading
+ *  them.
+ *
+ *  The sidecar records size and modification time of the data file
+ *  and is ignored if the data file has changed.
+ */
+class RunIndex {
+public:
+    //! The information for one buffer.
+    struct Entry {
+        //! The position of the buffer in the uncompressed data, in bytes.
+        off_t offset;
+
+        //! The time of the first event with a time word.
+        long time_first;
+
+        //! The time of the last event with a time word.
+        long time_last;
+
+        //! The number of events that could be unpacked.
+        unsigned int events;
+
+        //! True if the buffer could be unpacked without error.
+        bool okay;
+
+        //! True if 'time_first' and 'time_last' are set.
+        bool has_time;
+    };
+
+    //! Prepare an empty index for a data file.
+    RunIndex(const std::string& datafilename /*!< The name of the data file. */);
+
+    //! Read the sidecar file.
+    /*! \return false if there is no valid index for the data file
+     */
+    bool Read();
+
+    //! Write the sidecar file.
+    /*! The index is written to a temporary file that is renamed, so
+     *  that readers never see a partial index.
+     *
+     *  \return false if the index could not be written
+     */
+    bool Write() const;
+
+    //! Remove all entries.
+    void Clear()
+        { entries.clear(); }
+
+    //! Add the entry for the next buffer.
+    void Add(const Entry& e /*!< The information for the buffer. */)
+        { entries.push_back(e); }
+
+    //! The number of buffers in the index.
+    unsigned int Size() const
+        { return entries.size(); }
+
+    //! Get the entry for a buffer.
+    const Entry& operator[](unsigned int b /*!< The buffer number. */) const
+        { return entries[b]; }
+
+    //! Split a range of buffers into parts with similar event counts.
+    /*! \return the first buffer of each part, followed by 'end'
+     */
+    std::vector<unsigned int> Split(unsigned int begin, /*!< The first buffer. */
+                                    unsigned int end,   /*!< The buffer after the last. */
+                                    unsigned int parts  /*!< The number of parts. */) const;
+
+    //! Get the name of the sidecar file for a data file.
+    static std::string IndexName(const std::string& datafilename /*!< The name of the data file. */)
+        { return datafilename + ".bufidx"; }
+
+private:
+    //! The name of the data file.
+    std::string filename;
+
+    //! The size of the data file when the index was created.
+    long long src_size;
+
+    //! The modification time of the data file when the index was created.
+    long long src_mtime;
+
+    //! The entries, one per buffer.
+    std::vector<Entry> entries;
+};
+
+#endif /* RUNINDEX_H_ */
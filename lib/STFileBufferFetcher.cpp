@@ -4,9 +4,10 @@
 const Buffer* STFileBufferFetcher::Next(Status& state)
 {
     int i = reader.Read( (char*)buffer.GetBuffer(), 4*buffer.GetSize() );
-    if( i>0 )
+    if( i>0 ) {
+        byte_order.Fix(buffer.GetBuffer(), buffer.GetSize());
         state=OKAY;
-    else if( i==0 )
+    } else if( i==0 )
         state=END;
     else
         state=ERROR;
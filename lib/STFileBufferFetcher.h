@@ -8,6 +8,7 @@
 #ifndef STFILEBUFFERFETCHER_H_
 #define STFILEBUFFERFETCHER_H_
 
+#include "ByteOrder.h"
 #include "FileBufferFetcher.h"
 #include "FileReader.h"
 #include "Buffer.h"
@@ -22,9 +23,9 @@ public:
 
     /*! Calls the reader to open a file. */
     Status Open(const std::string& filename, int bufnum)
-        { return reader.Open(filename, bufnum*buffer.GetSize()*4) ? OKAY : ERROR; }
+        { byte_order.Reset(); return reader.Open(filename, off_t(bufnum)*buffer.GetSize()*4) ? OKAY : ERROR; }
 
-    /*! Calls the reader to fetch a buffer. */
+    /*! Calls the reader to fetch a buffer, and fixes its byte order. */
     const Buffer* Next(Status& state);
 
 private:
@@ -33,6 +34,9 @@ private:
 
     //! The buffer used to store the file data in.
     SiriusBuffer buffer;
+
+    //! The byte order of the file.
+    ByteOrder byte_order;
 };
 
 #endif /* STFILEBUFFERFETCHER_H_ */
@@ -33,6 +33,7 @@ SiriusRoutine::SiriusRoutine()
     , gain_tge ( GetParameters(), "gain_tge",   6, 1 )
     , gain_tna ( GetParameters(), "gain_tna",  32, 1 )
     , time_start( 0 )
+    , time_origin( this )
     , time_diff( 0 )
 {
 }
@@ -130,9 +131,19 @@ bool SiriusRoutine::Command(const std::string& cmd)
 unsigned long SiriusRoutine::Timediff(const Event& event)
 {
     if( event.has_time ) {
-        if( time_start == 0 )
+        // copies never change the time of the original, which is
+        // set with StartTime() before they sort
+        if( time_origin == this && time_start == 0 )
             time_start = event.time;
-        time_diff = event.time - time_start;
+        time_diff = event.time - time_origin->time_start;
     }
     return time_diff;
 }
+
+// ########################################################################
+
+void SiriusRoutine::StartTime(long time)
+{
+    if( time_origin == this && time_start == 0 )
+        time_start = time;
+}
@@ -20,8 +20,15 @@ public:
     bool Command(const std::string& cmd);
     bool End();
 
+    //! Count the time from 'time', unless there was a timestamp before.
+    void StartTime(long time);
+
 protected:
     //! Obtain the number of seconds since the first timestamp.
+    /*! The first timestamp is the first one seen by this object or
+     *  given with StartTime(); copies set up with ShareStartTime()
+     *  count from the same time as the original.
+     */
     unsigned long Timediff(const Event& event /*!< The event structure maybe containing a new timestamp. */);
 
     //! Create all spectra.
@@ -29,6 +36,10 @@ protected:
      */
     virtual void CreateSpectra() = 0;
 
+    //! Let a copy made in New() count the time from the first timestamp of this object.
+    void ShareStartTime(SiriusRoutine& copy /*!< The new copy. */) const
+        { copy.time_origin = time_origin; }
+
     //! Create a 1D histogram.
     Histogram1Dp Spec( const std::string& name,  /*!< The name of the new histogram. */
                        const std::string& title, /*!< The title of teh new histogram. */
@@ -92,6 +103,9 @@ private:
     //! The first timestamp seen.
     unsigned long time_start;
 
+    //! The routine with the first timestamp, this one or the one it was copied from.
+    const SiriusRoutine* time_origin;
+
     //! The time in seconds since the first timestamp.
     unsigned long time_diff;
 };
@@ -0,0 +1,103 @@
+/*
+ * SkimWriter.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "SkimWriter.h"
+
+#include "DataWord.h"
+
+#include <cstring>
+#include <iostream>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+SkimWriter::SkimWriter()
+    : file( "skim" )
+    , pos( 0 )
+    , n_events( 0 )
+    , n_buffers( 0 )
+{
+}
+
+// ########################################################################
+
+SkimWriter::~SkimWriter()
+{
+    if( file.IsOpen() )
+        Close();
+}
+
+// ########################################################################
+
+bool SkimWriter::Open(const std::string& fname)
+{
+    if( file.IsOpen() )
+        Close();
+
+    if( !file.Open(fname) )
+        return false;
+    pos = 0;
+    n_events = n_buffers = 0;
+    return true;
+}
+
+// ########################################################################
+
+bool SkimWriter::Write(const Buffer* from, unsigned int begin, unsigned int end)
+{
+    if( !file.IsOpen() )
+        return false;
+
+    // leave room for the end-of-buffer marker
+    const unsigned int n = end - begin;
+    if( pos + n + 1 > buffer.GetSize() && !Flush() )
+        return false;
+
+    std::memcpy(buffer.GetBuffer() + pos, from->GetBuffer() + begin, n*4);
+    pos += n;
+    n_events += 1;
+    return true;
+}
+
+// ########################################################################
+
+bool SkimWriter::Flush()
+{
+    if( pos == 0 )
+        return true;
+
+    unsigned int* data = buffer.GetBuffer();
+    const unsigned int size = buffer.GetSize();
+    data[pos++] = EOB;
+    std::memset(data + pos, 0, (size - pos)*4);
+    pos = 0;
+
+    if( !file.Write(data, size*4) )
+        return false;
+    n_buffers += 1;
+    return true;
+}
+
+// ########################################################################
+
+bool SkimWriter::Close()
+{
+    if( !file.IsOpen() || !Flush() || !file.Close() )
+        return false;
+
+    std::cout << "skim: wrote " << n_events << " events in " << n_buffers
+              << " buffers to '" << file.GetFilename() << "'." << std::endl;
+    return true;
+}
+
+// ########################################################################
+
+void SkimWriter::Abort()
+{
+    file.Abort();
+}
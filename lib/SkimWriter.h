@@ -0,0 +1,71 @@
+/* -*- c++ -*-
+ * SkimWriter.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef SKIMWRITER_H_
+#define SKIMWRITER_H_
+
+#include "Buffer.h"
+#include "TmpFile.h"
+
+#include <string>
+
+//! Writes selected events into a new data file with sirius buffers.
+/*! The events are copied word by word, with their headers, into
+ *  buffers of the usual size, each ended with the end-of-buffer
+ *  marker. The skim file can be read like any other data file, and
+ *  is in the byte order of the machine writing it.
+ */
+class SkimWriter {
+public:
+    //! Prepare to write.
+    SkimWriter();
+
+    //! Finish the file, see Close().
+    ~SkimWriter();
+
+    //! Start writing a skim file.
+    /*! The file is written under a temporary name and renamed when
+     *  closed.
+     *
+     *  \return false if the file cannot be created
+     */
+    bool Open(const std::string& filename /*!< The name of the skim file. */);
+
+    //! Append one event.
+    /*! \return false if writing failed; the file is then removed
+     */
+    bool Write(const Buffer* from,      /*!< The buffer containing the event. */
+               unsigned int begin,      /*!< The position of the event header. */
+               unsigned int end         /*!< The position after the last data word. */);
+
+    //! Finish the file and give it its final name.
+    /*! \return false if there was an error
+     */
+    bool Close();
+
+    //! Remove an unfinished file.
+    void Abort();
+
+private:
+    //! Write the buffer with the collected events.
+    /*! \return false if writing failed; the file is then removed
+     */
+    bool Flush();
+
+    //! The file being written.
+    TmpFile file;
+
+    //! The buffer being filled.
+    SiriusBuffer buffer;
+
+    //! The number of words used in 'buffer'.
+    unsigned int pos;
+
+    //! Counters for the message after closing.
+    long long n_events, n_buffers;
+};
+
+#endif /* SKIMWRITER_H_ */
@@ -0,0 +1,179 @@
+/*
+ * SocketBufferFetcher.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "SocketBufferFetcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! How long Next() waits for data before returning WAIT, in ms.
+static const int WAIT_MS = 250;
+
+// ########################################################################
+
+SocketBufferFetcher::SocketBufferFetcher()
+    : fd( -1 )
+    , have( 0 )
+{
+}
+
+// ########################################################################
+
+SocketBufferFetcher::~SocketBufferFetcher()
+{
+    Close();
+}
+
+// ########################################################################
+
+void SocketBufferFetcher::Close()
+{
+    if( fd >= 0 ) {
+        close(fd);
+        fd = -1;
+    }
+    have = 0;
+    byte_order.Reset();
+}
+
+// ########################################################################
+
+BufferFetcher::Status SocketBufferFetcher::Open(const std::string& address)
+{
+    Close();
+    fd = OpenSocket(address, false);
+    return fd >= 0 ? OKAY : ERROR;
+}
+
+// ########################################################################
+
+int SocketBufferFetcher::OpenSocket(const std::string& address, bool listening)
+{
+    int s = -1;
+    if( address.compare(0, 5, "unix:") == 0 ) {
+        const std::string path = address.substr(5);
+        sockaddr_un sun;
+        std::memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if( path.empty() || path.size() >= sizeof(sun.sun_path) ) {
+            std::cerr << "socket: bad path in '" << address << "'." << std::endl;
+            return -1;
+        }
+        std::strcpy(sun.sun_path, path.c_str());
+
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if( s < 0 )
+            return -1;
+        if( listening ) {
+            unlink(path.c_str());
+            if( bind(s, (sockaddr*)&sun, sizeof(sun)) != 0 || listen(s, 1) != 0 ) {
+                close(s);
+                s = -1;
+            }
+        } else if( connect(s, (sockaddr*)&sun, sizeof(sun)) != 0 ) {
+            close(s);
+            s = -1;
+        }
+    } else if( address.compare(0, 4, "tcp:") == 0 ) {
+        const std::string::size_type colon = address.rfind(':');
+        const std::string host = address.substr(4, colon-4);
+        const std::string port = address.substr(colon+1);
+        if( colon < 4 || port.empty() ) {
+            std::cerr << "socket: expected tcp:host:port, not '" << address << "'." << std::endl;
+            return -1;
+        }
+
+        addrinfo hints, *res = 0;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = listening ? AI_PASSIVE : 0;
+        const int g = getaddrinfo(host.empty() ? 0 : host.c_str(), port.c_str(), &hints, &res);
+        if( g != 0 ) {
+            std::cerr << "socket: cannot resolve '" << address << "': " << gai_strerror(g) << std::endl;
+            return -1;
+        }
+        for(addrinfo* ai = res; ai && s<0; ai = ai->ai_next) {
+            s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if( s < 0 )
+                continue;
+            bool ok;
+            if( listening ) {
+                const int one = 1;
+                setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                ok = bind(s, ai->ai_addr, ai->ai_addrlen) == 0 && listen(s, 1) == 0;
+            } else {
+                ok = connect(s, ai->ai_addr, ai->ai_addrlen) == 0;
+            }
+            if( !ok ) {
+                close(s);
+                s = -1;
+            }
+        }
+        freeaddrinfo(res);
+    } else {
+        std::cerr << "socket: expected unix:path or tcp:host:port, not '" << address << "'." << std::endl;
+        return -1;
+    }
+
+    if( s < 0 )
+        std::cerr << "socket: cannot " << (listening ? "listen on" : "connect to")
+                  << " '" << address << "': " << std::strerror(errno) << std::endl;
+    return s;
+}
+
+// ########################################################################
+
+const Buffer* SocketBufferFetcher::Next(Status& state)
+{
+    if( fd < 0 ) {
+        state = ERROR;
+        return 0;
+    }
+
+    const unsigned int bytes = buffer.GetSize()*4;
+    char* data = (char*)buffer.GetBuffer();
+    while( have < bytes ) {
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        const int p = poll(&pfd, 1, WAIT_MS);
+        if( p == 0 || (p < 0 && errno == EINTR) ) {
+            // keep what we have and try again later
+            state = WAIT;
+            return 0;
+        } else if( p < 0 ) {
+            state = ERROR;
+            return 0;
+        }
+
+        const ssize_t n = recv(fd, data + have, bytes - have, 0);
+        if( n < 0 && (errno == EINTR || errno == EAGAIN) )
+            continue;
+        if( n <= 0 ) {
+            // the server closed the connection; a partial buffer is an error
+            state = (n == 0 && have == 0) ? END : ERROR;
+            Close();
+            return 0;
+        }
+        have += n;
+    }
+
+    have = 0;
+    byte_order.Fix(buffer.GetBuffer(), buffer.GetSize());
+    state = OKAY;
+    return &buffer;
+}
@@ -0,0 +1,66 @@
+/* -*- c++ -*-
+ * SocketBufferFetcher.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef SOCKETBUFFERFETCHER_H_
+#define SOCKETBUFFERFETCHER_H_
+
+#include "BufferFetcher.h"
+#include "ByteOrder.h"
+
+#include <string>
+
+//! Fetch buffers from a UNIX-domain or TCP socket.
+/*! The sorting connects to a server, e.g. the acquisition or the
+ *  siriusreplay tool, which sends complete sirius buffers. The
+ *  address is <code>unix:/path/to/socket</code> or
+ *  <code>tcp:host:port</code>.
+ *
+ *  Next() waits a short time for data; if no complete buffer arrives,
+ *  it returns WAIT and keeps the data received so far. When the
+ *  server closes the connection, Next() returns END.
+ */
+class SocketBufferFetcher : public BufferFetcher {
+public:
+    //! Construct the buffer fetcher.
+    SocketBufferFetcher();
+
+    //! Closes the connection.
+    ~SocketBufferFetcher();
+
+    //! Connect to the server.
+    /*! \return OKAY if connected, ERROR otherwise.
+     */
+    Status Open(const std::string& address /*!< Where to connect to. */);
+
+    const Buffer* Next(Status& state);
+
+    //! Create a socket for an address.
+    /*! Used by the sorting to connect and by the replay tool to
+     *  listen for the sorting.
+     *
+     *  \return the socket file descriptor, or -1 for error
+     */
+    static int OpenSocket(const std::string& address, /*!< The address. */
+                          bool listening              /*!< True to listen, false to connect. */);
+
+private:
+    //! Close the connection.
+    void Close();
+
+    //! The connected socket, or -1.
+    int fd;
+
+    //! The buffer to receive data into.
+    SiriusBuffer buffer;
+
+    //! The number of bytes received for 'buffer'.
+    unsigned int have;
+
+    //! The byte order of the sender.
+    ByteOrder byte_order;
+};
+
+#endif /* SOCKETBUFFERFETCHER_H_ */
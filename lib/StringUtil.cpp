@@ -0,0 +1,17 @@
+/*
+ * StringUtil.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "StringUtil.h"
+
+#include <cstring>
+
+// ########################################################################
+
+bool ends_with(const std::string& text, const char* end)
+{
+    const size_t n = std::strlen(end);
+    return text.size() >= n && text.compare(text.size()-n, n, end) == 0;
+}
@@ -0,0 +1,15 @@
+/* -*- c++ -*-
+ * StringUtil.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef STRINGUTIL_H_
+#define STRINGUTIL_H_
+
+#include <string>
+
+//! Check if a text, e.g. a file name, ends with some other text.
+bool ends_with(const std::string& text, const char* end);
+
+#endif /* STRINGUTIL_H_ */
@@ -0,0 +1,87 @@
+/*
+ * TmpFile.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "TmpFile.h"
+
+#include <iostream>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+TmpFile::TmpFile(const char* p)
+    : prefix( p )
+    , file( 0 )
+{
+}
+
+// ########################################################################
+
+TmpFile::~TmpFile()
+{
+    Abort();
+}
+
+// ########################################################################
+
+bool TmpFile::Open(const std::string& fname)
+{
+    Abort();
+
+    filename = fname;
+    tmpname = filename + ".tmp";
+    file = std::fopen(tmpname.c_str(), "wb");
+    if( !file ) {
+        std::cerr << prefix << ": cannot write '" << tmpname << "'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool TmpFile::Write(const void* data, size_t size)
+{
+    if( !file )
+        return false;
+    if( size > 0 && std::fwrite(data, size, 1, file) != 1 ) {
+        std::cerr << prefix << ": error writing '" << tmpname << "'." << std::endl;
+        Abort();
+        return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool TmpFile::Close()
+{
+    if( !file )
+        return false;
+
+    const bool ok = (std::fclose(file) == 0) && std::rename(tmpname.c_str(), filename.c_str()) == 0;
+    file = 0;
+    if( !ok ) {
+        std::cerr << prefix << ": error writing '" << filename << "'." << std::endl;
+        std::remove(tmpname.c_str());
+    }
+    tmpname.clear();
+    return ok;
+}
+
+// ########################################################################
+
+void TmpFile::Abort()
+{
+    if( file ) {
+        std::fclose(file);
+        file = 0;
+    }
+    if( !tmpname.empty() )
+        std::remove(tmpname.c_str());
+    tmpname.clear();
+}
@@ -0,0 +1,65 @@
+/* -*- c++ -*-
+ * TmpFile.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef TMPFILE_H_
+#define TMPFILE_H_
+
+#include <cstdio>
+#include <string>
+
+//! A file that is written under a temporary name.
+/*! The file gets its final name only when it is closed without
+ *  errors, so that an unfinished file is never taken for a complete
+ *  one. After an error, the temporary file is removed. Errors are
+ *  reported with a prefix, e.g. "events".
+ */
+class TmpFile {
+public:
+    //! Prepare to write.
+    TmpFile(const char* prefix /*!< The prefix for error messages. */);
+
+    //! Removes the file if it was not closed.
+    ~TmpFile();
+
+    //! Create the file under its temporary name.
+    /*! \return false if the file cannot be created
+     */
+    bool Open(const std::string& filename /*!< The final name of the file. */);
+
+    //! Append data to the file.
+    /*! \return false if writing failed; the file is then removed
+     */
+    bool Write(const void* data, /*!< The data to write. */
+               size_t size       /*!< The number of bytes to write. */);
+
+    //! Close the file and give it its final name.
+    /*! \return false if there was an error; the file is then removed
+     */
+    bool Close();
+
+    //! Close and remove an unfinished file.
+    void Abort();
+
+    //! Check if the file is open.
+    bool IsOpen() const
+        { return file != 0; }
+
+    //! Get the final name of the file.
+    const std::string& GetFilename() const
+        { return filename; }
+
+private:
+    //! The prefix for error messages.
+    const char* prefix;
+
+    //! The file being written, or 0.
+    std::FILE* file;
+
+    //! The final and the temporary name of the file.
+    std::string filename, tmpname;
+};
+
+#endif /* TMPFILE_H_ */
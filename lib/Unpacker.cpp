@@ -8,114 +8,438 @@
 #include "Unpacker.h"
 
 #include "Buffer.h"
+#include "DataWord.h"
 #include "Event.h"
+#include "EventBatch.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
 
 #define NDEBUG 1
 #include "debug.h"
 
-inline unsigned int boe(unsigned int x) { return ((x&0xC0000000)>>28); }
-inline unsigned int ndw(unsigned int x) { return  (x&0x000000ff);      }
-inline unsigned int box(unsigned int x) { return ((x&0x3f800000)>>23); }
-inline unsigned int chn(unsigned int x) { return ((x&0x007f0000)>>16); }
-inline unsigned int dta(unsigned int x) { return  (x&0x0000ffff);      }
+// ########################################################################
+
+//! Fills an Event structure in Unpacker::UnpackEvent().
+/*! Values that do not fit into the Event structure are dropped and
+ *  counted.
+ */
+class EventTarget {
+public:
+    EventTarget(Event& e) : event( e ), dropped( 0 )
+        { std::memset(na_idx, NONE, sizeof(na_idx)); }
+
+    bool HasPattern() const
+        { return event.has_pattern; }
+
+    void Pattern(int p)
+        { event.has_pattern = true; event.pattern = p; }
+
+    void Time(long t)
+        { event.has_time = true; event.time = t; }
+
+    void Scaler(int c, long v)
+        {
+            if( event.n_scaler >= Event::MAX_SCALER ) {
+                dropped += 1;
+                return;
+            }
+            Event::chn_scaler& s = event.scaler[event.n_scaler++]; s.chn = c; s.scaler = v;
+        }
+
+    void NaTDC(int c, int tdc)
+        { Event::chn_adc_tdc* na = NA(c); if( na ) na->tdc = tdc; }
+
+    void NaADC(int c, int adc)
+        { Event::chn_adc_tdc* na = NA(c); if( na ) na->adc = adc; }
+
+    void PpacTDC(int c, int tdc)
+        { Event::chn_adc_tdc* pp = PPAC(c); if( pp ) pp->tdc = tdc; }
+
+    void PpacADC(int c, int adc)
+        { Event::chn_adc_tdc* pp = PPAC(c); if( pp ) pp->adc = adc; }
+
+    void E(int c, int adc)
+        {
+            if( event.n_e >= Event::MAX_E ) {
+                dropped += 1;
+                return;
+            }
+            Event::chn_adc& e = event.e[event.n_e++]; e.chn = c; e.adc = adc;
+        }
+
+    void DE(int c, int adc)
+        {
+            if( event.n_de >= Event::MAX_DE ) {
+                dropped += 1;
+                return;
+            }
+            Event::chn_adc& de = event.de[event.n_de++]; de.chn = c; de.adc = adc;
+        }
+
+    //! The number of values that did not fit.
+    int Dropped() const
+        { return dropped; }
+
+private:
+    //! Find or add the CACTUS entry for a channel.
+    /*! \return the entry, or 0 if the list is full
+     */
+    Event::chn_adc_tdc* NA(int c)
+        {
+            int idx = na_idx[c];
+            if( idx == NONE ) {
+                if( event.n_na >= Event::MAX_NA ) {
+                    dropped += 1;
+                    return 0;
+                }
+                idx = na_idx[c] = event.n_na++;
+                event.na[idx].chn = c;
+                event.na[idx].adc = event.na[idx].tdc = 0;
+            }
+            return &event.na[idx];
+        }
+
+    //! Find or add the PPAC entry for a channel.
+    /*! \return the entry, or 0 if the list is full
+     */
+    Event::chn_adc_tdc* PPAC(int c)
+        {
+            int idx = na_idx[c];
+            if( idx == NONE ) {
+                if( event.n_ppac >= Event::MAX_PPAC ) {
+                    dropped += 1;
+                    return 0;
+                }
+                idx = na_idx[c] = event.n_ppac++;
+                event.ppac[idx].chn = c;
+                event.ppac[idx].adc = event.ppac[idx].tdc = 0;
+            }
+            return &event.ppac[idx];
+        }
+
+    //! Marks channels without entry in 'na_idx'.
+    enum { NONE = 0xff };
+
+    //! The event to fill.
+    Event& event;
 
-//#define BYTESWAP_WORDS 1 // for PowerPC
-#ifdef BYTESWAP_WORDS
-inline unsigned int byteswap(unsigned int u)
-{ return ((u&0xff)<<24)|((u&0xff00)>>8)|((u&0xff0000)>>8)|((u&0xff000000)>>24); }
-#else
-inline unsigned int byteswap(unsigned int u)
-{ return u; }
-#endif
+    //! A map of CACTUS ids to indexes in the event's na or ppac list.
+    unsigned char na_idx[128];
 
-static const unsigned int EOB = 0x80000000;
+    //! The number of values that did not fit.
+    int dropped;
+};
 
 // ########################################################################
 
-bool Unpacker::UnpackOneEvent(unsigned int n_data, Event& event)
-{
-    // a map of CACTUS ids to indexes in the event's raw_na list
-    int na_idx[32];
-    for(int i=0; i<32; ++i)
-        na_idx[i] = -1;
+//! Appends events to an EventBatch in Unpacker::UnpackEvent().
+/*! The columns are accessed through plain pointers and the counters
+ *  are kept locally, so that the compiler need not reload them after
+ *  each value.
+ */
+class BatchTarget {
+public:
+    BatchTarget(EventBatch& b)
+        : batch( b ), ev( b.n_events )
+        , n_e( b.n_e ), n_de( b.n_de ), n_na( b.n_na ), n_ppac( b.n_ppac ), n_scaler( b.n_scaler )
+        , e_chn( &b.e_chn[0] ), de_chn( &b.de_chn[0] ), na_chn( &b.na_chn[0] )
+        , ppac_chn( &b.ppac_chn[0] ), scaler_chn( &b.scaler_chn[0] )
+        , e_adc( &b.e_adc[0] ), de_adc( &b.de_adc[0] ), na_adc( &b.na_adc[0] ), na_tdc( &b.na_tdc[0] )
+        , ppac_adc( &b.ppac_adc[0] ), ppac_tdc( &b.ppac_tdc[0] )
+        , scaler( &b.scaler[0] )
+        { for(int c=0; c<128; ++c) na_idx[c] = -1; }
+
+    //! Store the counters in the batch.
+    ~BatchTarget()
+        {
+            batch.n_events = ev;
+            batch.n_e = n_e; batch.n_de = n_de; batch.n_na = n_na; batch.n_ppac = n_ppac;
+            batch.n_scaler = n_scaler;
+        }
+
+    //! Start the next event.
+    void Begin()
+        {
+            has_time = has_pattern = false;
+            time = pattern = 0;
+        }
+
+    bool HasPattern() const
+        { return has_pattern; }
+
+    void Pattern(int p)
+        { has_pattern = true; pattern = p; }
+
+    void Time(long t)
+        { has_time = true; time = t; }
+
+    void Scaler(int c, long v)
+        { scaler_chn[n_scaler] = c; scaler[n_scaler++] = v; }
+
+    void NaTDC(int c, int tdc)
+        { na_tdc[NA(c)] = tdc; }
+
+    void NaADC(int c, int adc)
+        { na_adc[NA(c)] = adc; }
+
+    void PpacTDC(int c, int tdc)
+        { ppac_tdc[PPAC(c)] = tdc; }
+
+    void PpacADC(int c, int adc)
+        { ppac_adc[PPAC(c)] = adc; }
+
+    void E(int c, int adc)
+        { e_chn[n_e] = c; e_adc[n_e++] = adc; }
+
+    void DE(int c, int adc)
+        { de_chn[n_de] = c; de_adc[n_de++] = adc; }
+
+    //! Add the event to the batch.
+    void Commit()
+        {
+            Forget();
+            batch.has_time[ev]    = has_time;
+            batch.time[ev]        = time;
+            batch.has_pattern[ev] = has_pattern;
+            batch.pattern[ev]     = pattern;
+            ev += 1;
+            batch.e_begin[ev]      = n_e;
+            batch.de_begin[ev]     = n_de;
+            batch.na_begin[ev]     = n_na;
+            batch.ppac_begin[ev]   = n_ppac;
+            batch.scaler_begin[ev] = n_scaler;
+        }
+
+    //! The number of values of the event being unpacked that do not fit into an Event structure.
+    /*! They are kept in the batch, but dropped by EventBatch::GetEvent().
+     */
+    int Dropped() const
+        {
+            return Excess(n_e - batch.e_begin[ev], Event::MAX_E)
+                + Excess(n_de - batch.de_begin[ev], Event::MAX_DE)
+                + Excess(n_na - batch.na_begin[ev], Event::MAX_NA)
+                + Excess(n_ppac - batch.ppac_begin[ev], Event::MAX_PPAC)
+                + Excess(n_scaler - batch.scaler_begin[ev], Event::MAX_SCALER);
+        }
+
+    //! Remove the values of a bad event.
+    void Rollback()
+        {
+            Forget();
+            n_e      = batch.e_begin[ev];
+            n_de     = batch.de_begin[ev];
+            n_na     = batch.na_begin[ev];
+            n_ppac   = batch.ppac_begin[ev];
+            n_scaler = batch.scaler_begin[ev];
+        }
+
+private:
+    //! The number of values above a limit.
+    static int Excess(int values, int limit)
+        { return values > limit ? values - limit : 0; }
+
+    //! Clear the entries of the event being unpacked from 'na_idx'.
+    /*! This is faster than clearing all of 'na_idx' for each event.
+     */
+    void Forget()
+        {
+            for(int i=batch.na_begin[ev]; i<n_na; ++i)
+                na_idx[na_chn[i]] = -1;
+            for(int i=batch.ppac_begin[ev]; i<n_ppac; ++i)
+                na_idx[ppac_chn[i]] = -1;
+        }
+
+    //! Find or add the CACTUS entry for a channel.
+    int NA(int c)
+        {
+            int idx = na_idx[c];
+            if( idx<0 ) {
+                idx = na_idx[c] = n_na++;
+                na_chn[idx] = c;
+                na_adc[idx] = na_tdc[idx] = 0;
+            }
+            return idx;
+        }
+
+    //! Find or add the PPAC entry for a channel.
+    int PPAC(int c)
+        {
+            int idx = na_idx[c];
+            if( idx<0 ) {
+                idx = na_idx[c] = n_ppac++;
+                ppac_chn[idx] = c;
+                ppac_adc[idx] = ppac_tdc[idx] = 0;
+            }
+            return idx;
+        }
+
+    //! The batch to append to.
+    EventBatch& batch;
+
+    //! The index of the event being unpacked.
+    int ev;
+
+    //! The counters of the batch.
+    int n_e, n_de, n_na, n_ppac, n_scaler;
+
+    //! The channel columns of the batch.
+    unsigned char *e_chn, *de_chn, *na_chn, *ppac_chn, *scaler_chn;
+
+    //! The value columns of the batch.
+    unsigned short *e_adc, *de_adc, *na_adc, *na_tdc, *ppac_adc, *ppac_tdc;
+
+    //! The scaler column of the batch.
+    unsigned int* scaler;
+
+    //! The flags and values of the event being unpacked.
+    bool has_time, has_pattern;
+    long time;
+    int pattern;
+
+    //! A map of CACTUS ids to indexes in the batch's na or ppac columns, or -1.
+    /*! Only the entries used by an event are cleared after it, see Forget().
+     */
+    int na_idx[128];
+};
+
+// ########################################################################
+
+//! Counts nothing, for unpacking without statistics.
+class NoCounter {
+public:
+    void Word(unsigned int, unsigned int, int) { }
+    void Event(unsigned int, int) { }
+    void Skipped(unsigned int) { }
+    void BadHeader(unsigned int, unsigned int) { }
+    void Dropped(int) { }
+};
+
+// ########################################################################
+
+//! Counts into UnpackerStatistics.
+class StatisticsCounter {
+public:
+    StatisticsCounter(UnpackerStatistics& s)
+        : stats( s ), last_box( 0 )
+        { for(int r=0; r<UnpackerStatistics::ROLES; ++r) mult[r] = 0; }
+
+    //! Count a data word.
+    void Word(unsigned int b, unsigned int c, int role)
+        { stats.hits[b][c] += 1; mult[role] += 1; last_box = b; }
+
+    //! Count the end of an event.
+    void Event(unsigned int n_data, int result)
+        {
+            stats.results[result] += 1;
+            stats.events += 1;
+            stats.lengths[n_data] += 1;
+            if( result != UnpackerStatistics::GOOD )
+                stats.result_box[result][last_box] += 1;
+            for(int r=0; r<UnpackerStatistics::ROLES; ++r) {
+                stats.multiplicity[r][std::min(mult[r], int(UnpackerStatistics::MAX_MULT))] += 1;
+                mult[r] = 0;
+            }
+        }
+
+    //! Count the words skipped after a rejected event.
+    void Skipped(unsigned int words)
+        { stats.skipped_words += words; }
 
+    //! Count a word that should be an event header, and the rest of the buffer.
+    void BadHeader(unsigned int b, unsigned int words)
+        {
+            const int r = UnpackerStatistics::BAD_HEADER;
+            stats.results[r] += 1;
+            stats.result_box[r][b] += 1;
+            stats.skipped_words += words;
+        }
+
+    //! Count values that did not fit into the Event structure.
+    void Dropped(int values)
+        { stats.dropped_values += values; }
+
+private:
+    UnpackerStatistics& stats;
+    unsigned int last_box;
+    int mult[UnpackerStatistics::ROLES];
+};
+
+// ########################################################################
+
+template<class Target, class Counter>
+int Unpacker::UnpackEvent(unsigned int n_data, Target& event, Counter& counter)
+{
     // go through all data of this event
     for( unsigned int i=1; i<=n_data; i++ ) {
-        const unsigned int l_word = byteswap((*buffer)[buffer_idx + i]);
-        const int nbox = box(l_word); // the box that has fired
+        const unsigned int l_word = (*buffer)[buffer_idx + i];
+        const BoxEntry& box_entry = boxes[box(l_word)]; // the box that has fired
+        counter.Word(box(l_word), chn(l_word), box_entry.role);
 
         if( boe(l_word) != 0 )
             // somehow a header word came into the event, maybe engine has overwritten the buffer?
-            return false;
+            return UnpackerStatistics::HEADER_IN_EVENT;
 
-        if(nbox == 0x00) {        /* TPU pattern ch 0 - 3 */
-            if( chn(l_word) == 0 && !event.has_pattern ) {
-                event.has_pattern = true;
-                event.pattern = dta(l_word);
+        switch( box_entry.role ) {
+        case BOX_PATTERN:
+            if( chn(l_word) == 0 && !event.HasPattern() ) {
+                event.Pattern(dta(l_word));
+                break;
             } else {
-                return ERROR;
+                return UnpackerStatistics::BAD_PATTERN;
             }
-        } else if(nbox == 0x01) { /* Wall-clock time  ch 16 (high) and 17 (low) */
+        case BOX_TIME: { /* high word ch 16, low word ch 17 */
             if( chn(l_word) != 16 || i>=n_data )
-                return ERROR;
+                return UnpackerStatistics::BAD_TIME;
             const unsigned int l_word2 = (*buffer)[buffer_idx + i + 1];
             if( chn(l_word2) != 17 )
-                return ERROR;
-            event.has_time = true;
-            event.time = ((long)dta(l_word))<<16 | dta(l_word2);
-        } else if( nbox == 0x02) { /* VME scaler 1151N ch 0-15 (lo) and 16-31 (hi) */
+                return UnpackerStatistics::BAD_TIME;
+            event.Time(((long)dta(l_word))<<16 | dta(l_word2));
+            // the low word is not skipped: it is seen again and ends the
+            // event as BAD_TIME, as it always has; skipping it would change
+            // the sorted results
+            break; }
+        case BOX_SCALER: { /* ch 0-15 (lo) and 16-31 (hi) */
             if( i>=n_data )
-                return ERROR;
+                return UnpackerStatistics::BAD_SCALER;
             const unsigned int l_word2 = (*buffer)[buffer_idx + i + 1];
             if( chn(l_word2) - chn(l_word) != 16 )
-                return ERROR;
-
-            Event::chn_scaler& s = event.scaler[event.n_scaler++];
-            s.chn    = chn(l_word);
-            s.scaler = ((long)dta(l_word2))<<16 | dta(l_word);
-        } else if( nbox == 0x10) { /* Time of NaI ch 0-31*/
+                return UnpackerStatistics::BAD_SCALER;
+            event.Scaler(chn(l_word), ((long)dta(l_word2))<<16 | dta(l_word));
+            // like for the time, the high word is not skipped
+            break; }
+        case BOX_NA_TDC: {
             const int c = chn(l_word);
-            int idx = na_idx[c];
-            if( idx<0 ) {
-                idx = na_idx[c] = event.n_na++;
-                event.na[idx].chn = c;
-                event.na[idx].adc = 0;
-            }
-            event.na[idx].tdc = dta(l_word);
-        } else if( nbox == 0x20       /* Energy of NaI ch 0-31 */
-                   || nbox == 0x24) { /* Energy   MADC ch 0-31 */
+            if( ppac_channel[c] )
+                event.PpacTDC(c, dta(l_word));
+            else
+                event.NaTDC(c, dta(l_word));
+            break; }
+        case BOX_NA_ADC: {
             const int c = chn(l_word);
-            int idx = na_idx[c];
-            if( idx<0 ) {
-                idx = na_idx[c] = event.n_na++;
-                event.na[idx].chn = c;
-                event.na[idx].tdc = 0;
-            }
-            event.na[idx].adc = dta(l_word);
-        } else if( nbox == 0x21) { /* Energy E ch 0-32 */
-            Event::chn_adc& e = event.e[event.n_e++];
-            e.chn = chn(l_word);
-            e.adc = dta(l_word);
-        } else if( nbox == 0x22) { /* Energy dE1 ch 0-31 */
-            Event::chn_adc& de1 = event.de[event.n_de++];
-            de1.chn = chn(l_word);
-            de1.adc = dta(l_word);
-        } else if( nbox == 0x23) { /* Energy dE2 ch 32-61 */
-            Event::chn_adc& de2 = event.de[event.n_de++];
-            de2.chn = chn(l_word) + 32;
-            de2.adc = dta(l_word);
-/////////  Preliminary FIX, BEGIN, Magne 29 oct 2014  //////////////////
-        } else if( nbox == 0x11) { /* Time of Ge ch 0-31*/
-            return true;
-        } else if( nbox == 0x25) { /* Energy of Ge ch 0-31 */
-            return true;
-/////////  Preliminary FIX, END, Magne 29 oct 2014  //////////////////
-/* Addition because of sorting Problems if there is an additional event type - otherwise the event(s) gets thrown away*/
-        } else {
-            return false;
+            if( ppac_channel[c] )
+                event.PpacADC(c, dta(l_word));
+            else
+                event.NaADC(c, dta(l_word));
+            break; }
+        case BOX_E:
+            event.E(chn(l_word) + box_entry.offset, dta(l_word));
+            break;
+        case BOX_DE:
+            event.DE(chn(l_word) + box_entry.offset, dta(l_word));
+            break;
+        case BOX_IGNORE:
+            break;
+        case BOX_STOP:
+            return UnpackerStatistics::STOP_BOX;
+        default:
+            return UnpackerStatistics::BAD_BOX;
         }
     }
-    return true;
+    return UnpackerStatistics::GOOD;
 }
 
 // ########################################################################
@@ -123,17 +447,130 @@ bool Unpacker::UnpackOneEvent(unsigned int n_data, Event& event)
 Unpacker::Unpacker()
     : buffer( 0 )
     , buffer_idx( 0 )
+    , buffer_end( 0 )
     , eventlength_sum( 0 )
     , event_count( 0 )
+    , with_statistics( false )
+{
+    SetDefaultBoxes();
+}
+
+// ########################################################################
+
+void Unpacker::SetDefaultBoxes()
+{
+    for(int b=0; b<128; ++b)
+        SetBox(b, BOX_BAD);
+    for(int c=0; c<128; ++c)
+        ppac_channel[c] = false;
+
+    SetBox(0x00, BOX_PATTERN);    // TPU pattern ch 0 - 3
+    SetBox(0x01, BOX_TIME);       // Wall-clock time  ch 16 (high) and 17 (low)
+    SetBox(0x02, BOX_SCALER);     // VME scaler 1151N ch 0-15 (lo) and 16-31 (hi)
+    SetBox(0x10, BOX_NA_TDC);     // Time of NaI ch 0-31
+    SetBox(0x20, BOX_NA_ADC);     // Energy of NaI ch 0-31
+    SetBox(0x24, BOX_NA_ADC);     // Energy   MADC ch 0-31
+    SetBox(0x21, BOX_E);          // Energy E ch 0-32
+    SetBox(0x22, BOX_DE);         // Energy dE1 ch 0-31
+    SetBox(0x23, BOX_DE, 32);     // Energy dE2 ch 32-61
+
+    // Preliminary FIX, Magne 29 oct 2014: skip the rest of events with Ge
+    SetBox(0x11, BOX_STOP);       // Time of Ge ch 0-31
+    SetBox(0x25, BOX_STOP);       // Energy of Ge ch 0-31
+}
+
+// ########################################################################
+
+void Unpacker::SetBox(unsigned int b, BoxRole role, int offset)
+{
+    boxes[b].role = role;
+    boxes[b].offset = offset;
+}
+
+// ########################################################################
+
+void Unpacker::SetPPAC(int channel, bool ppac)
 {
+    ppac_channel[channel] = ppac;
+}
+
+// ########################################################################
+
+bool Unpacker::Command(std::istream& icmd)
+{
+    std::string what;
+    icmd >> what;
+    if( what == "default" ) {
+        SetDefaultBoxes();
+        return true;
+    } else if( what == "box" ) {
+        static const char* names[] = { "bad", "ignore", "stop", "pattern", "time", "scaler",
+                                       "nai_t", "nai_e", "e", "de", 0 };
+        std::string id, role;
+        icmd >> id >> role;
+        char* end = 0;
+        const long b = std::strtol(id.c_str(), &end, 0);
+        int r = 0;
+        while( names[r] && role != names[r] )
+            r += 1;
+        int offset = 0;
+        if( !(icmd >> offset) )
+            offset = 0;
+        // CACTUS and PPAC channels are not shifted, they share the same ids
+        const bool shift = (r == BOX_E || r == BOX_DE);
+        if( id.empty() || *end || b<0 || b>=128 || !names[r] || offset<0 || offset>=64
+            || (offset && !shift) )
+        {
+            std::cerr << "unpacker: Expected unpacker box <id> "
+                      << "bad|ignore|stop|pattern|time|scaler|nai_t|nai_e|e|de [<offset>]" << std::endl;
+            return false;
+        }
+        SetBox(b, BoxRole(r), offset);
+        return true;
+    } else if( what == "statistics" ) {
+        std::string onoff;
+        icmd >> onoff;
+        if( onoff != "on" && onoff != "off" ) {
+            std::cerr << "unpacker: Expected unpacker statistics on|off" << std::endl;
+            return false;
+        }
+        EnableStatistics(onoff == "on");
+        return true;
+    } else if( what == "ppac" ) {
+        for(int c=0; c<128; ++c)
+            ppac_channel[c] = false;
+        std::string ch;
+        while( icmd >> ch ) {
+            if( ch == "none" )
+                continue;
+            char* end = 0;
+            const long c = std::strtol(ch.c_str(), &end, 0);
+            if( *end || c<0 || c>=32 ) {
+                std::cerr << "unpacker: Expected unpacker ppac <channel 0..31>... | none" << std::endl;
+                return false;
+            }
+            SetPPAC(c, true);
+        }
+        return true;
+    }
+    std::cerr << "unpacker: Expected unpacker box|ppac|statistics|default" << std::endl;
+    return false;
 }
 
 // ########################################################################
 
 void Unpacker::SetBuffer(const Buffer* buffr)
+{
+    SetBuffer(buffr, 0, buffr->GetSize());
+}
+
+// ########################################################################
+
+void Unpacker::SetBuffer(const Buffer* buffr, unsigned int begin, unsigned int end)
 {
     buffer = buffr;
-    buffer_idx = 0;
+    buffer_idx = begin;
+    buffer_end = end;
     
     event_count = eventlength_sum = 0;
 }
@@ -141,34 +578,118 @@ void Unpacker::SetBuffer(const Buffer* buffr)
 // ########################################################################
 
 Unpacker::Status Unpacker::Next(Event& event)
+{
+    if( with_statistics ) {
+        StatisticsCounter counter(statistics);
+        return NextEvent(event, counter);
+    } else {
+        NoCounter counter;
+        return NextEvent(event, counter);
+    }
+}
+
+// ########################################################################
+
+template<class Counter>
+Unpacker::Status Unpacker::NextEvent(Event& event, Counter& counter)
 {
     DBGV(buffer);
-    if( buffer_idx >= buffer->GetSize() )
+    if( buffer_idx >= buffer_end )
         return END;
 
     event.Reset();
 
-    const unsigned int event_header = byteswap((*buffer)[buffer_idx]);
+    const unsigned int event_header = (*buffer)[buffer_idx];
     if( boe(event_header) != 0xC ) {
         // not begin of event; then it should be the end of the buffer
-        if( event_header != EOB )
+        if( event_header != EOB ) {
             // ouch, bad buffer
+            counter.BadHeader(box(event_header), buffer_end - buffer_idx);
             return ERROR;
+        }
 
         // okay, the end-of-buffer marker was there
         return END;
     }
 
     const int n_data = ndw(event_header);
+    if( buffer_idx + n_data >= buffer_end ) {
+        // the event would end after the buffer
+        counter.BadHeader(box(event_header), buffer_end - buffer_idx);
+        return ERROR;
+    }
 
     eventlength_sum += n_data;
     event_count += 1;
 
-    if( !UnpackOneEvent(n_data, event) )
+    EventTarget target(event);
+    const int result = UnpackEvent(n_data, target, counter);
+    counter.Event(n_data, result);
+    counter.Dropped(target.Dropped());
+    if( result >= UnpackerStatistics::FIRST_ERROR ) {
         // unpacking error
+        counter.Skipped(buffer_end - buffer_idx);
         return ERROR;
+    }
 
     buffer_idx += n_data + 1;
 
     return OKAY;
 }
+
+// ########################################################################
+
+Unpacker::Status Unpacker::NextBatch(EventBatch& batch)
+{
+    if( with_statistics ) {
+        StatisticsCounter counter(statistics);
+        return UnpackBatch(batch, counter);
+    } else {
+        NoCounter counter;
+        return UnpackBatch(batch, counter);
+    }
+}
+
+// ########################################################################
+
+template<class Counter>
+Unpacker::Status Unpacker::UnpackBatch(EventBatch& batch, Counter& counter)
+{
+    batch.Reset(buffer->GetSize());
+
+    BatchTarget target(batch);
+    while( buffer_idx < buffer_end ) {
+        const unsigned int event_header = (*buffer)[buffer_idx];
+        if( boe(event_header) != 0xC ) {
+            // not begin of event; then it should be the end of the buffer
+            if( event_header == EOB )
+                return END;
+            counter.BadHeader(box(event_header), buffer_end - buffer_idx);
+            return ERROR;
+        }
+
+        const int n_data = ndw(event_header);
+        if( buffer_idx + n_data >= buffer_end ) {
+            // the event would end after the buffer
+            counter.BadHeader(box(event_header), buffer_end - buffer_idx);
+            return ERROR;
+        }
+
+        eventlength_sum += n_data;
+        event_count += 1;
+
+        target.Begin();
+        const int result = UnpackEvent(n_data, target, counter);
+        counter.Event(n_data, result);
+        counter.Dropped(target.Dropped());
+        if( result >= UnpackerStatistics::FIRST_ERROR ) {
+            target.Rollback();
+            counter.Skipped(buffer_end - buffer_idx);
+            return ERROR;
+        }
+        target.Commit();
+
+        buffer_idx += n_data + 1;
+    }
+    return END;
+}
@@ -8,10 +8,20 @@
 #ifndef UNPACKER_H_
 #define UNPACKER_H_
 
+#include "UnpackerStatistics.h"
+
+#include <iosfwd>
+
 class Buffer;
 struct Event;
+struct EventBatch;
 
 //! Unpacks data from a Buffer into an Event.
+/*! Which detectors are read out by which box is looked up in a table
+ *  with one entry per box id. The defaults match the usual SiRi and
+ *  CACTUS setup; other setups are configured with 'unpacker' commands
+ *  in the batch file, see Command().
+ */
 class Unpacker {
 public:
     typedef enum { OKAY, //!< Event unpacked without problems.
@@ -19,33 +29,138 @@ public:
         ERROR            //!< Error while unpacking event.
     } Status;
 
-    //! Initialize the unpacker.
+    //! What the data words from a box contain.
+    typedef enum {
+        BOX_BAD,     //!< Not expected, the event is bad.
+        BOX_IGNORE,  //!< Nothing of interest, the word is skipped.
+        BOX_STOP,    //!< Nothing of interest, the rest of the event is skipped.
+        BOX_PATTERN, //!< The TPU pattern.
+        BOX_TIME,    //!< The wall clock time, high and low word.
+        BOX_SCALER,  //!< Scaler values, low and high word.
+        BOX_NA_TDC,  //!< CACTUS TDC values, PPAC TDC values for PPAC channels.
+        BOX_NA_ADC,  //!< CACTUS ADC values, PPAC ADC values for PPAC channels.
+        BOX_E,       //!< SiRi back detector ADC values.
+        BOX_DE       //!< SiRi front detector ADC values.
+    } BoxRole;
+
+    //! Initialize the unpacker with the default box table.
     Unpacker();
 
+    //! Set the default box table and no PPAC channels.
+    void SetDefaultBoxes();
+
+    //! Set what the data words from a box contain.
+    void SetBox(unsigned int box,  /*!< The box id, 0..127. */
+                BoxRole role,      /*!< What the box contains. */
+                int offset = 0     /*!< Added to the channel ids, for SiRi boxes only. */);
+
+    //! Mark a CACTUS channel as PPAC channel.
+    /*! Values from this channel go into the PPAC list of the event
+     *  instead of the CACTUS list.
+     */
+    void SetPPAC(int channel, /*!< The CACTUS channel id. */
+                 bool ppac    /*!< True for a PPAC channel. */);
+
+    //! Check if a CACTUS channel is marked as PPAC channel.
+    bool IsPPAC(int channel /*!< The CACTUS channel id. */) const
+        { return ppac_channel[channel]; }
+
+    //! Process an 'unpacker' command from the batch file.
+    /*! The commands are
+     *  <pre>
+     *  unpacker box &lt;id&gt; bad|ignore|stop|pattern|time|scaler|nai_t|nai_e|e|de [&lt;offset&gt;]
+     *  unpacker ppac &lt;channel&gt;... | none
+     *  unpacker statistics on|off
+     *  unpacker default
+     *  </pre>
+     *
+     *  \return true if the command was understood
+     */
+    bool Command(std::istream& icmd /*!< The command, after 'unpacker'. */);
+
     //! Set the buffer from which the events shall be extracted.
     /*! This also resets all counters.
      */
     void SetBuffer(const Buffer* buffer /*!< The buffer to extract from. */);
 
+    //! Set the part of a buffer from which the events shall be extracted.
+    /*! This also resets all counters.
+     */
+    void SetBuffer(const Buffer* buffer, /*!< The buffer to extract from. */
+                   unsigned int begin,   /*!< The position of the first event header. */
+                   unsigned int end      /*!< The end of the last event, see BufferScan::Prescan(). */);
+
     //! Unpack the next event.
     /*! \return the status after unpacking
      */
     Status Next(Event& event /*!< The event structure to unpack into. */);
 
+    //! Unpack all remaining events of the buffer.
+    /*! \return END if the end of the buffer was reached, or ERROR if
+     *  an event could not be unpacked; the batch then contains the
+     *  events before the bad one
+     */
+    Status NextBatch(EventBatch& batch /*!< The batch to unpack into, emptied first. */);
+
+    //! Get the current reading position in the buffer.
+    /*! After Next() returned OKAY, this is the position after the
+     *  last data word of the event.
+     */
+    unsigned int GetPosition() const
+        { return buffer_idx; }
+
     //! Retrieve the average event length seen so far.
     /*! \return The average event length.
      */
     float GetAverageLength() const
         { return event_count>0 ? eventlength_sum/float(event_count) : 0; }
 
+    //! Switch counting statistics on or off.
+    /*! Without statistics, the unpacking loops contain no counting
+     *  code at all. The counters are kept when switching off.
+     */
+    void EnableStatistics(bool on /*!< True to count. */)
+        { with_statistics = on; }
+
+    //! Check if statistics are counted.
+    bool HasStatistics() const
+        { return with_statistics; }
+
+    //! Get the statistics counted since they were last reset.
+    UnpackerStatistics& GetStatistics()
+        { return statistics; }
+
 private:
+    //! Unpack the next event, counting with 'counter'.
+    template<class Counter>
+    Status NextEvent(Event& event, Counter& counter);
+
+    //! Unpack all remaining events, counting with 'counter'.
+    template<class Counter>
+    Status UnpackBatch(EventBatch& batch, Counter& counter);
 
-    //! Actual implementation of the unpacking.
-    /*! This method needs to be changed if the box ids change or the
-     *  buffer format changes or the Event structure changes.
+    //! Unpack the data words of one event.
+    /*! \return the result, see UnpackerStatistics::Result
      */
-    bool UnpackOneEvent(unsigned int n_data /*!< The size of this event. */,
-                        Event& event /*!< The event structure to fill. */);
+    template<class Target, class Counter>
+    int UnpackEvent(unsigned int n_data /*!< The size of this event. */,
+                    Target& target      /*!< Where to store the values. */,
+                    Counter& counter    /*!< Where to count the words. */);
+
+    //! An entry in the box table.
+    struct BoxEntry {
+        //! What the box contains, a BoxRole.
+        unsigned char role;
+
+        //! Added to the channel ids of SiRi boxes.
+        unsigned char offset;
+    };
+
+    //! The box table, indexed by box id.
+    BoxEntry boxes[128];
+
+    //! Flags for the CACTUS channels used by PPACs.
+    bool ppac_channel[128];
 
     //! The buffer to read from.
     const Buffer* buffer;
@@ -53,11 +168,20 @@ private:
     //! The current reading position in the buffer.
     unsigned int buffer_idx;
 
+    //! The end of the part of the buffer to read.
+    unsigned int buffer_end;
+
     //! Sum of event lengths so far.
     int eventlength_sum;
 
     //! Number of events so far.
     int event_count;
+
+    //! True to count statistics.
+    bool with_statistics;
+
+    //! The statistics.
+    UnpackerStatistics statistics;
 };
 
 #endif /* UNPACKER_H_ */
@@ -0,0 +1,206 @@
+/*
+ * UnpackerStatistics.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "UnpackerStatistics.h"
+
+#include "Histogram1D.h"
+#include "Histogram2D.h"
+#include "Histograms.h"
+#include "IOPrintf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The number of channels listed in the report.
+static const unsigned int BUSIEST = 8;
+
+// ########################################################################
+
+void UnpackerStatistics::Reset()
+{
+    events = skipped_words = dropped_values = 0;
+    std::memset(hits,         0, sizeof(hits));
+    std::memset(results,      0, sizeof(results));
+    std::memset(result_box,   0, sizeof(result_box));
+    std::memset(lengths,      0, sizeof(lengths));
+    std::memset(multiplicity, 0, sizeof(multiplicity));
+}
+
+// ########################################################################
+
+//! Add an array of counters to another one.
+static void add_counters(long long* to, const long long* from, unsigned int n)
+{
+    for(unsigned int i=0; i<n; ++i)
+        to[i] += from[i];
+}
+
+// ########################################################################
+
+void UnpackerStatistics::Add(const UnpackerStatistics& other)
+{
+    events         += other.events;
+    skipped_words  += other.skipped_words;
+    dropped_values += other.dropped_values;
+    add_counters(&hits[0][0],         &other.hits[0][0],         sizeof(hits)/sizeof(long long));
+    add_counters(results,             other.results,             RESULTS);
+    add_counters(&result_box[0][0],   &other.result_box[0][0],   sizeof(result_box)/sizeof(long long));
+    add_counters(lengths,             other.lengths,             256);
+    add_counters(&multiplicity[0][0], &other.multiplicity[0][0], sizeof(multiplicity)/sizeof(long long));
+}
+
+// ########################################################################
+
+const char* UnpackerStatistics::Describe(int r)
+{
+    static const char* names[RESULTS] = {
+        "good", "cut at stop box", "cut at bad pattern", "cut at bad time", "cut at bad scaler",
+        "rejected, header in event", "rejected, bad box", "rejected, bad header"
+    };
+    return (r>=0 && r<RESULTS) ? names[r] : "?";
+}
+
+// ########################################################################
+
+const char* UnpackerStatistics::RoleName(int r)
+{
+    // the same as in Unpacker::Command()
+    static const char* names[ROLES] = { "bad", "ignore", "stop", "pattern", "time", "scaler",
+                                        "nai_t", "nai_e", "e", "de" };
+    return (r>=0 && r<ROLES) ? names[r] : "?";
+}
+
+// ########################################################################
+
+//! A channel and its number of words, for sorting by the number of words.
+struct busy_channel {
+    long long words;
+    int box, chn;
+    bool operator<(const busy_channel& other) const
+        { return words > other.words; }
+};
+
+// ########################################################################
+
+void UnpackerStatistics::Report(std::ostream& out) const
+{
+    long long words = 0;
+    for(int l=0; l<256; ++l)
+        words += l*lengths[l];
+    out << "unpacker statistics: " << events << " events, "
+        << ioprintf("%.2f", events>0 ? words/double(events) : 0.0) << " data words per event" << std::endl;
+
+    for(int r=0; r<RESULTS; ++r) {
+        if( results[r] == 0 )
+            continue;
+        out << ioprintf("  %-26s %12lld", Describe(r), results[r]);
+        if( events > 0 )
+            out << ioprintf(" (%5.1f%%)", 100.0*results[r]/events);
+        if( r != GOOD ) {
+            out << " at box";
+            for(int b=0; b<128; ++b) {
+                if( result_box[r][b] )
+                    out << ioprintf(" 0x%02x: %lld", b, result_box[r][b]);
+            }
+        }
+        out << std::endl;
+    }
+    if( skipped_words )
+        out << "  words not unpacked because of rejected events: " << skipped_words << std::endl;
+    if( dropped_values )
+        out << "  values not fitting into the Event structure: " << dropped_values << std::endl;
+
+    std::vector<busy_channel> busy;
+    for(int b=0; b<128; ++b) {
+        for(int c=0; c<128; ++c) {
+            if( hits[b][c] ) {
+                busy_channel bc;
+                bc.words = hits[b][c];
+                bc.box = b;
+                bc.chn = c;
+                busy.push_back(bc);
+            }
+        }
+    }
+    const unsigned int n_busy = std::min<unsigned int>(busy.size(), BUSIEST);
+    std::partial_sort(busy.begin(), busy.begin()+n_busy, busy.end());
+    if( n_busy > 0 ) {
+        out << "  busiest channels:";
+        for(unsigned int i=0; i<n_busy; ++i)
+            out << ioprintf(" 0x%02x/%d: %lld", busy[i].box, busy[i].chn, busy[i].words);
+        out << std::endl;
+    }
+
+    if( events > 0 ) {
+        out << "  words per event by box role (mean/max):";
+        for(int r=0; r<ROLES; ++r) {
+            long long sum = 0;
+            int max = 0;
+            for(int m=0; m<=MAX_MULT; ++m) {
+                sum += m*multiplicity[r][m];
+                if( multiplicity[r][m] )
+                    max = m;
+            }
+            if( max == 0 )
+                continue;
+            out << ' ' << RoleName(r) << ioprintf(" %.2f/", sum/double(events));
+            if( max == MAX_MULT )
+                out << '>';
+            out << max;
+        }
+        out << std::endl;
+    }
+}
+
+// ########################################################################
+
+void UnpackerStatistics::Fill(Histograms& histograms) const
+{
+    Histogram2Dp h_hits = histograms.Find2D("unpacker_hits");
+    if( !h_hits )
+        h_hits = histograms.Create2D("unpacker_hits", "data words by box and channel",
+                                     128, 0, 128, "box", 128, 0, 128, "channel");
+    Histogram2Dp h_results = histograms.Find2D("unpacker_results");
+    if( !h_results )
+        h_results = histograms.Create2D("unpacker_results", "events by result and box where unpacking stopped",
+                                        RESULTS, 0, RESULTS, "result", 128, 0, 128, "box");
+    Histogram1Dp h_length = histograms.Find1D("unpacker_length");
+    if( !h_length )
+        h_length = histograms.Create1D("unpacker_length", "data words per event",
+                                       256, 0, 256, "data words");
+    Histogram2Dp h_mult = histograms.Find2D("unpacker_mult");
+    if( !h_mult )
+        h_mult = histograms.Create2D("unpacker_mult", "words per event by box role",
+                                     ROLES, 0, ROLES, "box role", MAX_MULT+1, 0, MAX_MULT+1, "words");
+
+    for(int b=0; b<128; ++b) {
+        for(int c=0; c<128; ++c) {
+            if( hits[b][c] )
+                h_hits->Fill(b, c, hits[b][c]);
+        }
+    }
+    for(int r=0; r<RESULTS; ++r) {
+        for(int b=0; b<128; ++b) {
+            if( result_box[r][b] )
+                h_results->Fill(r, b, result_box[r][b]);
+        }
+    }
+    for(int l=0; l<256; ++l) {
+        if( lengths[l] )
+            h_length->Fill(l, lengths[l]);
+    }
+    for(int r=0; r<ROLES; ++r) {
+        for(int m=0; m<=MAX_MULT; ++m) {
+            if( multiplicity[r][m] )
+                h_mult->Fill(r, m, multiplicity[r][m]);
+        }
+    }
+}
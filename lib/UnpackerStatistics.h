@@ -0,0 +1,108 @@
+/* -*- c++ -*-
+ * UnpackerStatistics.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef UNPACKERSTATISTICS_H_
+#define UNPACKERSTATISTICS_H_
+
+#include <iosfwd>
+
+class Histograms;
+
+//! Counters collected by the Unpacker, if enabled with 'unpacker statistics on'.
+/*! For each box and channel, the number of data words is counted. For
+ *  each event, the result of unpacking it is counted, together with
+ *  the box of the word where unpacking stopped, the event length and
+ *  the number of words for each box role (the multiplicity).
+ *
+ *  Some problems do not reject the event, but only cut it short:
+ *  the values before the problem are sorted, the rest is skipped.
+ */
+struct UnpackerStatistics {
+    //! The result of unpacking an event.
+    typedef enum {
+        GOOD,            //!< All words of the event were unpacked.
+        STOP_BOX,        //!< Cut short at a box with role 'stop' (e.g. the Ge boxes).
+        BAD_PATTERN,     //!< Cut short at a second pattern word or a pattern word with channel != 0.
+        BAD_TIME,        //!< Cut short at a time word without proper high/low pair.
+        BAD_SCALER,      //!< Cut short at a scaler word without proper low/high pair.
+        HEADER_IN_EVENT, //!< Rejected, a data word has boe != 0.
+        BAD_BOX,         //!< Rejected, a word from a box with role 'bad'.
+        BAD_HEADER,      //!< Rejected with the rest of the buffer, neither event header nor end-of-buffer, or event too long.
+        RESULTS          //!< The number of results.
+    } Result;
+
+    //! The first result that rejects an event.
+    enum { FIRST_ERROR = HEADER_IN_EVENT };
+
+    //! The number of box roles, see Unpacker::BoxRole.
+    enum { ROLES = 10 };
+
+    //! The largest multiplicity counted separately.
+    enum { MAX_MULT = 63 };
+
+    //! Start with all counters at 0.
+    UnpackerStatistics()
+        { Reset(); }
+
+    //! Set all counters to 0.
+    void Reset();
+
+    //! Add the counters from another unpacker, e.g. from another thread.
+    void Add(const UnpackerStatistics& other /*!< The counters to add. */);
+
+    //! Check if anything has been counted.
+    bool IsEmpty() const
+        { return events == 0 && results[BAD_HEADER] == 0; }
+
+    //! Print a summary.
+    /*! Lists the results, the boxes where events were cut short or
+     *  rejected, the busiest channels and the mean multiplicities.
+     */
+    void Report(std::ostream& out /*!< Where to print. */) const;
+
+    //! Add the counters to histograms.
+    /*! The histograms are created if they do not exist yet:
+     *  unpacker_hits (box vs. channel), unpacker_results (result vs.
+     *  box), unpacker_length (event length) and unpacker_mult
+     *  (multiplicity vs. box role).
+     */
+    void Fill(Histograms& histograms /*!< The set of histograms to add to. */) const;
+
+    //! Get the name of a result.
+    static const char* Describe(int result);
+
+    //! Get the name of a box role, as used in 'unpacker box'.
+    static const char* RoleName(int role);
+
+    //! The number of events with a header.
+    long long events;
+
+    //! The number of data words for each box and channel.
+    long long hits[128][128];
+
+    //! The number of events with each result.
+    long long results[RESULTS];
+
+    //! The number of events with each result, by box of the word where unpacking stopped.
+    long long result_box[RESULTS][128];
+
+    //! The number of words left in the buffer (or part) at rejected events, including the rejected event.
+    long long skipped_words;
+
+    //! The number of values that do not fit into the Event structure.
+    /*! They are dropped when unpacking into an Event, or when copying
+     *  from an EventBatch into an Event.
+     */
+    long long dropped_values;
+
+    //! The number of events with each number of data words.
+    long long lengths[256];
+
+    //! The number of events by number of words for each box role; the last bin counts all larger ones.
+    long long multiplicity[ROLES][MAX_MULT+1];
+};
+
+#endif /* UNPACKERSTATISTICS_H_ */
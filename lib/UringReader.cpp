@@ -0,0 +1,336 @@
+/*
+ * UringReader.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#include "UringReader.h"
+
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MISSING_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The size of the chunks read from the file.
+static const unsigned int CHUNK = 1024*1024;
+
+//! The alignment of offsets for O_DIRECT.
+static const unsigned int ALIGN = BufferPool::ALIGN;
+
+int UringReader::queue_depth = 0;
+bool UringReader::use_direct = false;
+
+// ########################################################################
+
+UringReader::UringReader()
+    : fd( -1 )
+    , file_size( 0 )
+    , next_offset( 0 )
+    , head( 0 )
+    , head_pos( 0 )
+    , inflight( 0 )
+    , ring_fd( -1 )
+{
+    std::memset(&ring, 0, sizeof(ring));
+}
+
+// ########################################################################
+
+UringReader::~UringReader()
+{
+    Close();
+}
+
+// ########################################################################
+
+bool UringReader::Open(const std::string& filename, off_t want)
+{
+    Close();
+
+    fd = open(filename.c_str(), O_RDONLY | (use_direct ? O_DIRECT : 0));
+    if( fd<0 && use_direct ) {
+        // some file systems do not support O_DIRECT
+        std::cerr << "uring: cannot use O_DIRECT for '" << filename << "'." << std::endl;
+        fd = open(filename.c_str(), O_RDONLY);
+    }
+    struct stat st;
+    if( fd<0 || fstat(fd, &st) != 0 || want > st.st_size ) {
+        Close();
+        return false;
+    }
+    file_size = st.st_size;
+    if( !use_direct )
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    const int depth = std::max(1, queue_depth);
+    slots.resize(depth);
+    for(int i=0; i<depth; ++i) {
+        // the pool memory is aligned as needed for O_DIRECT
+        slots[i].data = (char*)BufferPool::Allocate(CHUNK/4);
+        slots[i].state = Slot::FREE;
+    }
+
+    // O_DIRECT needs aligned offsets; skip the beginning of the first chunk
+    next_offset = want - want%ALIGN;
+    head = 0;
+    head_pos = want - next_offset;
+
+    if( !SetupRing(depth) )
+        CloseRing();
+    return Submit();
+}
+
+// ########################################################################
+
+void UringReader::Close()
+{
+    // the kernel may still write into the slots
+    while( inflight > 0 && ring_fd >= 0 ) {
+        if( Reap() == 0 ) {
+#ifndef MISSING_IO_URING
+            syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+#endif
+        }
+    }
+    inflight = 0;
+    CloseRing();
+
+    for(unsigned int i=0; i<slots.size(); ++i)
+        BufferPool::Release((unsigned int*)slots[i].data, CHUNK/4);
+    slots.clear();
+
+    if( fd >= 0 ) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+// ########################################################################
+
+void UringReader::CloseRing()
+{
+    if( ring_fd >= 0 ) {
+        if( ring.sqes )
+            munmap(ring.sqes, ring.sqes_size);
+        if( ring.cq_ptr && ring.cq_ptr != ring.sq_ptr )
+            munmap(ring.cq_ptr, ring.cq_size);
+        if( ring.sq_ptr )
+            munmap(ring.sq_ptr, ring.sq_size);
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    std::memset(&ring, 0, sizeof(ring));
+}
+
+// ########################################################################
+
+bool UringReader::SetupRing(unsigned int entries)
+{
+#ifndef MISSING_IO_URING
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+    if( ring_fd < 0 ) {
+        static bool warned = false;
+        if( !warned ) {
+            std::cerr << "uring: io_uring not available (" << std::strerror(errno)
+                      << "), using pread." << std::endl;
+            warned = true;
+        }
+        return false;
+    }
+
+    ring.sq_size = p.sq_off.array + p.sq_entries*sizeof(unsigned int);
+    ring.cq_size = p.cq_off.cqes + p.cq_entries*sizeof(io_uring_cqe);
+    const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if( single )
+        ring.sq_size = ring.cq_size = std::max(ring.sq_size, ring.cq_size);
+
+    ring.sq_ptr = mmap(0, ring.sq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                       ring_fd, IORING_OFF_SQ_RING);
+    if( ring.sq_ptr == MAP_FAILED ) {
+        ring.sq_ptr = 0;
+        return false;
+    }
+    if( single ) {
+        ring.cq_ptr = ring.sq_ptr;
+    } else {
+        ring.cq_ptr = mmap(0, ring.cq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                           ring_fd, IORING_OFF_CQ_RING);
+        if( ring.cq_ptr == MAP_FAILED ) {
+            ring.cq_ptr = 0;
+            return false;
+        }
+    }
+    ring.sqes_size = p.sq_entries*sizeof(io_uring_sqe);
+    ring.sqes = mmap(0, ring.sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                     ring_fd, IORING_OFF_SQES);
+    if( ring.sqes == MAP_FAILED ) {
+        ring.sqes = 0;
+        return false;
+    }
+
+    char* sq = (char*)ring.sq_ptr;
+    ring.sq_head  = (unsigned int*)(sq + p.sq_off.head);
+    ring.sq_tail  = (unsigned int*)(sq + p.sq_off.tail);
+    ring.sq_mask  = (unsigned int*)(sq + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned int*)(sq + p.sq_off.array);
+    char* cq = (char*)ring.cq_ptr;
+    ring.cq_head  = (unsigned int*)(cq + p.cq_off.head);
+    ring.cq_tail  = (unsigned int*)(cq + p.cq_off.tail);
+    ring.cq_mask  = (unsigned int*)(cq + p.cq_off.ring_mask);
+    ring.cqes     = cq + p.cq_off.cqes;
+    return true;
+#else
+    (void)entries;
+    return false;
+#endif
+}
+
+// ########################################################################
+
+bool UringReader::Submit()
+{
+    // the slots are used in order, starting after the last one submitted
+    const unsigned int n = slots.size();
+#ifndef MISSING_IO_URING
+    int to_submit = 0;
+#endif
+    for(unsigned int i=0; i<n; ++i) {
+        Slot& s = slots[(head+i)%n];
+        if( s.state != Slot::FREE )
+            continue;
+        if( next_offset >= file_size )
+            break;
+
+        s.offset = next_offset;
+        next_offset += CHUNK;
+        if( ring_fd < 0 ) {
+            // no io_uring, read synchronously
+            const ssize_t r = pread(fd, s.data, CHUNK, s.offset);
+            s.result = r<0 ? -errno : r;
+            s.state = Slot::DONE;
+            // only read ahead one chunk
+            break;
+        }
+#ifndef MISSING_IO_URING
+        const unsigned int tail = *ring.sq_tail;
+        const unsigned int idx = tail & *ring.sq_mask;
+        io_uring_sqe* sqe = ((io_uring_sqe*)ring.sqes) + idx;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = fd;
+        sqe->addr      = (unsigned long)s.data;
+        sqe->len       = CHUNK;
+        sqe->off       = s.offset;
+        sqe->user_data = (head+i)%n;
+        ring.sq_array[idx] = idx;
+        __atomic_store_n(ring.sq_tail, tail+1, __ATOMIC_RELEASE);
+        s.state = Slot::INFLIGHT;
+        to_submit += 1;
+#endif
+    }
+
+#ifndef MISSING_IO_URING
+    while( to_submit > 0 ) {
+        const int r = syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, 0, 0);
+        if( r < 0 ) {
+            if( errno == EINTR || errno == EAGAIN )
+                continue;
+            return false;
+        }
+        inflight += r;
+        to_submit -= r;
+    }
+#endif
+    return true;
+}
+
+// ########################################################################
+
+int UringReader::Reap()
+{
+    int count = 0;
+#ifndef MISSING_IO_URING
+    unsigned int h = *ring.cq_head;
+    const unsigned int tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    while( h != tail ) {
+        const io_uring_cqe* cqe = ((io_uring_cqe*)ring.cqes) + (h & *ring.cq_mask);
+        Slot& s = slots[cqe->user_data];
+        s.result = cqe->res;
+        s.state  = Slot::DONE;
+        h += 1;
+        count += 1;
+    }
+    __atomic_store_n(ring.cq_head, h, __ATOMIC_RELEASE);
+    inflight -= count;
+#endif
+    return count;
+}
+
+// ########################################################################
+
+bool UringReader::WaitHead()
+{
+    Slot& s = slots[head];
+    if( s.state == Slot::FREE && !Submit() )
+        return false;
+    while( s.state == Slot::INFLIGHT ) {
+        if( Reap() > 0 )
+            continue;
+#ifndef MISSING_IO_URING
+        const int r = syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+        if( r < 0 && errno != EINTR )
+            return false;
+#endif
+    }
+    return true;
+}
+
+// ########################################################################
+
+int UringReader::Read(char* data, unsigned int size)
+{
+    if( fd < 0 )
+        return -1;
+    if( slots[head].state == Slot::FREE && next_offset >= file_size )
+        return 0;
+    if( !WaitHead() )
+        return -1;
+
+    Slot& s = slots[head];
+    if( s.result < 0 ) {
+        std::cerr << "uring: read error: " << std::strerror(-s.result) << std::endl;
+        return -1;
+    }
+    const int expect = std::min(off_t(CHUNK), file_size - s.offset);
+    if( s.result < expect )
+        // the file has been truncated while reading
+        return -1;
+
+    const int n = std::min(int(size), s.result - head_pos);
+    std::memcpy(data, s.data + head_pos, n);
+    head_pos += n;
+    if( head_pos >= s.result ) {
+        s.state = Slot::FREE;
+        head = (head+1) % slots.size();
+        head_pos = 0;
+        if( !Submit() )
+            return -1;
+    }
+    return n;
+}
@@ -0,0 +1,140 @@
+/* -*- c++ -*-
+ * UringReader.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef URINGREADER_H_
+#define URINGREADER_H_
+
+#include "FileReaderBackend.h"
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+//! Read uncompressed files with many asynchronous reads in flight.
+/*! The file is read in chunks of 1MB into aligned memory. Up to
+ *  'depth' chunks are requested at the same time using io_uring, so
+ *  that fast disks are kept busy while the data of earlier chunks are
+ *  being sorted. Optionally, the file is opened with O_DIRECT, which
+ *  bypasses the page cache; this avoids evicting other data from the
+ *  cache when reading a large file only once.
+ *
+ *  If io_uring is not available (old kernel, or compiled with
+ *  MISSING_IO_URING), the chunks are read with pread(), which still
+ *  allows O_DIRECT.
+ */
+class UringReader : public FileReaderBackend {
+public:
+    UringReader();
+
+    //! Waits for outstanding reads and closes the file.
+    ~UringReader();
+
+    //! Open a file and start reading at the specified position.
+    /*! \return true if opening was successful.
+     */
+    bool Open(const std::string& filename, /*!< The name of the file to open. */
+              off_t want                   /*!< At which byte to position for reading. */);
+
+    int Read(char* data, unsigned int size);
+
+    //! Configure the reader for files opened later.
+    /*! If depth is 0, FileReader does not use this class.
+     */
+    static void Configure(int depth,  /*!< The number of chunks to read in parallel. */
+                          bool direct /*!< True to use O_DIRECT. */)
+        { queue_depth = depth; use_direct = direct; }
+
+    //! Get the configured queue depth.
+    static int GetDepth()
+        { return queue_depth; }
+
+private:
+    //! A chunk of the file.
+    struct Slot {
+        //! The aligned memory for the data, from the BufferPool.
+        char* data;
+
+        //! The position of the chunk in the file.
+        off_t offset;
+
+        //! The number of bytes read, or -errno.
+        int result;
+
+        //! The state of the slot.
+        enum { FREE, INFLIGHT, DONE } state;
+    };
+
+    //! Wait for outstanding reads and close everything.
+    void Close();
+
+    //! Request reads for all free slots.
+    /*! \return false in case of error
+     */
+    bool Submit();
+
+    //! Wait until the oldest slot has been read.
+    /*! \return false in case of error
+     */
+    bool WaitHead();
+
+    //! Unmap the io_uring memory and close it.
+    void CloseRing();
+
+    //! Set up the io_uring.
+    /*! \return false if io_uring is not available
+     */
+    bool SetupRing(unsigned int entries);
+
+    //! Collect completed reads.
+    /*! \return the number of completions collected
+     */
+    int Reap();
+
+    //! The file descriptor of the data file.
+    int fd;
+
+    //! The size of the file.
+    off_t file_size;
+
+    //! The position of the next chunk to request.
+    off_t next_offset;
+
+    //! The slots, used round-robin.
+    std::vector<Slot> slots;
+
+    //! The slot to be read next.
+    unsigned int head;
+
+    //! The read position in the head slot.
+    int head_pos;
+
+    //! The number of reads submitted but not yet completed.
+    int inflight;
+
+    //! The io_uring file descriptor, or -1 if pread() is used.
+    int ring_fd;
+
+    //! Pointers into the io_uring memory.
+    struct Ring {
+        void* sq_ptr;
+        size_t sq_size;
+        void* cq_ptr;
+        size_t cq_size;
+        void* sqes;
+        size_t sqes_size;
+        unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+        unsigned int *cq_head, *cq_tail, *cq_mask;
+        void* cqes;
+    } ring;
+
+    //! The number of chunks to read in parallel.
+    static int queue_depth;
+
+    //! True to open files with O_DIRECT.
+    static bool use_direct;
+};
+
+#endif /* URINGREADER_H_ */
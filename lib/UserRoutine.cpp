@@ -1,10 +1,31 @@
 
 #include "UserRoutine.h"
 
+#include "Event.h"
+#include "EventBatch.h"
+
 bool UserRoutine::Start() { return true; }
 
 bool UserRoutine::Command(const std::string&) { return true; }
 
 bool UserRoutine::Sort(const Event&) { return true; }
 
+bool UserRoutine::SortBatch(const EventBatch& batch)
+{
+    batch_default = true;
+
+    Event event;
+    for(int i=0; i<batch.n_events; ++i) {
+        batch.GetEvent(i, event);
+        Sort(event);
+    }
+    return true;
+}
+
+bool UserRoutine::SetupUnpacker(Unpacker&) { return true; }
+
 bool UserRoutine::End() { return true; }
+
+UserRoutine* UserRoutine::New() { return 0; }
+
+void UserRoutine::StartTime(long) { }
@@ -12,10 +12,16 @@
 #include <string>
 
 struct Event;
+struct EventBatch;
+class Unpacker;
 
 //! Interface for sorting routines.
 class UserRoutine {
 public:
+    //! Initialize.
+    UserRoutine()
+        : batch_default( false ), selected( false ) { }
+
     //! Virtual no-op destructor.
     virtual ~UserRoutine() { }
 
@@ -28,21 +34,85 @@ public:
     //! Called to sort an event.
     virtual bool Sort(const Event& event /*!< The event structure filled with data. */) = 0;
 
+    //! Called to sort all events from a buffer.
+    /*! The default implementation calls Sort() for each event. As
+     *  it is faster to unpack each event directly for Sort(), the
+     *  default implementation is only called once; later buffers are
+     *  sorted by calling Sort(). Routines may override this to work on
+     *  whole columns of values, see EventBatch.
+     */
+    virtual bool SortBatch(const EventBatch& batch /*!< The events filled with data. */);
+
+    //! Check if SortBatch() is implemented by the routine.
+    /*! \return false if the default SortBatch() has been called
+     */
+    bool SortsBatches() const
+        { return !batch_default; }
+
+    //! Called before each 'data' command, to set up the unpacker from the routine's parameters.
+    /*! For example, a routine may mark the channels it expects in
+     *  the PPAC list with Unpacker::SetPPAC(). Copies of the routine
+     *  get the unpacker set up by this object. The default does
+     *  nothing.
+     *
+     *  \return false if the parameters do not fit the unpacker
+     */
+    virtual bool SetupUnpacker(Unpacker& unpacker /*!< The unpacker used for the next command. */);
+
     //! Called after all sorting is finished.
     virtual bool End();
 
+    //! Create a new object of the same class, for sorting in parallel.
+    /*! The new object gets Start() and the same commands as this
+     *  one; its histograms are added to this object's histograms after
+     *  sorting, but End() is not called for it.
+     *
+     *  \return the new object, or 0 if the routine cannot sort in parallel
+     */
+    virtual UserRoutine* New();
+
+    //! Called with the time of the first event before sorting with copies from New().
+    /*! Routines that count the time from the first event they see
+     *  should count from this time instead, and so should their copies,
+     *  as a copy does not see the first event. For 'data glob', this is
+     *  called before the copies are made, for 'data split' before the
+     *  first event with a time is sorted. It is not called if the
+     *  events have no time. The default does nothing.
+     */
+    virtual void StartTime(long time /*!< The wall clock time of the first sorted event. */);
+
     Parameters& GetParameters()
         { return parameters; }
 
     Histograms& GetHistograms()
         { return histograms; }
 
+    //! Check if the last sorted event was marked with Select(), and clear the mark.
+    bool TakeSelected()
+        { const bool s = selected; selected = false; return s; }
+
+protected:
+    //! Mark the event being sorted for the skim file.
+    /*! Sort() may call this for events passing the gate of the
+     *  routine; with 'data skim', these events are written to a
+     *  reduced data file. While a skim file is written, all events are
+     *  sorted with Sort().
+     */
+    void Select()
+        { selected = true; }
+
 private:
     //! The list of parameters.
     Parameters parameters;
 
     //! The list of histograms.
     Histograms histograms;
+
+    //! True after the default SortBatch() has been called.
+    bool batch_default;
+
+    //! True if Select() was called for the last sorted event.
+    bool selected;
 };
 
 #endif /* USERROUTINE_H_ */
@@ -0,0 +1,256 @@
+/*
+ * ZstdReader.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef MISSING_ZSTD
+
+#include "ZstdReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#define NDEBUG 1
+#include "debug.h"
+
+const unsigned int ZstdReader::SKIPPABLE_MAGIC;
+const unsigned int ZstdReader::SEEKABLE_MAGIC;
+const unsigned int ZstdReader::FOOTER_SIZE;
+const unsigned int ZstdReader::MAX_FRAMES;
+
+// ########################################################################
+
+//! Read a little-endian 32 bit number, as used in the seek table.
+static unsigned int get32(const unsigned char* p)
+{
+    return p[0] | (p[1]<<8) | (p[2]<<16) | ((unsigned int)p[3]<<24);
+}
+
+// ########################################################################
+// ########################################################################
+
+ZstdReader::ZstdReader()
+    : file( 0 )
+    , next_frame( 0 )
+    , dctx( 0 )
+    , dstream( 0 )
+    , output_size( 0 )
+    , output_pos( 0 )
+    , stream_eof( false )
+    , stream_in_frame( false )
+{
+    std::memset(&stream_in, 0, sizeof(stream_in));
+}
+
+// ########################################################################
+
+ZstdReader::~ZstdReader()
+{
+    Close();
+}
+
+// ########################################################################
+
+void ZstdReader::Close()
+{
+    if( file ) {
+        std::fclose(file);
+        file = 0;
+    }
+    if( dctx ) {
+        ZSTD_freeDCtx(dctx);
+        dctx = 0;
+    }
+    if( dstream ) {
+        ZSTD_freeDStream(dstream);
+        dstream = 0;
+    }
+    frames.clear();
+    next_frame = output_size = output_pos = 0;
+    stream_eof = stream_in_frame = false;
+}
+
+// ########################################################################
+
+bool ZstdReader::Open(const std::string& filename, off_t want)
+{
+    Close();
+    file = std::fopen(filename.c_str(), "rb");
+    if( !file )
+        return false;
+
+    if( ReadSeekTable() ) {
+        dctx = ZSTD_createDCtx();
+        if( !dctx )
+            return false;
+
+        // find the frame containing 'want'
+        const off_t total = frames.empty() ? 0 : frames.back().out + frames.back().dsize;
+        if( want > total )
+            return false;
+        int lo = 0, hi = frames.size();
+        while( hi-lo > 1 ) {
+            const int mid = (lo+hi)/2;
+            if( frames[mid].out <= want )
+                lo = mid;
+            else
+                hi = mid;
+        }
+        next_frame = lo;
+        if( want == total ) {
+            next_frame = frames.size();
+            return true;
+        }
+        if( !LoadFrame(next_frame++) )
+            return false;
+        output_pos = want - frames[lo].out;
+        return true;
+    }
+
+    // no seek table, decompress from the beginning
+    if( fseeko(file, 0, SEEK_SET) != 0 )
+        return false;
+    dstream = ZSTD_createDStream();
+    if( !dstream || ZSTD_isError(ZSTD_initDStream(dstream)) )
+        return false;
+    input.resize(ZSTD_DStreamInSize());
+    output.resize(ZSTD_DStreamOutSize());
+    stream_in.src  = &input[0];
+    stream_in.size = stream_in.pos = 0;
+    while( want > 0 ) {
+        const int n = StreamMore();
+        if( n <= 0 )
+            return false;
+        const off_t skip = std::min(want, off_t(n));
+        output_pos = skip;
+        want -= skip;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool ZstdReader::ReadSeekTable()
+{
+    unsigned char footer[FOOTER_SIZE];
+    if( fseeko(file, -off_t(FOOTER_SIZE), SEEK_END) != 0
+        || std::fread(footer, 1, FOOTER_SIZE, file) != FOOTER_SIZE
+        || get32(footer+5) != SEEKABLE_MAGIC )
+        return false;
+
+    const unsigned int nframes = get32(footer);
+    const bool checksums = (footer[4] & 0x80) != 0;
+    if( (footer[4] & 0x7c) != 0 || nframes > MAX_FRAMES ) {
+        // reserved bits must be zero
+        return false;
+    }
+    const unsigned int entry = checksums ? 12 : 8;
+    const off_t table_size = off_t(nframes)*entry + FOOTER_SIZE;
+
+    // the skippable frame header comes before the table
+    std::vector<unsigned char> table(table_size + 8);
+    if( fseeko(file, -off_t(table.size()), SEEK_END) != 0
+        || std::fread(&table[0], 1, table.size(), file) != table.size()
+        || get32(&table[0]) != SKIPPABLE_MAGIC
+        || get32(&table[4]) != table_size )
+        return false;
+    const off_t table_start = ftello(file) - off_t(table.size());
+
+    frames.resize(nframes);
+    off_t in = 0, out = 0;
+    for(unsigned int i=0; i<nframes; ++i) {
+        Frame& f = frames[i];
+        f.in    = in;
+        f.out   = out;
+        f.csize = get32(&table[8 + i*entry]);
+        f.dsize = get32(&table[8 + i*entry + 4]);
+        in  += f.csize;
+        out += f.dsize;
+    }
+    if( in != table_start ) {
+        std::cerr << "zstd: seek table does not match the frames." << std::endl;
+        frames.clear();
+        return false;
+    }
+    return true;
+}
+
+// ########################################################################
+
+bool ZstdReader::LoadFrame(unsigned int idx)
+{
+    const Frame& f = frames[idx];
+    input.resize(std::max<size_t>(input.size(), f.csize));
+    output.resize(std::max<size_t>(output.size(), f.dsize));
+    if( fseeko(file, f.in, SEEK_SET) != 0
+        || std::fread(&input[0], 1, f.csize, file) != f.csize )
+        return false;
+
+    const size_t n = ZSTD_decompressDCtx(dctx, &output[0], f.dsize, &input[0], f.csize);
+    if( ZSTD_isError(n) || n != f.dsize ) {
+        std::cerr << "zstd: error decompressing frame " << idx << ": "
+                  << (ZSTD_isError(n) ? ZSTD_getErrorName(n) : "wrong size") << std::endl;
+        return false;
+    }
+    output_size = f.dsize;
+    output_pos = 0;
+    return true;
+}
+
+// ########################################################################
+
+int ZstdReader::StreamMore()
+{
+    output_pos = output_size = 0;
+    while( output_size == 0 ) {
+        if( stream_in.pos == stream_in.size ) {
+            if( stream_eof )
+                // error if the file ends inside a frame
+                return stream_in_frame ? -1 : 0;
+            stream_in.size = std::fread(&input[0], 1, input.size(), file);
+            stream_in.pos = 0;
+            if( stream_in.size < input.size() ) {
+                if( std::ferror(file) )
+                    return -1;
+                stream_eof = true;
+            }
+        }
+        ZSTD_outBuffer out = { &output[0], output.size(), 0 };
+        const size_t r = ZSTD_decompressStream(dstream, &out, &stream_in);
+        if( ZSTD_isError(r) ) {
+            std::cerr << "zstd: " << ZSTD_getErrorName(r) << std::endl;
+            return -1;
+        }
+        output_size = out.pos;
+        stream_in_frame = (r != 0);
+    }
+    return output_size;
+}
+
+// ########################################################################
+
+int ZstdReader::Read(char* data, unsigned int size)
+{
+    if( !file )
+        return -1;
+    while( output_pos == output_size ) {
+        if( dstream ) {
+            const int n = StreamMore();
+            if( n <= 0 )
+                return n;
+        } else {
+            if( next_frame >= frames.size() )
+                return 0;
+            if( !LoadFrame(next_frame++) )
+                return -1;
+        }
+    }
+    const unsigned int n = std::min(size, output_size - output_pos);
+    std::memcpy(data, &output[output_pos], n);
+    output_pos += n;
+    return n;
+}
+
+#endif /* MISSING_ZSTD */
@@ -0,0 +1,132 @@
+/* -*- c++ -*-
+ * ZstdReader.h
+ *
+ *  Created on: 17.10.2026
+ */
+
+#ifndef ZSTDREADER_H_
+#define ZSTDREADER_H_
+
+#ifndef MISSING_ZSTD
+
+#include "FileReaderBackend.h"
+
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include <zstd.h>
+
+//! Read Zstandard compressed files, seeking with the seek table if present.
+/*! Files in the Zstandard seekable format consist of independent
+ *  zstd frames followed by a skippable frame with a seek table that
+ *  lists the compressed and decompressed size of each frame. Seeking
+ *  decompresses only the frame containing the wanted position.
+ *
+ *  Files without seek table (plain <code>.zst</code> files) are
+ *  decompressed as a stream; seeking then has to decompress all data
+ *  before the wanted position.
+ *
+ *  The sirius2zst tool converts data files into the seekable format.
+ */
+class ZstdReader : public FileReaderBackend {
+public:
+    ZstdReader();
+
+    //! Closes the file.
+    ~ZstdReader();
+
+    //! Open a file and go to the specified position.
+    /*! \return true if both opening and seeking were successful.
+     */
+    bool Open(const std::string& filename, /*!< The name of the file to open. */
+              off_t want                   /*!< At which byte to position for reading. */);
+
+    int Read(char* data, unsigned int size);
+
+    //! The magic number of the skippable frame with the seek table.
+    static const unsigned int SKIPPABLE_MAGIC = 0x184D2A5E;
+
+    //! The magic number at the end of the seek table.
+    static const unsigned int SEEKABLE_MAGIC = 0x8F92EAB1;
+
+    //! The size of the seek table footer.
+    static const unsigned int FOOTER_SIZE = 9;
+
+    //! The maximum number of frames in a seek table.
+    static const unsigned int MAX_FRAMES = 0x8000000;
+
+private:
+    //! A frame from the seek table.
+    struct Frame {
+        //! The position of the frame in the file.
+        off_t in;
+
+        //! The position of the frame's data in the decompressed stream.
+        off_t out;
+
+        //! The compressed size.
+        unsigned int csize;
+
+        //! The decompressed size.
+        unsigned int dsize;
+    };
+
+    //! Close the file.
+    void Close();
+
+    //! Read the seek table, if there is one.
+    /*! \return false if there is no valid seek table
+     */
+    bool ReadSeekTable();
+
+    //! Decompress a frame from the seek table into 'output'.
+    /*! \return false in case of error
+     */
+    bool LoadFrame(unsigned int idx /*!< The index of the frame. */);
+
+    //! Decompress more data from a file without seek table into 'output'.
+    /*! \return the number of bytes decompressed, 0 at the end, -1 for error
+     */
+    int StreamMore();
+
+    //! The file.
+    std::FILE* file;
+
+    //! The frames from the seek table, empty for a stream.
+    std::vector<Frame> frames;
+
+    //! The next frame to decompress.
+    unsigned int next_frame;
+
+    //! The decompression context for frames.
+    ZSTD_DCtx* dctx;
+
+    //! The decompression context for a stream.
+    ZSTD_DStream* dstream;
+
+    //! Compressed data read from the file.
+    std::vector<char> input;
+
+    //! Decompressed data.
+    std::vector<char> output;
+
+    //! The amount of data in 'output'.
+    unsigned int output_size;
+
+    //! The read position in 'output'.
+    unsigned int output_pos;
+
+    //! For streams: the compressed data in 'input'.
+    ZSTD_inBuffer stream_in;
+
+    //! For streams: true when the end of the file has been read.
+    bool stream_eof;
+
+    //! For streams: true if the last frame has not been decompressed completely.
+    bool stream_in_frame;
+};
+
+#endif /* MISSING_ZSTD */
+
+#endif /* ZSTDREADER_H_ */
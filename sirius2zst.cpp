@@ -0,0 +1,166 @@
+/*
+ * sirius2zst.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+// Convert data files (uncompressed or .gz) into the Zstandard
+// seekable format, which can be read by the sorting with fast
+// seeking for 'data buffers' commands.
+
+#include "Buffer.h"
+#include "FileReader.h"
+#include "StringUtil.h"
+#include "ZstdReader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zstd.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+//! Append a little-endian 32 bit number, as used in the seek table.
+static void put32(std::vector<unsigned char>& v, unsigned int x)
+{
+    for(int i=0; i<4; ++i)
+        v.push_back((x >> (8*i)) & 0xff);
+}
+
+// ########################################################################
+
+static void usage(const char* prog)
+{
+    std::cerr << "usage: " << prog << " [-l <level>] [-f <buffers per frame>] <input> [<output>]\n"
+              << "  converts a data file (uncompressed or .gz) into a seekable .zst file;\n"
+              << "  the default output name is the input name with .gz replaced by .zst\n"
+              << "  -l  zstd compression level (default 3)\n"
+              << "  -f  buffers per zstd frame (default 8); seeking decompresses one frame"
+              << std::endl;
+}
+
+// ########################################################################
+
+int main(int argc, char* argv[])
+{
+    int level = 3, per_frame = 8, a = 1;
+    for(; a<argc && argv[a][0] == '-'; a += 2) {
+        if( a+1 >= argc ) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if( std::strcmp(argv[a], "-l") == 0 )
+            level = std::atoi(argv[a+1]);
+        else if( std::strcmp(argv[a], "-f") == 0 )
+            per_frame = std::atoi(argv[a+1]);
+        else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if( a >= argc || argc > a+2 || per_frame <= 0 ) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string input = argv[a];
+    std::string output;
+    if( a+1 < argc ) {
+        output = argv[a+1];
+    } else {
+        output = input;
+        if( ends_with(output, ".gz") )
+            output.resize(output.size()-3);
+        output += ".zst";
+    }
+    const std::string tmpname = output + ".tmp";
+
+    FileReader reader;
+    if( !reader.Open(input, 0) ) {
+        std::cerr << "cannot open '" << input << "'." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::FILE* out = std::fopen(tmpname.c_str(), "wb");
+    if( !out ) {
+        std::cerr << "cannot write '" << tmpname << "'." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+
+    const unsigned int bufbytes = SiriusBuffer::BUFSIZE*4;
+    std::vector<char> frame(per_frame*bufbytes);
+    std::vector<char> z(ZSTD_compressBound(frame.size()));
+    std::vector<unsigned char> table;
+    unsigned int nframes = 0, nbuffers = 0;
+    long long total_in = 0, total_out = 0;
+    bool ok = true, eof = false;
+    while( ok && !eof ) {
+        // collect the buffers for one frame
+        int have = 0;
+        while( have < per_frame ) {
+            const int r = reader.Read(&frame[have*bufbytes], bufbytes);
+            if( r < 0 ) {
+                std::cerr << "error reading buffer " << nbuffers << " from '" << input << "'." << std::endl;
+                ok = false;
+            }
+            if( r <= 0 ) {
+                eof = true;
+                break;
+            }
+            have += 1;
+            nbuffers += 1;
+        }
+        if( !ok || have == 0 )
+            break;
+
+        const size_t n = ZSTD_compress2(cctx, &z[0], z.size(), &frame[0], have*bufbytes);
+        if( ZSTD_isError(n) ) {
+            std::cerr << "zstd: " << ZSTD_getErrorName(n) << std::endl;
+            ok = false;
+            break;
+        }
+        if( std::fwrite(&z[0], 1, n, out) != n ) {
+            std::cerr << "error writing '" << tmpname << "'." << std::endl;
+            ok = false;
+            break;
+        }
+        put32(table, n);
+        put32(table, have*bufbytes);
+        nframes += 1;
+        total_in  += have*bufbytes;
+        total_out += n;
+    }
+    ZSTD_freeCCtx(cctx);
+
+    if( ok ) {
+        // the seek table as a skippable frame
+        std::vector<unsigned char> head;
+        put32(head, ZstdReader::SKIPPABLE_MAGIC);
+        put32(head, table.size() + ZstdReader::FOOTER_SIZE);
+        put32(table, nframes);
+        table.push_back(0); // no checksums in the table, the frames have them
+        put32(table, ZstdReader::SEEKABLE_MAGIC);
+        ok = std::fwrite(&head[0], 1, head.size(), out) == head.size()
+            && std::fwrite(&table[0], 1, table.size(), out) == table.size();
+    }
+    ok = (std::fclose(out) == 0) && ok;
+    if( !ok || std::rename(tmpname.c_str(), output.c_str()) != 0 ) {
+        std::cerr << "conversion of '" << input << "' failed." << std::endl;
+        std::remove(tmpname.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::cout << input << " -> " << output << ": " << nbuffers << " buffers in "
+              << nframes << " frames, ratio "
+              << (total_out>0 ? double(total_in)/total_out : 0.0) << std::endl;
+    return EXIT_SUCCESS;
+}
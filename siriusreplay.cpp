@@ -0,0 +1,105 @@
+/*
+ * siriusreplay.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+// Send the buffers of a data file over a socket, standing in for the
+// acquisition when testing online sorting with 'data online'.
+
+#include "Buffer.h"
+#include "FileReader.h"
+#include "SocketBufferFetcher.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define NDEBUG 1
+#include "debug.h"
+
+// ########################################################################
+
+//! Send all data, retrying after partial writes.
+/*! \return false if the connection was closed
+ */
+static bool send_all(int fd, const char* data, unsigned int size)
+{
+    while( size > 0 ) {
+        const ssize_t n = send(fd, data, size, 0);
+        if( n < 0 && errno == EINTR )
+            continue;
+        if( n <= 0 )
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// ########################################################################
+
+int main(int argc, char* argv[])
+{
+    if( argc < 3 || argc > 4 ) {
+        std::cerr << "usage: " << argv[0] << " <address> <datafile> [<buffers per second>]\n"
+                  << "  waits for the sorting to connect to <address> (unix:<path> or\n"
+                  << "  tcp:[<host>]:<port>) and sends the buffers from <datafile>;\n"
+                  << "  without rate, the buffers are sent as fast as possible"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string address = argv[1], filename = argv[2];
+    const double rate = (argc > 3) ? std::atof(argv[3]) : 0;
+    signal(SIGPIPE, SIG_IGN);
+
+    const int ls = SocketBufferFetcher::OpenSocket(address, true);
+    if( ls < 0 )
+        return EXIT_FAILURE;
+    std::cout << "waiting for connection on '" << address << "'" << std::endl;
+    const int fd = accept(ls, 0, 0);
+    close(ls);
+    if( fd < 0 ) {
+        std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    FileReader reader;
+    if( !reader.Open(filename, 0) ) {
+        std::cerr << "cannot open '" << filename << "'." << std::endl;
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    SiriusBuffer buffer;
+    const unsigned int bytes = buffer.GetSize()*4;
+    timeval start;
+    gettimeofday(&start, 0);
+    int count = 0;
+    while( reader.Read((char*)buffer.GetBuffer(), bytes) > 0 ) {
+        if( !send_all(fd, (const char*)buffer.GetBuffer(), bytes) ) {
+            std::cerr << "connection closed by the sorting." << std::endl;
+            break;
+        }
+        count += 1;
+
+        if( rate > 0 ) {
+            // sleep until this buffer is due
+            timeval now;
+            gettimeofday(&now, 0);
+            const double elapsed = (now.tv_sec - start.tv_sec) + 1e-6*(now.tv_usec - start.tv_usec);
+            const double due = count/rate;
+            if( due > elapsed )
+                usleep((useconds_t)(1e6*(due - elapsed)));
+        }
+    }
+    close(fd);
+    std::cout << "sent " << count << " buffers." << std::endl;
+    return reader.IsError() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+/*
+ * sortbench.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+// Measure how fast the buffer fetchers read data files, without
+// unpacking or sorting: buffers/s and MB/s of uncompressed data, with
+// the file in the page cache ("hot") or dropped from it before each
+// run ("cold").
+
+#include "Buffer.h"
+#include "MMapFileBufferFetcher.h"
+#include "MTFileBufferFetcher.h"
+#include "ParallelGzReader.h"
+#include "STFileBufferFetcher.h"
+#include "UringReader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The queue depth for the 'uring' fetcher.
+static const int URING_DEPTH = 16;
+
+// ########################################################################
+
+static double now()
+{
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+// ########################################################################
+
+//! Remove a file from the page cache.
+/*! This works without special rights, but only for pages that are not
+ *  dirty or mapped by another process.
+ */
+static bool drop_cache(const std::string& filename)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if( fd < 0 )
+        return false;
+    const bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+}
+
+// ########################################################################
+
+//! Create a fetcher by name.
+/*! \return the fetcher, or 0 for an unknown name
+ */
+static FileBufferFetcher* new_fetcher(const std::string& name)
+{
+    UringReader::Configure(name == "uring" ? URING_DEPTH : 0, false);
+    if( name == "st" )
+        return new STFileBufferFetcher();
+    else if( name == "mt" || name == "uring" )
+        return new MTFileBufferFetcher();
+    else if( name == "mmap" )
+        return new MMapFileBufferFetcher();
+    return 0;
+}
+
+// ########################################################################
+
+//! The result of one pass over a file.
+struct Pass {
+    //! The number of buffers read.
+    unsigned int buffers;
+
+    //! The time needed, in seconds.
+    double seconds;
+
+    //! The sum of all data words, to make sure that all data are touched.
+    unsigned int checksum;
+
+    //! True if there was no read error.
+    bool ok;
+};
+
+// ########################################################################
+
+//! Read all buffers of a file once.
+static Pass read_file(const std::string& fetcher_name, const std::string& filename)
+{
+    Pass p;
+    p.buffers = p.checksum = 0;
+    p.ok = false;
+
+    const double start = now();
+    FileBufferFetcher* fetcher = new_fetcher(fetcher_name);
+    if( fetcher->Open(filename, 0) == BufferFetcher::OKAY ) {
+        while( true ) {
+            BufferFetcher::Status state;
+            const Buffer* buffer = fetcher->Next(state);
+            if( state != BufferFetcher::OKAY ) {
+                p.ok = (state == BufferFetcher::END);
+                break;
+            }
+            unsigned int sum = 0;
+            for(unsigned int i=0; i<buffer->GetSize(); ++i)
+                sum += buffer->GetData(i);
+            p.checksum += sum;
+            p.buffers += 1;
+        }
+    }
+    delete fetcher;
+    p.seconds = now() - start;
+    return p;
+}
+
+// ########################################################################
+
+int main(int argc, char* argv[])
+{
+    std::string fetchers = "st,mt,mmap,uring", modes = "hot,cold";
+    int repeat = 3;
+    int a = 1;
+    for(; a+1<argc && argv[a][0] == '-'; a += 2) {
+        if( std::strcmp(argv[a], "-f") == 0 ) {
+            fetchers = argv[a+1];
+        } else if( std::strcmp(argv[a], "-c") == 0 ) {
+            modes = argv[a+1];
+        } else if( std::strcmp(argv[a], "-r") == 0 ) {
+            repeat = std::max(1, std::atoi(argv[a+1]));
+        } else if( std::strcmp(argv[a], "-z") == 0 ) {
+            ParallelGzReader::SetThreads(std::atoi(argv[a+1]));
+        } else {
+            a = argc;
+            break;
+        }
+    }
+    if( a >= argc ) {
+        std::cerr << "usage: " << argv[0] << " [-f <fetchers>] [-c <cache>] [-r <repeat>] [-z <gzthreads>] <datafile>...\n"
+                  << "  reads the data files with each buffer fetcher, without sorting;\n"
+                  << "  -f  comma-separated list of st, mt, mmap, uring (default: all)\n"
+                  << "  -c  hot, cold or hot,cold (default); 'cold' drops the file from\n"
+                  << "      the page cache before each pass\n"
+                  << "  -r  number of passes per measurement, the median is shown (default 3)\n"
+                  << "  -z  threads for parallel gzip decompression (0 to disable)"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> fetcher_list, mode_list;
+    std::istringstream ifetchers(fetchers.c_str()), imodes(modes.c_str());
+    std::string tmp;
+    while( std::getline(ifetchers, tmp, ',') ) {
+        FileBufferFetcher* f = new_fetcher(tmp);
+        if( !f ) {
+            std::cerr << "unknown fetcher '" << tmp << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+        delete f;
+        fetcher_list.push_back(tmp);
+    }
+    while( std::getline(imodes, tmp, ',') ) {
+        if( tmp != "hot" && tmp != "cold" ) {
+            std::cerr << "unknown cache mode '" << tmp << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+        mode_list.push_back(tmp);
+    }
+
+    std::cout << std::setw(8) << "fetcher" << std::setw(6) << "cache"
+              << std::setw(10) << "buffers" << std::setw(10) << "bufs/s"
+              << std::setw(10) << "MB/s" << "  file" << std::endl;
+    const double MB = SiriusBuffer::BUFSIZE*4/1048576.0;
+    bool all_ok = true;
+    for(; a<argc; ++a) {
+        const std::string filename = argv[a];
+        unsigned int checksum = 0;
+        bool have_checksum = false;
+        for(unsigned int m=0; m<mode_list.size(); ++m) {
+            const bool cold = (mode_list[m] == "cold");
+            for(unsigned int f=0; f<fetcher_list.size(); ++f) {
+                if( !cold )
+                    read_file(fetcher_list[f], filename); // warm up the cache
+
+                std::vector<double> times;
+                Pass p;
+                for(int r=0; r<repeat; ++r) {
+                    if( cold && !drop_cache(filename) )
+                        std::cerr << "cannot drop '" << filename << "' from the page cache" << std::endl;
+                    p = read_file(fetcher_list[f], filename);
+                    if( !p.ok ) {
+                        std::cerr << "error reading '" << filename << "' with " << fetcher_list[f] << std::endl;
+                        all_ok = false;
+                        break;
+                    }
+                    if( have_checksum && p.checksum != checksum ) {
+                        std::cerr << "different data from '" << filename << "' with " << fetcher_list[f] << std::endl;
+                        all_ok = false;
+                    }
+                    checksum = p.checksum;
+                    have_checksum = true;
+                    times.push_back(p.seconds);
+                }
+                if( times.empty() )
+                    continue;
+                std::sort(times.begin(), times.end());
+                const double t = std::max(1e-6, times[times.size()/2]);
+                std::cout << std::setw(8) << fetcher_list[f] << std::setw(6) << mode_list[m]
+                          << std::setw(10) << p.buffers
+                          << std::setw(10) << std::fixed << std::setprecision(0) << p.buffers/t
+                          << std::setw(10) << std::setprecision(1) << p.buffers*MB/t
+                          << "  " << filename << std::endl;
+            }
+        }
+    }
+    return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,286 @@
+/*
+ * sortscan.cpp
+ *
+ *  Created on: 17.10.2026
+ */
+
+// Check the buffer structure of data files without sorting them:
+// event headers, event lengths and end-of-buffer markers, and report
+// bad buffers, event counts and the time span. Uncompressed files are
+// memory-mapped and checked by several threads. Optionally, the buffer
+// index used by 'data skip_bad' and 'data time' is written.
+
+#include "Buffer.h"
+#include "BufferScan.h"
+#include "ByteOrder.h"
+#include "FileReader.h"
+#include "RunIndex.h"
+#include "StringUtil.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define NDEBUG 1
+#include "debug.h"
+
+//! The number of buffers a thread takes at once.
+static const unsigned int CHUNK = 64;
+
+//! The result of checking one buffer.
+struct ScanResult {
+    BufferScan::Result result;
+    unsigned int events;
+    unsigned int position;
+    bool has_time;
+    long time_first, time_last;
+};
+
+//! The work shared by the scanning threads.
+struct ScanJob {
+    const unsigned int* data;
+    bool swap;
+    unsigned int nbuffers;
+    unsigned int next;
+    std::vector<ScanResult>* results;
+};
+
+// ########################################################################
+
+static void scan_one(const unsigned int* data, ScanResult& r)
+{
+    BufferScan scan;
+    r.result     = scan.Scan(data, SiriusBuffer::BUFSIZE);
+    r.events     = scan.events;
+    r.position   = scan.position;
+    r.has_time   = scan.has_time;
+    r.time_first = scan.time_first;
+    r.time_last  = scan.time_last;
+}
+
+// ########################################################################
+
+static void* scan_thread(void* v)
+{
+    ScanJob* job = (ScanJob*)v;
+    // buffers with the other byte order are swapped here, not in the
+    // mapping, where each swapped page would stay as a private copy
+    std::vector<unsigned int> swapped(job->swap ? SiriusBuffer::BUFSIZE : 0);
+    while( true ) {
+        const unsigned int b0 = __atomic_fetch_add(&job->next, CHUNK, __ATOMIC_RELAXED);
+        if( b0 >= job->nbuffers )
+            break;
+        const unsigned int b1 = std::min(b0 + CHUNK, job->nbuffers);
+        for(unsigned int b=b0; b<b1; ++b) {
+            const unsigned int* data = job->data + (size_t)b*SiriusBuffer::BUFSIZE;
+            if( job->swap ) {
+                std::memcpy(&swapped[0], data, SiriusBuffer::BUFSIZE*4);
+                ByteOrder::Swap(&swapped[0], SiriusBuffer::BUFSIZE);
+                data = &swapped[0];
+            }
+            scan_one(data, (*job->results)[b]);
+        }
+    }
+    return 0;
+}
+
+// ########################################################################
+
+//! Check an uncompressed file with several threads.
+/*! \return false if the file cannot be read
+ */
+static bool scan_mapped(const std::string& filename, int nthreads,
+                        std::vector<ScanResult>& results, off_t& extra)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if( fd<0 || fstat(fd, &st) != 0 ) {
+        if( fd >= 0 )
+            close(fd);
+        return false;
+    }
+    const off_t bytes = off_t(SiriusBuffer::BUFSIZE)*4;
+    const unsigned int nbuffers = st.st_size / bytes;
+    extra = st.st_size % bytes;
+    results.resize(nbuffers);
+    if( nbuffers == 0 ) {
+        close(fd);
+        return true;
+    }
+
+    void* m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( m == MAP_FAILED )
+        return false;
+    madvise(m, st.st_size, MADV_SEQUENTIAL);
+
+    ScanJob job;
+    job.data = (const unsigned int*)m;
+    job.swap = false;
+    for(unsigned int b=0; b<nbuffers; ++b) {
+        const ByteOrder::Order order = ByteOrder::Detect(job.data + (size_t)b*SiriusBuffer::BUFSIZE, SiriusBuffer::BUFSIZE);
+        if( order != ByteOrder::UNKNOWN ) {
+            job.swap = (order == ByteOrder::SWAPPED);
+            break;
+        }
+    }
+    job.nbuffers = nbuffers;
+    job.next = 0;
+    job.results = &results;
+    std::vector<pthread_t> threads(nthreads);
+    for(int i=0; i<nthreads; ++i) {
+        if( pthread_create( &threads[i], NULL, scan_thread, &job ) != 0 ) {
+            std::cerr << "cannot create scanning thread." << std::endl;
+            exit( -1 );
+        }
+    }
+    for(int i=0; i<nthreads; ++i)
+        pthread_join( threads[i], NULL );
+    munmap(m, st.st_size);
+    return true;
+}
+
+// ########################################################################
+
+//! Check a compressed file, reading it with FileReader.
+/*! \return false if the file cannot be read
+ */
+static bool scan_reader(const std::string& filename, std::vector<ScanResult>& results, off_t& extra)
+{
+    FileReader reader;
+    if( !reader.Open(filename, 0) )
+        return false;
+    SiriusBuffer buffer;
+    ByteOrder byte_order;
+    int r;
+    while( (r = reader.Read((char*)buffer.GetBuffer(), buffer.GetSize()*4)) > 0 ) {
+        byte_order.Fix(buffer.GetBuffer(), buffer.GetSize());
+        results.push_back(ScanResult());
+        scan_one(buffer.GetBuffer(), results.back());
+    }
+    // FileReader reports an incomplete buffer at the end as error
+    extra = (r < 0) ? -1 : 0;
+    return true;
+}
+
+// ########################################################################
+
+//! Check a file and print a report.
+/*! \return true if all buffers are okay
+ */
+static bool scan_file(const std::string& filename, int nthreads, bool verbose, bool write_index)
+{
+    std::vector<ScanResult> results;
+    off_t extra = 0;
+    const bool compressed = ends_with(filename, ".gz") || ends_with(filename, ".zst");
+    const bool ok = compressed
+        ? scan_reader(filename, results, extra)
+        : scan_mapped(filename, nthreads, results, extra);
+    if( !ok ) {
+        std::cout << filename << ": cannot read file" << std::endl;
+        return false;
+    }
+
+    long long events = 0;
+    unsigned int bad = 0, with_time = 0;
+    long t_first = 0, t_last = 0;
+    for(unsigned int b=0; b<results.size(); ++b) {
+        const ScanResult& r = results[b];
+        events += r.events;
+        if( r.has_time ) {
+            if( with_time == 0 )
+                t_first = r.time_first;
+            t_last = r.time_last;
+            with_time += 1;
+        }
+        if( r.result == BufferScan::OKAY )
+            continue;
+        bad += 1;
+
+        // print ranges of buffers with the same problem
+        const bool first = (b == 0 || results[b-1].result != r.result);
+        const bool last  = (b+1 == results.size() || results[b+1].result != r.result);
+        if( verbose ) {
+            std::cout << filename << ": buffer " << b << ": " << BufferScan::Describe(r.result)
+                      << " at word " << r.position << " after " << r.events << " events" << std::endl;
+        } else if( first ) {
+            std::cout << filename << ": buffer " << b;
+            if( last )
+                std::cout << ": " << BufferScan::Describe(r.result)
+                          << " at word " << r.position << std::endl;
+        } else if( last ) {
+            std::cout << '-' << b << ": " << BufferScan::Describe(r.result) << std::endl;
+        }
+    }
+
+    std::cout << filename << ": " << results.size() << " buffers, " << bad << " bad, "
+              << events << " events";
+    if( with_time > 0 )
+        std::cout << ", time " << t_first << " to " << t_last;
+    std::cout << std::endl;
+    if( extra > 0 )
+        std::cout << filename << ": " << extra << " bytes after the last complete buffer" << std::endl;
+    else if( extra < 0 )
+        std::cout << filename << ": incomplete buffer or read error at the end" << std::endl;
+
+    if( write_index && !results.empty() ) {
+        RunIndex index(filename);
+        for(unsigned int b=0; b<results.size(); ++b) {
+            const ScanResult& r = results[b];
+            RunIndex::Entry e;
+            e.offset     = off_t(b)*SiriusBuffer::BUFSIZE*4;
+            e.time_first = r.time_first;
+            e.time_last  = r.time_last;
+            e.events     = r.events;
+            e.okay       = (r.result == BufferScan::OKAY);
+            e.has_time   = r.has_time;
+            index.Add(e);
+        }
+        if( index.Write() )
+            std::cout << filename << ": wrote buffer index '" << RunIndex::IndexName(filename) << "'" << std::endl;
+    }
+    return bad == 0 && extra == 0;
+}
+
+// ########################################################################
+
+int main(int argc, char* argv[])
+{
+    int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool verbose = false, write_index = false;
+    int a = 1;
+    for(; a<argc && argv[a][0] == '-'; ++a) {
+        if( std::strcmp(argv[a], "-j") == 0 && a+1 < argc ) {
+            nthreads = std::atoi(argv[++a]);
+        } else if( std::strcmp(argv[a], "-v") == 0 ) {
+            verbose = true;
+        } else if( std::strcmp(argv[a], "-i") == 0 ) {
+            write_index = true;
+        } else {
+            a = argc;
+            break;
+        }
+    }
+    if( a >= argc ) {
+        std::cerr << "usage: " << argv[0] << " [-j <threads>] [-v] [-i] <datafile>...\n"
+                  << "  checks the buffer structure of data files without sorting them;\n"
+                  << "  -v lists each bad buffer instead of ranges\n"
+                  << "  -i writes the buffer index <datafile>.bufidx"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    nthreads = std::max(1, nthreads);
+
+    bool all_ok = true;
+    for(; a<argc; ++a)
+        all_ok = scan_file(argv[a], nthreads, verbose, write_index) && all_ok;
+    return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -44,9 +44,11 @@
  class UserXY : public SiriusRoutine {
  public:
      UserXY();
+     UserRoutine* New();
      bool Sort(const Event& event);
      void CreateSpectra();
      bool Command(const std::string& cmd);
+     bool SetupUnpacker(Unpacker& unpacker);
      void GiveNames();
      bool CheckNaIpromptGate (float);
      bool CheckNaIbgGate (float);
@@ -55,7 +57,6 @@
      bool CheckPPACpromptGate (float);
      bool CheckPPACbgGate (float);
 #endif /* USE_FISSION_PARAMETERS */
-     bool IsPPACChannel (int);
      int GetPPACChannel (int);
 
 
@@ -154,9 +155,10 @@
      Parameter ppac_efficiency;
 #endif /* USE_FISSION_PARAMETERS */     
 
-     //! Channel number of the PPACs
-     // In case no PPACs are used, just define the channels as "-1" in the batch file,
-     // then, as the channel id's are positive numbers, no channel will be identified as PPAC
+     //! Channel number of the PPACs, to number the PPAC spectra
+     // The unpacker separates the PPACs from the NaI detectors; it is
+     // set up with the same channels in SetupUnpacker().
+     // In case no PPACs are used, just define the channels as "-1" in the batch file.
      Parameter channel_PPAC;
 
 
@@ -174,6 +176,19 @@
      float range(float E /*!< particle energy in keV */)
         { return particlerange.GetRange( (int)E ); }
 
+     //! Calibrate a raw value, dithered by 'rando' to smooth the binning.
+     float calib(unsigned int raw, float gain, float shift) const
+        { return shift + (raw+rando) * gain; }
+
+     //! The dither for the event being sorted, from -0.5 to 0.5.
+     float rando;
+
+     //! The state of the random numbers for 'rando', see erand48().
+     /*! Each copy of the routine has its own, so that copies sorting
+      *  in parallel do not share the state of drand48().
+      */
+     unsigned short rand_state[3];
+
 };
  
 // ########################################################################
@@ -214,6 +229,22 @@ bool UserXY::Command(const std::string& cmd)
  {
      ede_rect.Set( "500 250 30 500" );
      thick_range.Set( "130  13 0" );
+
+     // the same numbers as drand48() without srand48() in glibc
+     rando = 0;
+     rand_state[0] = rand_state[1] = rand_state[2] = 0;
+}
+
+// ########################################################################
+
+UserRoutine* UserXY::New()
+{
+    UserXY* u = new UserXY();
+    for(int i=0; i<3; ++i)
+        u->rand_state[i] = (unsigned short)(erand48(rand_state)*65536);
+    // the time evolution plots of all copies start at the same time
+    ShareStartTime(*u);
+    return u;
 }
 
 
@@ -398,14 +429,6 @@ bool UserXY::Command(const std::string& cmd)
 
 // ########################################################################
 
-static float _rando = 0;
-static float calib(unsigned int raw, float gain, float shift)
-{
-    return shift + (raw+_rando) * gain;
-}
-
-// ########################################################################
-
 float UserXY::tNaI(float t, float Enai, float Esi)
 {
     const float c = tnai_corr_enai[0] + tnai_corr_enai[1]/(Enai+tnai_corr_enai[2]) + tnai_corr_enai[3]*Enai;
@@ -467,25 +490,39 @@ return NaIbgGate;
     }
  #endif /* USE_FISSION_PARAMETERS */
 // ########################################################################
-// Checks whether a channel is a PPAC channel
- bool UserXY::IsPPACChannel(int channel)
-    { 
-    bool PPACChannel =    channel == channel_PPAC[0] || channel == channel_PPAC[1] 
-                       || channel == channel_PPAC[2] || channel == channel_PPAC[3];
-    return PPACChannel;
-    }
-
 // Get which PPAC channel
  int UserXY::GetPPACChannel(int nai_channel)
     {
         for (int i = 0 ; i < 4 ; ++i)
             if (nai_channel == channel_PPAC[i])
                 return i;
-        std::cerr << "NaI-channel  " << nai_channel << "is NOT a PPAC!!!" << std::endl;
         return -1;
     }
 // ########################################################################
 
+bool UserXY::SetupUnpacker(Unpacker& unpacker)
+{
+    // the unpacker puts exactly the channel_PPAC channels into the PPAC list
+    for(int i=0; i<4; ++i) {
+        const int c = (int)channel_PPAC[i];
+        if( c < -1 || c >= 32 ) {
+            std::cerr << "UserXY: PPAC channel " << c << " in channel_PPAC is not -1 or 0..31." << std::endl;
+            return false;
+        }
+    }
+    for(int c=0; c<32; ++c) {
+        const bool ppac = (GetPPACChannel(c) >= 0);
+        if( unpacker.IsPPAC(c) != ppac ) {
+            std::cout << "UserXY: CACTUS channel " << c << (ppac ? " is" : " is not")
+                      << " in channel_PPAC, setting up the unpacker the same way." << std::endl;
+            unpacker.SetPPAC(c, ppac);
+        }
+    }
+    return true;
+}
+
+// ########################################################################
+
 
 
 bool UserXY::Sort(const Event& event)
@@ -494,7 +531,7 @@ bool UserXY::Sort(const Event& event)
 
     // begin the sorting
 
-    _rando = drand48() - 0.5;
+    rando = erand48(rand_state) - 0.5;
      
     // ..................................................
     // ALEXANDER's ORIGINAL ROUTINE
@@ -685,16 +722,13 @@ bool UserXY::Sort(const Event& event)
     int fiss = 0;
 
 #if USE_FISSION_PARAMETERS>0
-     for( int j=0; j<event.n_na; j++ ) {
+     for( int j=0; j<event.n_ppac; j++ ) {
          
-        const int ide = event.na[j].chn;
-        
-        if ( !IsPPACChannel(ide) )
-             continue;
+        const int ide = event.ppac[j].chn;
                     
-        const float na_e_f = calib( (int)event.na[j].adc, gain_na[ide], shift_na[ide] );
+        const float na_e_f = calib( (int)event.ppac[j].adc, gain_na[ide], shift_na[ide] );
         
-        const float na_t_f = calib( (int)event.na[j].tdc/8, gain_tna[ide], shift_tna[ide] );   
+        const float na_t_f = calib( (int)event.ppac[j].tdc/8, gain_tna[ide], shift_tna[ide] );   
 
         const int   ppac_t_c = (int)tPpac(na_t_f,e);   
 
@@ -734,7 +768,11 @@ bool UserXY::Sort(const Event& event)
      const bool have_pp = fabs(thick-thick_range[0])<thick_dev;
      if( APPLY_PARTICLE_GATE && !have_pp )
          return true;
-  
+
+     // one good particle inside the thickness gate: keep it for 'data skim'
+     if( si_goodcount == 1 && have_pp )
+         Select();
+
      m_e_de_thick->Fill( e_int, de_int );
      const float ede = e+de;
      const int   ede_int = (int)ede;
@@ -780,7 +818,7 @@ bool UserXY::Sort(const Event& event)
 
      // ..................................................
  
-     h_na_n->Fill(event.n_na);
+     h_na_n->Fill(event.n_na + event.n_ppac);
 
      for( int i=0; i<event.n_na; i++ ) {
          const int id = event.na[i].chn;
@@ -806,15 +844,11 @@ bool UserXY::Sort(const Event& event)
         
          const int   na_t_c = (int)tNaI(na_t, na_e, e);
 
-#if USE_FISSION_PARAMETERS>0
-         const int   ppac_t_c = (int)tPpac(na_t,e);
-#endif /* USE_FISSION_PARAMETERS>0 */
-
          m_nai_t->Fill( na_t_int, id );
    
  #if defined(MAKE_CACTUS_TIME_ENERGY_PLOTS) && (MAKE_CACTUS_TIME_ENERGY_PLOTS>0)
 
-        if ( !IsPPACChannel(id) && fiss==0) {   
+        if ( fiss==0) {   
             m_nai_e_t[id] ->Fill( na_e_int,  na_t_int );
             m_nai_e_t_all ->Fill( na_e_int,  na_t_int );
             m_nai_e_t_c   ->Fill( na_e_int,  na_t_c );
@@ -824,24 +858,18 @@ bool UserXY::Sort(const Event& event)
          }
         
    #if USE_FISSION_PARAMETERS>0
-        if ( !IsPPACChannel(id) && fiss==1) {   
+        if ( fiss==1) {   
         // m_nai_e_t_fiss[id] ->Fill( na_e_int,  na_t_int );
         m_nai_e_t_all_fiss_promptFiss ->Fill( na_e_int,  na_t_int );
         m_nai_e_t_c_fiss_promptFiss   ->Fill( na_e_int,  na_t_c );
         }
 
-        if ( !IsPPACChannel(id) && fiss==2) {   
+        if ( fiss==2) {   
         // m_nai_e_t_fiss_bg[id] ->Fill( na_e_int,  na_t_int );
         m_nai_e_t_all_fiss_bg ->Fill( na_e_int,  na_t_int );
         m_nai_e_t_c_fiss_bg   ->Fill( na_e_int,  na_t_c );
         }
 
-        if ( IsPPACChannel(id) ) {  //(do for any PPAC)
-
-        m_ppac_e_t[GetPPACChannel(id)]->Fill( e_int, na_t_int );     // ppac are feeded in as a NaI signal, therefore we
-        m_ppac_e_t_all->Fill( e_int, na_t_int ); // can use na_t_int as ppac times
-        m_ppac_e_t_c->Fill( e_int, ppac_t_c );   // but here they should be corrected
-        }
    #endif /* USE_FISSION_PARAMETERS>0 */
        
 #endif /* MAKE_CACTUS_TIME_ENERGY_PLOTS */
@@ -852,11 +880,11 @@ bool UserXY::Sort(const Event& event)
         float weight = 1;
 
         //Particle-gamma matrix all together
-        if( !IsPPACChannel(id) && CheckNaIpromptGate(na_t_c) ) {
+        if( CheckNaIpromptGate(na_t_c) ) {
             weight = 1;
             m_alfna->Fill( na_e_int, ex_int, weight);
         } 
-        else if( !IsPPACChannel(id) && CheckNaIbgGate(na_t_c) ) {
+        else if( CheckNaIbgGate(na_t_c) ) {
             weight = -1;
             m_alfna->Fill( na_e_int, ex_int, weight);          // bg substraction from the random gate
             m_alfna_bg->Fill( na_e_int, ex_int );   
@@ -865,11 +893,11 @@ bool UserXY::Sort(const Event& event)
 //***************************************************************************************************        
 #if USE_FISSION_PARAMETERS>0
          //Particle-gamma matrix with veto for fission
-        if( !IsPPACChannel(id) && fiss==0 && CheckNaIpromptGate(na_t_c) ) {
+        if( fiss==0 && CheckNaIpromptGate(na_t_c) ) {
                  weight = 1;
                  m_alfna_nofiss->Fill( na_e_int, ex_int, weight);
             } 
-        else if( !IsPPACChannel(id) && fiss==0 && CheckNaIbgGate(na_t_c) ) {
+        else if( fiss==0 && CheckNaIbgGate(na_t_c) ) {
                  weight = -1;                                     // currently: "-1"-> Should be adopted to real efficiency!
                  m_alfna_nofiss->Fill( na_e_int, ex_int, weight);
                  m_alfna_bg_nofiss->Fill( na_e_int, ex_int );
@@ -880,7 +908,7 @@ bool UserXY::Sort(const Event& event)
          // this is only a first attempt!
 
          //Particle-gamma matrix only in case of fission
-        if( !IsPPACChannel(id) && fiss==1 && CheckNaIpromptGate(na_t_c) ) {
+        if( fiss==1 && CheckNaIpromptGate(na_t_c) ) {
              weight = 1;
              m_alfna_fiss_promptFiss->Fill( na_e_int, ex_int, weight);
              m_alfna_fiss->Fill( na_e_int, ex_int, weight);
@@ -888,7 +916,7 @@ bool UserXY::Sort(const Event& event)
              weight = - 1/ppac_efficiency[0];
              m_alfna_nofiss->Fill( na_e_int, ex_int, weight);
         } 
-        else if( !IsPPACChannel(id)  && fiss==1 && CheckNaIbgGate(na_t_c) ) {
+        else if( fiss==1 && CheckNaIbgGate(na_t_c) ) {
              weight = -1;                                         // bg substraction from the random gate
              m_alfna_bg_fiss_promptFiss->Fill( na_e_int, ex_int );
 
@@ -898,7 +926,7 @@ bool UserXY::Sort(const Event& event)
              weight = + 1/ppac_efficiency[0];
              m_alfna_nofiss->Fill( na_e_int, ex_int, weight);
          }
-        else if( !IsPPACChannel(id)  && fiss==2 && CheckNaIbgGate(na_t_c) ) {
+        else if( fiss==2 && CheckNaIbgGate(na_t_c) ) {
              weight = -1;                                         // bg substraction from the random gate
              // m_alfna_fiss_promptFiss->Fill( na_e_int, ex_int, -1);
              m_alfna_bg_fiss_bg->Fill( na_e_int, ex_int );
@@ -917,6 +945,46 @@ bool UserXY::Sort(const Event& event)
         m_nai_t_evol[id]->Fill( na_t_c,   timediff );
 #endif /* MAKE_TIME_EVOLUTION_PLOTS */
     }
+
+     // ..................................................
+
+     // the PPACs are read out as CACTUS channels, but the unpacker
+     // puts them into their own list (see 'unpacker ppac')
+     for( int i=0; i<event.n_ppac; i++ ) {
+         const int id = event.ppac[i].chn;
+         const int ppac_nr = GetPPACChannel(id);
+
+         if( event.ppac[i].adc <= 0 )
+             continue;
+
+         const float na_e = calib( (int)event.ppac[i].adc, gain_na[id], shift_na[id] );
+         const int   na_e_int = (int)na_e;
+
+         m_nai_e->Fill( na_e_int, id );
+
+         if( event.ppac[i].tdc <= 0 )
+             continue;
+
+         const float na_t = calib( (int)event.ppac[i].tdc/8, gain_tna[id], shift_tna[id] );
+         const int   na_t_int = (int)na_t;
+
+         m_nai_t->Fill( na_t_int, id );
+
+#if defined(MAKE_CACTUS_TIME_ENERGY_PLOTS) && (MAKE_CACTUS_TIME_ENERGY_PLOTS>0) && (USE_FISSION_PARAMETERS>0)
+         const int   ppac_t_c = (int)tPpac(na_t,e);
+
+         m_ppac_e_t[ppac_nr]->Fill( e_int, na_t_int );     // ppac are feeded in as a NaI signal, therefore we
+         m_ppac_e_t_all->Fill( e_int, na_t_int ); // can use na_t_int as ppac times
+         m_ppac_e_t_c->Fill( e_int, ppac_t_c );   // but here they should be corrected
+#endif /* MAKE_CACTUS_TIME_ENERGY_PLOTS && USE_FISSION_PARAMETERS */
+
+#if defined(MAKE_TIME_EVOLUTION_PLOTS) && (MAKE_TIME_EVOLUTION_PLOTS>0)
+         const int   na_t_c = (int)tNaI(na_t, na_e, e);
+         m_nai_e_evol[id]->Fill( na_e_int, timediff );
+         m_nai_t_evol[id]->Fill( na_t_c,   timediff );
+#endif /* MAKE_TIME_EVOLUTION_PLOTS */
+     }
+
 #if defined(MAKE_TIME_EVOLUTION_PLOTS) && (MAKE_TIME_EVOLUTION_PLOTS>0)
     m_e_evol  [ei]     ->Fill( e_int,   timediff );
     m_de_evol [ei][dei]->Fill( de_int,  timediff );